@@ -0,0 +1,200 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <algorithm>
+
+#include "../Util/parallel.h"
+#include "../Util/atomic.h"
+#include "../Util/check_overflow.h"
+#include "../OTFont/OpenTypeFont.h"
+#include "BatchHinter.h"
+
+using util::smart_ptr;
+using util::String;
+
+namespace OpenType {
+
+/*** Processor ***/
+
+// An InstructionProcessor for one thread, which keeps the size that is set
+class BatchHinter::Processor : public InstructionProcessor {
+	bool sizeSet;
+	Size size;
+	// The error that setting the size gave, if any
+	String sizeError;
+
+protected:
+	virtual void addWarning (InstructionExceptionPtr newWarning) {}
+
+public:
+	Processor() : sizeSet (false) {}
+
+	// Hint glyphId at aSize into points; return the error if this fails
+	String hint (UShort glyphId, const Size &aSize, Zone &points);
+};
+
+String BatchHinter::Processor::hint (UShort glyphId, const Size &aSize, Zone &points) {
+	if (!sizeSet || size.ppemX != aSize.ppemX || size.ppemY != aSize.ppemY ||
+		size.pointSize != aSize.pointSize)
+	{
+		size = aSize;
+		sizeSet = true;
+		sizeError = String();
+		try {
+			setPPEM (size.ppemX, size.ppemY, size.pointSize);
+		} catch (Exception &e) {
+			sizeError = e.getFullDescription();
+		} catch (util::overflow_exception &) {
+			sizeError = "Overflow while setting point sizes";
+		}
+	}
+	if (!sizeError.empty())
+		return sizeError;
+
+	try {
+		getGlyphZone (glyphId, points);
+	} catch (Exception &e) {
+		return e.getFullDescription();
+	} catch (util::overflow_exception &) {
+		return "Overflow while hinting glyph " + String (glyphId);
+	}
+	return String();
+}
+
+/*** HintTask ***/
+
+// Every processor takes blocks of glyphs from the jobs that are left, which
+// are ordered by size, so that the size changes as little as possible.
+class BatchHinter::HintTask : public util::parallel_task {
+	Processors &processors;
+	const GlyphIds &glyphIds;
+	const Sizes &sizes;
+	std::vector <InstructionProcessor::Zone> &jobPoints;
+	std::vector <String> &errors;
+	volatile ULong nextJob;
+
+	enum { jobBlockSize = 8 };
+
+public:
+	HintTask (Processors &aProcessors, const GlyphIds &aGlyphIds, const Sizes &aSizes,
+		std::vector <InstructionProcessor::Zone> &aJobPoints, std::vector <String> &aErrors)
+		: processors (aProcessors), glyphIds (aGlyphIds), sizes (aSizes),
+		jobPoints (aJobPoints), errors (aErrors), nextJob (0) {}
+
+	virtual void run (size_t begin, size_t end) {
+		for (size_t p = begin; p < end; p ++)
+			runProcessor (*processors [p]);
+	}
+
+	void runProcessor (Processor &processor) {
+		ULong jobNum = jobPoints.size();
+		while (true) {
+			ULong job = util::atomic_fetch_add (nextJob, (ULong) jobBlockSize);
+			if (job >= jobNum)
+				break;
+			ULong blockEnd = std::min (job + jobBlockSize, jobNum);
+			for (; job < blockEnd; job ++) {
+				errors [job] = processor.hint (glyphIds [job % glyphIds.size()],
+					sizes [job / glyphIds.size()], jobPoints [job]);
+			}
+		}
+	}
+};
+
+/*** CopyTask ***/
+
+// Copy the points of every job into HintedPoints
+class BatchHinter::CopyTask : public util::parallel_task {
+	std::vector <InstructionProcessor::Zone> &jobPoints;
+	HintedPoints &points;
+
+public:
+	CopyTask (std::vector <InstructionProcessor::Zone> &aJobPoints, HintedPoints &aPoints)
+		: jobPoints (aJobPoints), points (aPoints) {}
+
+	virtual void run (size_t begin, size_t end) {
+		for (size_t job = begin; job < end; job ++) {
+			ULong i = points.pointBegin [job];
+			const InstructionProcessor::Zone &zone = jobPoints [job];
+			std::copy (zone.currentX.begin(), zone.currentX.end(), points.currentX.begin() + i);
+			std::copy (zone.currentY.begin(), zone.currentY.end(), points.currentY.begin() + i);
+			std::copy (zone.originalX.begin(), zone.originalX.end(), points.originalX.begin() + i);
+			std::copy (zone.originalY.begin(), zone.originalY.end(), points.originalY.begin() + i);
+			// The flags are the same as the zone's
+			std::copy (zone.flags.begin(), zone.flags.end(), points.flags.begin() + i);
+			// Free the memory as soon as possible
+			InstructionProcessor::Zone().swap (jobPoints [job]);
+		}
+	}
+};
+
+/*** BatchHinter ***/
+
+BatchHinter::BatchHinter (smart_ptr <OpenTypeFont> aFont) : font (aFont) {
+	font->freeze();
+	instructionReader = new Processor;
+	instructionReader->setFont (font);
+}
+
+BatchHinter::~BatchHinter() {}
+
+void BatchHinter::hint (const GlyphIds &glyphIds, const Sizes &sizes, HintedPoints &points) {
+	ULong jobNum = glyphIds.size() * sizes.size();
+	points.glyphNum = glyphIds.size();
+	points.errors.clear();
+	points.errors.insert (points.errors.end(), jobNum, String());
+
+	unsigned int threadNum = util::get_thread_num();
+	while (processors.size() < threadNum) {
+		ProcessorPtr processor = new Processor;
+		processor->setFont (*instructionReader);
+		processors.push_back (processor);
+	}
+
+	std::vector <InstructionProcessor::Zone> jobPoints (jobNum);
+	HintTask task (processors, glyphIds, sizes, jobPoints, points.errors);
+	if (!util::parallel_for (task, threadNum)) {
+		// Do the work again in this thread, so that the exception that
+		// occurred is thrown here.
+		HintTask serialTask (processors, glyphIds, sizes, jobPoints, points.errors);
+		serialTask.runProcessor (*processors [0]);
+	}
+
+	points.pointBegin.clear();
+	points.pointBegin.reserve (jobNum + 1);
+	ULong pointNum = 0;
+	for (ULong job = 0; job < jobNum; job ++) {
+		points.pointBegin.push_back (pointNum);
+		pointNum += jobPoints [job].size();
+	}
+	points.pointBegin.push_back (pointNum);
+
+	points.currentX.resize (pointNum);
+	points.currentY.resize (pointNum);
+	points.originalX.resize (pointNum);
+	points.originalY.resize (pointNum);
+	points.flags.resize (pointNum);
+
+	CopyTask copyTask (jobPoints, points);
+	util::parallel_for (copyTask, jobNum, 64);
+}
+
+}	// end namespace OpenType
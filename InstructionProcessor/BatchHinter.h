@@ -0,0 +1,97 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	BatchHinter hints a set of glyphs at a number of sizes, spreading the
+	work over the threads that util::parallel_for uses.
+*/
+
+#ifndef OTBATCHHINTER_H
+#define OTBATCHHINTER_H
+
+#include <vector>
+
+#include "../Util/smart_ptr.h"
+#include "../Util/String.h"
+#include "InstructionProcessor.h"
+
+namespace OpenType {
+	class BatchHinter {
+	public:
+		struct Size {
+			ULong ppemX, ppemY, pointSize;
+		};
+
+		typedef std::vector <Size> Sizes;
+		typedef std::vector <UShort> GlyphIds;
+
+		enum PointFlags {
+			pfOnCurve = InstructionProcessor::Zone::zfOnCurve,
+			pfTouchedX = InstructionProcessor::Zone::zfTouchedX,
+			pfTouchedY = InstructionProcessor::Zone::zfTouchedY,
+			pfLastContourPoint = InstructionProcessor::Zone::zfLastContourPoint
+		};
+
+		// The grid-fitted points of every glyph at every size, as returned by
+		// InstructionProcessor::getGlyphPoints, with the fields in separate
+		// arrays. The points of glyph glyphIds [g] at size sizes [s] are
+		// [pointBegin [j], pointBegin [j + 1]), with j = getJob (s, g).
+		struct HintedPoints {
+			ULong glyphNum;
+			std::vector <ULong> pointBegin;
+			std::vector <NewF26Dot6> currentX, currentY;
+			std::vector <NewF26Dot6> originalX, originalY;
+			// PointFlags
+			std::vector <Byte> flags;
+			// For every glyph at every size the description of the error that
+			// occurred, or an empty string if it was hinted
+			std::vector <util::String> errors;
+
+			ULong getJob (ULong sizeIndex, ULong glyphIndex) const {
+				return sizeIndex * glyphNum + glyphIndex;
+			}
+		};
+
+	private:
+		class Processor;
+		typedef util::smart_ptr <Processor> ProcessorPtr;
+		typedef std::vector <ProcessorPtr> Processors;
+		class HintTask;
+		class CopyTask;
+
+		util::smart_ptr <OpenTypeFont> font;
+		// Reads the instructions; the other processors share them
+		ProcessorPtr instructionReader;
+		// One processor for every thread, which keeps the state for the
+		// sizes it has hinted glyphs at between calls to hint()
+		Processors processors;
+
+	public:
+		// The font is frozen, so that the threads can share it.
+		BatchHinter (util::smart_ptr <OpenTypeFont> aFont);
+		~BatchHinter();
+
+		// Hint all glyphs in glyphIds at all sizes. Warnings are ignored.
+		void hint (const GlyphIds &glyphIds, const Sizes &sizes, HintedPoints &points);
+	};
+}
+
+#endif // OTBATCHHINTER_H
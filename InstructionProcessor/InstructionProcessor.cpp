@@ -28,8 +28,11 @@
 #pragma warning(disable:4786)
 #endif
 
+#include <algorithm>
+
 #include "InstructionProcessor.h"
 #include "Instructions.h"
+#include "InstructionProfiler.h"
 #include "../OTFont/OTGlyph.h"
 #include "../OTFont/OpenTypeFont.h"
 
@@ -41,7 +44,11 @@ namespace OpenType {
 
 /*** InstructionProcessor ***/
 
-InstructionProcessor::InstructionProcessor () {
+InstructionProcessor::InstructionProcessor (bool aUseInstructionObjects)
+: fontProgramExecuted (false), ppemStateUse (0), stackSize (0), maxStackElements (0),
+  decodedCallStack (initialCallDepth), callDepth (0),
+  useInstructionObjects (aUseInstructionObjects), profiler (NULL) {
+	callStack.reserve (initialCallDepth);
 	assert (round (NewF26Dot6 (.5), NewF26Dot6 (1), NewF26Dot6 (0), NewF26Dot6 (.5)) == 1);
 	assert (round (NewF26Dot6 (-.5), NewF26Dot6 (1), NewF26Dot6 (0), NewF26Dot6 (.5)) == -1);
 	assert (round (NewF26Dot6 (2.5), NewF26Dot6 (1.5), NewF26Dot6 (.5), NewF26Dot6 (.75)) == 2);
@@ -53,36 +60,53 @@ void InstructionProcessor::setFont (smart_ptr <OpenTypeFont> aFont)
 {
 	font = aFont;
 	unitsPerEm = font->getUnitsPerEm();
+	maxStackElements = font->getMaxStackElements();
 
 	Exception::FontContext c1 (*font);
 	Exception::Context c2 ("initialising instruction processor");
 
 	MemoryBlockPtr memory = font->getfpgm(false);
-	fontProgram.programType = ptFontProgram;
-	fontProgram.instructions = getInstructions (memory);
+	loadProgram (fontProgram, memory, ptFontProgram);
 	
 	// The cvt instructions may be already loaded, though they aren't executed yet.
 	memory = font->getprep(false);
-	cvtProgram.programType = ptCVTProgram;
-	cvtProgram.instructions = getInstructions (memory);
+	loadProgram (cvtProgram, memory, ptCVTProgram);
 
+	fontProgramExecuted = false;
+	ppemStates.clear();
+	glyphPrograms.clear();
+	emptyGlyphProgram = DecodedProgramPtr();
 	state = psNotActive;
 }
 
+// The font program and the cvt program are kept both as Instruction objects
+// and decoded, so that setFont (const InstructionProcessor &) can pass them
+// on to a processor that uses the other.
+void InstructionProcessor::loadProgram (InstructionStream &stream, MemoryBlockPtr memory,
+										ProgramType programType)
+{
+	stream.programType = programType;
+	getInstructions (stream, memory);
+	stream.decoded = decodeProgram (memory, programType);
+}
+
 void InstructionProcessor::setFont (const InstructionProcessor &aProc) {
 	font = aProc.font;
 	unitsPerEm = font->getUnitsPerEm();
+	maxStackElements = aProc.maxStackElements;
 
 	Exception::FontContext c1 (*font);
 	Exception::Context c2 ("initialising instruction processor");
 
-	fontProgram.programType = ptFontProgram;
 	// Copying this makes a lot of difference in terms of memory use and
 	// CPU time
-	fontProgram.instructions = aProc.fontProgram.instructions;
-	cvtProgram.programType = ptCVTProgram;
-	cvtProgram.instructions = aProc.cvtProgram.instructions;
+	fontProgram = aProc.fontProgram;
+	cvtProgram = aProc.cvtProgram;
 
+	fontProgramExecuted = false;
+	ppemStates.clear();
+	glyphPrograms.clear();
+	emptyGlyphProgram = DecodedProgramPtr();
 	state = psNotActive;
 }
 
@@ -94,18 +118,49 @@ void InstructionProcessor::setPPEM (ULong aPPEMx, ULong aPPEMy, ULong aPointSize
 	ppemY = aPPEMy;
 	pointSize = aPointSize;
 
-	storage.clear();
-	cvt.clear();
-	functionDefinitions.clear();
+	// Font program has to be executed first
+	if (!fontProgramExecuted)
+		executeFontProgram();
+
+	PPEMStates::iterator i;
+	for (i = ppemStates.begin(); i != ppemStates.end(); i ++) {
+		if (i->ppemX == ppemX && i->ppemY == ppemY && i->pointSize == pointSize) {
+			cvt = i->cvt;
+			storage = i->storage;
+			functionDefinitions = i->functionDefinitions;
+			defaultGraphicsState = currentGraphicsState = i->graphicsState;
+			i->lastUse = ++ ppemStateUse;
+			return;
+		}
+	}
+
+	executeCVTProgram();
+}
+
+void InstructionProcessor::executeFontProgram() {
+	FunctionDefinition undefined;
+	undefined.defined = false;
+	functionDefinitions.assign (font->getMaxFunctionDefs(), undefined);
 
 	// Initialise storage
 	StorageElement se = {0x0, false};
 	storage.clear();
 	storage.insert (storage.end(), font->getMaxStorage(), se);
 
-	// Font program has to be executed first
 	executeInstructions (psFontProgram);
 
+	fontProgramStorage = storage;
+	fontProgramFunctions = functionDefinitions;
+	fontProgramExecuted = true;
+}
+
+// Execute the CVT program for the current size and keep the result, unless
+// it fails.
+void InstructionProcessor::executeCVTProgram() {
+	storage = fontProgramStorage;
+	functionDefinitions = fontProgramFunctions;
+
+	cvt.clear();
 	CVTEntry ce = {0, unitsPerEm, false, false, false};
 	MemoryBlockPtr cvtMemory = font->getcvt(false);
 	if (cvtMemory) {
@@ -129,15 +184,112 @@ void InstructionProcessor::setPPEM (ULong aPPEMx, ULong aPPEMy, ULong aPointSize
 	// Set graphics state
 	resetGraphicsState (false);
 	defaultGraphicsState = currentGraphicsState;
+
+	// Keep the state, replacing the least recently used one if necessary
+	PPEMStates::iterator ppemState;
+	if (ppemStates.size() < maxPPEMStates)
+		ppemState = ppemStates.insert (ppemStates.end(), PPEMState());
+	else {
+		ppemState = ppemStates.begin();
+		for (PPEMStates::iterator i = ppemStates.begin(); i != ppemStates.end(); i ++) {
+			if (i->lastUse < ppemState->lastUse)
+				ppemState = i;
+		}
+	}
+	ppemState->ppemX = ppemX;
+	ppemState->ppemY = ppemY;
+	ppemState->pointSize = pointSize;
+	ppemState->cvt = cvt;
+	ppemState->storage = storage;
+	ppemState->graphicsState = defaultGraphicsState;
+	ppemState->functionDefinitions = functionDefinitions;
+	ppemState->lastUse = ++ ppemStateUse;
+}
+
+/*** Zone ***/
+
+void InstructionProcessor::Zone::clear() {
+	currentX.clear();
+	currentY.clear();
+	originalX.clear();
+	originalY.clear();
+	flags.clear();
 }
 
-void InstructionProcessor::loadGlyph (GlyphPtr glyph) {
+void InstructionProcessor::Zone::reserve (ULong pointNum) {
+	currentX.reserve (pointNum);
+	currentY.reserve (pointNum);
+	originalX.reserve (pointNum);
+	originalY.reserve (pointNum);
+	flags.reserve (pointNum);
+}
+
+void InstructionProcessor::Zone::swap (Zone &other) {
+	currentX.swap (other.currentX);
+	currentY.swap (other.currentY);
+	originalX.swap (other.originalX);
+	originalY.swap (other.originalY);
+	flags.swap (other.flags);
+}
+
+void InstructionProcessor::Zone::assign (ULong pointNum, Byte aFlags) {
+	currentX.assign (pointNum, NewF26Dot6());
+	currentY.assign (pointNum, NewF26Dot6());
+	originalX.assign (pointNum, NewF26Dot6());
+	originalY.assign (pointNum, NewF26Dot6());
+	flags.assign (pointNum, aFlags);
+}
+
+void InstructionProcessor::Zone::push_back (const GridFittedPoint &p) {
+	currentX.push_back (p.currentX);
+	currentY.push_back (p.currentY);
+	originalX.push_back (p.originalX);
+	originalY.push_back (p.originalY);
+	flags.push_back ((p.onCurve ? zfOnCurve : 0) | (p.touchedX ? zfTouchedX : 0) |
+		(p.touchedY ? zfTouchedY : 0) | (p.lastContourPoint ? zfLastContourPoint : 0));
+}
+
+void InstructionProcessor::Zone::append (const Zone &other, ULong begin, ULong end) {
+	currentX.insert (currentX.end(), other.currentX.begin() + begin, other.currentX.begin() + end);
+	currentY.insert (currentY.end(), other.currentY.begin() + begin, other.currentY.begin() + end);
+	originalX.insert (originalX.end(), other.originalX.begin() + begin, other.originalX.begin() + end);
+	originalY.insert (originalY.end(), other.originalY.begin() + begin, other.originalY.begin() + end);
+	flags.insert (flags.end(), other.flags.begin() + begin, other.flags.begin() + end);
+}
+
+InstructionProcessor::GridFittedPoint InstructionProcessor::Zone::getPoint (ULong index) const {
+	GridFittedPoint p;
+	p.currentX = currentX [index];
+	p.currentY = currentY [index];
+	p.originalX = originalX [index];
+	p.originalY = originalY [index];
+	p.onCurve = (flags [index] & zfOnCurve) != 0;
+	p.touchedX = (flags [index] & zfTouchedX) != 0;
+	p.touchedY = (flags [index] & zfTouchedY) != 0;
+	p.lastContourPoint = (flags [index] & zfLastContourPoint) != 0;
+	return p;
+}
+
+void InstructionProcessor::Zone::getPoints (Points &result) const {
+	result.clear();
+	result.reserve (size());
+	for (ULong i = 0; i < size(); i ++)
+		result.push_back (getPoint (i));
+}
+
+/*** Loading glyphs ***/
+
+// Load the points of a glyph into points, and its instructions into
+// glyphProgram. Composite glyphs at depth are put together in
+// compositeZones [depth], so that loading a glyph allocates memory only if
+// it is larger than any loaded before.
+void InstructionProcessor::loadGlyph (GlyphPtr glyph, UShort glyphId, ULong depth) {
 	points.clear();
 	GridFittedPoint p;
 	HorMetric hm = glyph->getHorMetric();
 	Short displacement = - glyph->getDisplacement();
 
-	Points bearings;
+	GridFittedPoint bearings [4];
 
 	/** Sidebearing points **/
 	p.onCurve = true;
@@ -146,28 +298,31 @@ void InstructionProcessor::loadGlyph (GlyphPtr glyph) {
 	// Set point n (left side bearing)
 	p.currentX = p.originalX = 0;
 	p.currentY = p.originalY = 0;
-	bearings.push_back (p);
+	bearings [0] = p;
 
 	// Set point n+1 (right side bearing)
 	p.originalX = toF26Dot6x(hm.advanceWidth);
 	p.currentX = p.originalX.round();
 	p.currentY = p.originalY = 0;
-	bearings.push_back (p);
+	bearings [1] = p;
 
 	// Set point n+2 (upper bearing)
 	p.currentX = p.originalX = 0;
 	p.originalY = toF26Dot6y(font->getWinAscent());
 	p.currentY = p.originalY.round();
-	bearings.push_back (p);
+	bearings [2] = p;
 
 	// Set point n+3 (lower bearing)
 	p.currentX = p.originalX = 0;
 	p.originalY = toF26Dot6y(-font->getWinDescent());
 	p.currentY = p.originalY.round();
-	bearings.push_back (p);
+	bearings [3] = p;
 
-	if (!glyph->isComposite()) {
-		Contours contours = glyph->getContours();
+	if (glyph->isEmpty()) {
+		// No points apart from the sidebearing points
+	} else if (!glyph->isComposite()) {
+		// const, so that the contours that the glyph shares are not copied
+		const Contours contours = glyph->getContours();
 		points.reserve (contours.getPointNum() + 4);
 
 		Contours::const_iterator contour;
@@ -189,22 +344,29 @@ void InstructionProcessor::loadGlyph (GlyphPtr glyph) {
 		}
 	} else
 	{
-		Components components = glyph->getComponents();
+		const Components &components = glyph->getComponents();
+
+		if (compositeZones.size() <= depth)
+			compositeZones.resize (depth + 1);
+		if (!compositeZones [depth])
+			compositeZones [depth] = new Zone;
+		Zone &composite = *compositeZones [depth];
+		composite.clear();
 
-		Points previousPoints;
-		Components::iterator c;
+		Components::const_iterator c;
 		for (c = components.begin(); c != components.end(); c ++) {
-			// Recursively load glyph
-			Points componentPoints = getGlyphPoints ((*c)->getGlyphIndex());
+			// Recursively load glyph; this leaves its points in points
+			instructGlyph ((*c)->getGlyphIndex(), depth + 1);
 			CompositeComponent::Scale scale = (*c)->getScale();
+			ULong componentPointNum = points.size();
 
-			Points::iterator cp;
-			for (cp = componentPoints.begin(); cp != componentPoints.end(); cp ++) {
-				NewF26Dot6 x = cp->currentX;
-				NewF26Dot6 y = cp->currentY;
-				cp->currentX = //OT_MULTIPLY_BY_F2DOT14_AND_ADD (x, scale.xx, y, scale.yx);
+			ULong i;
+			for (i = 0; i < componentPointNum; i ++) {
+				NewF26Dot6 x = points.currentX [i];
+				NewF26Dot6 y = points.currentY [i];
+				points.currentX [i] = //OT_MULTIPLY_BY_F2DOT14_AND_ADD (x, scale.xx, y, scale.yx);
 					scale.xx * x + scale.yx * y;
-				cp->currentY = //OT_MULTIPLY_BY_F2DOT14_AND_ADD (x, scale.xy, y, scale.yy);
+				points.currentY [i] = //OT_MULTIPLY_BY_F2DOT14_AND_ADD (x, scale.xy, y, scale.yy);
 					scale.xy * x + scale.yy * y;
 			}
 
@@ -222,17 +384,17 @@ void InstructionProcessor::loadGlyph (GlyphPtr glyph) {
 				translation.y = toF26Dot6y (componentTranslation.y);
 			} else {
 				// Attached component
-				if (p1 >= previousPoints.size())
+				if (p1 >= composite.size())
 					throw InstructionException ("Base attachment point index too large: " +
 						String (p1));
 
 				UShort p2 = (*c)->getAttachmentPoint2();
-				if (p2 >= componentPoints.size())
+				if (p2 >= componentPointNum)
 					throw InstructionException ("Component attachment point index too large: " +
 						String (p2));
 
-				translation.x = previousPoints [p1].currentX - componentPoints [p2].currentX;
-				translation.y = previousPoints [p1].currentY - componentPoints [p2].currentY;
+				translation.x = composite.currentX [p1] - points.currentX [p2];
+				translation.y = composite.currentY [p1] - points.currentY [p2];
 			}
 
 			if ((*c)->getFlags() & CompositeComponent::cfRoundXYToGrid) {
@@ -240,50 +402,109 @@ void InstructionProcessor::loadGlyph (GlyphPtr glyph) {
 				translation.y = translation.y.round();
 			}
 
-			for (cp = componentPoints.begin(); cp != componentPoints.end() - 4; cp ++) {
-				p.currentX = p.originalX = cp->currentX + translation.x;
-				p.currentY = p.originalY = cp->currentY + translation.y;
-				p.onCurve = cp->onCurve;
-				p.touchedX = p.touchedY = false;
-				p.lastContourPoint = cp->lastContourPoint;
-				previousPoints.push_back (p);
-			}
+			// The component's points, except for its sidebearing points, are
+			// appended untouched, and translated in place, with both their
+			// positions at the translated current position.
+			ULong begin = composite.size();
+			ULong outlinePointNum = componentPointNum - 4;
+			composite.append (points, 0, outlinePointNum);
+			ULong end = composite.size();
+			for (i = begin; i < end; i ++)
+				composite.currentX [i] += translation.x;
+			for (i = begin; i < end; i ++)
+				composite.currentY [i] += translation.y;
+			std::copy (composite.currentX.begin() + begin, composite.currentX.end(),
+				composite.originalX.begin() + begin);
+			std::copy (composite.currentY.begin() + begin, composite.currentY.end(),
+				composite.originalY.begin() + begin);
+			for (i = begin; i < end; i ++)
+				composite.flags [i] &= Zone::zfOnCurve | Zone::zfLastContourPoint;
 
 			if ((*c)->getFlags() & CompositeComponent::cfUseMyMetrics) {
-				bearings.clear();
-				bearings.insert (bearings.end(), componentPoints.end()-4, componentPoints.end());
+				for (i = 0; i < 4; i ++)
+					bearings [i] = points.getPoint (outlinePointNum + i);
 			}
 		}
-		points = previousPoints;
+
+		points.clear();
+		points.append (composite, 0, composite.size());
 	}
 
-	points.insert (points.end(), bearings.begin(), bearings.end());
+	for (int i = 0; i < 4; i ++)
+		points.push_back (bearings [i]);
 
 	glyphProgram.programType = ptGlyphProgram;
 
 	// Execute glyph program only when the instruction execution flag allows it
-	if (!(defaultGraphicsState.instructionControl & ieInhibitGridFitting)) {		
-		// Load glyph instructions
-		glyphProgram.instructions = getInstructions (glyph->getInstructions());
-	} else {
-		glyphProgram.instructions.clear();
+	MemoryBlockPtr memory;
+	if (!(defaultGraphicsState.instructionControl & ieInhibitGridFitting))
+		memory = glyph->getInstructions();
+
+	// Load glyph instructions
+	if (useInstructionObjects)
+		getInstructions (glyphProgram, memory);
+	else
+		glyphProgram.decoded = getDecodedGlyphProgram (glyphId, memory);
+}
+
+// Glyph programs are decoded the first time the glyph is loaded. As with
+// the font program and the cvt program, they are assumed not to change
+// until the next setFont().
+InstructionProcessor::DecodedProgramPtr
+InstructionProcessor::getDecodedGlyphProgram (UShort glyphId, MemoryBlockPtr memory) {
+	if (!memory) {
+		if (!emptyGlyphProgram)
+			emptyGlyphProgram = decodeProgram (memory, ptGlyphProgram);
+		return emptyGlyphProgram;
 	}
+
+	if (glyphPrograms.size() <= glyphId)
+		glyphPrograms.resize (glyphId + 1);
+	DecodedProgramPtr &program = glyphPrograms [glyphId];
+	if (!program)
+		program = decodeProgram (memory, ptGlyphProgram);
+	return program;
 }
 
-InstructionProcessor::Points InstructionProcessor::getGlyphPoints (UShort glyphId) {
+void InstructionProcessor::instructGlyph (UShort glyphId, ULong depth) {
 	GlyphPtr glyph = font->getGlyph (glyphId);
 	Exception::FontContext c1 (*font);
-	Exception::Context c2 ("loading glyph " + String (glyphId) + " \'"
-		+ glyph->getName() + "\'");
-	loadGlyph (glyph);
+	Exception::Context c2 ("loading glyph %1 '%2'", glyphId, glyph->getName());
+	loadGlyph (glyph, glyphId, depth);
 
+	currentGlyphId = glyphId;
 	executeInstructions (psGlyphProgram);
+}
+
+void InstructionProcessor::getGlyphZone (UShort glyphId, Zone &result) {
+	instructGlyph (glyphId, 0);
 
-	Points pts = points;
+	result.clear();
+	result.append (points, 0, points.size());
 	points.clear();
+}
+
+InstructionProcessor::Points InstructionProcessor::getGlyphPoints (UShort glyphId) {
+	Points pts;
+	getGlyphPoints (glyphId, pts);
 	return pts;
 }
 
+void InstructionProcessor::getGlyphPoints (UShort glyphId, Points &result) {
+	instructGlyph (glyphId, 0);
+
+	points.getPoints (result);
+	points.clear();
+}
+
+void InstructionProcessor::setProfiler (InstructionProfiler *aProfiler) {
+	profiler = aProfiler;
+}
+
+void InstructionProcessor::resetTwilightZone() {
+	twilight.assign (font->getMaxTwilightPoints(), Zone::zfOnCurve | Zone::zfLastContourPoint);
+}
+
 void InstructionProcessor::resetGraphicsState(bool initially) {
 	// Many values are set only at the start: the CVT program then sets the new default values
 	if (initially) {
@@ -318,25 +539,129 @@ void InstructionProcessor::resetGraphicsState(bool initially) {
 	}
 }
 
-void InstructionProcessor::setUnitVector(Vector &vector, F18Dot14 x, F18Dot14 y) {
-	if (x*x + y*y == 1)
-	{	// (x,y) is unit vector already
-		vector.x = x;
-		vector.y = y;
-	} else {
-		double size = sqrt(x*x + y*y);
-		if (size==0) {
-			throw InstructionException ("Cannot set vector to (0,0)");
-			return;
-		}
-		vector.x = F2Dot14 (x / size);
-		vector.y = F2Dot14 (y / size);
+/*** Vectors ***/
+// These are done in integers, so that the results do not depend on the
+// floating-point arithmetic of the compiler or the processor.
+
+typedef util::unsigned_long_long_int UnsignedLongLong;
+
+UnsignedLongLong InstructionProcessor::squareRoot (UnsignedLongLong n) {
+	UnsignedLongLong root = 0;
+	UnsignedLongLong bit = UnsignedLongLong (1) << 62;
+	while (bit > n)
+		bit >>= 2;
+	while (bit != 0) {
+		if (n >= root + bit) {
+			n -= root + bit;
+			root = (root >> 1) + bit;
+		} else
+			root >>= 1;
+		bit >>= 2;
 	}
+	return root;
 }
 
+namespace {
+
+	// The position of the highest bit set in n, which is not 0
+	int highestBit (ULong n) {
+		int bit = 0;
+		while (n >>= 1)
+			bit ++;
+		return bit;
+	}
+
+	// Scale (x, y), which are both positive, to length 1 in 16.16, as
+	// FT_Vector_NormLen does. The vector is first shifted so that its
+	// approximate length x + y/2 (with x >= y) is between 2/3 and 4/3.
+	// Newton's method then finds b = 1/length - 1, until it stops growing.
+	// The arithmetic wraps around in 32 bits, exactly as FreeType's does.
+	void normalise (ULong &x, ULong &y) {
+		ULong length = x > y ? x + (y >> 1) : y + (x >> 1);
+		int shift = 31 - highestBit (length);
+		shift -= 15 + (length >= (0xAAAAAAAAu >> shift));
+		if (shift > 0) {
+			x <<= shift;
+			y <<= shift;
+			length = x > y ? x + (y >> 1) : y + (x >> 1);
+		} else {
+			x >>= -shift;
+			y >>= -shift;
+			length >>= -shift;
+		}
+
+		Long b = 0x10000 - Long (length);
+		Long shiftedX = Long (x), shiftedY = Long (y);
+		Long z;
+		do {
+			x = ULong (shiftedX + (shiftedX * b >> 16));
+			y = ULong (shiftedY + (shiftedY * b >> 16));
+			z = - Long (x * x + y * y) / 0x200;
+			z = z * ((0x10000 + b) >> 8) / 0x10000;
+			b += z;
+		} while (z > 0);
+	}
+
+	// The 16.16 value of a normalised component as 2.14, rounded towards 0
+	F2Dot14 toF2Dot14 (ULong value, bool negative) {
+		Long result = Long (value) / 4;
+		return F2Dot14 (F2Dot14::int_type (negative ? -result : result), fixed_fraction());
+	}
+
+}	// end anonymous namespace
+
+void InstructionProcessor::setUnitVector(Vector &vector, NewF26Dot6 x, NewF26Dot6 y) {
+	Long xi = x.get_i(), yi = y.get_i();
+	if (xi == 0 && yi == 0)
+		throw InstructionException ("Cannot set vector to (0,0)");
+
+	ULong absX = xi < 0 ? 0u - ULong (xi) : ULong (xi);
+	ULong absY = yi < 0 ? 0u - ULong (yi) : ULong (yi);
+	if (absX == 0 || absY == 0) {
+		// Axis vectors are exact
+		absX = absX == 0 ? 0 : 0x10000;
+		absY = absY == 0 ? 0 : 0x10000;
+	} else
+		normalise (absX, absY);
+
+	vector.x = toF2Dot14 (absX, xi < 0);
+	vector.y = toF2Dot14 (absY, yi < 0);
+}
+
+F18Dot14 InstructionProcessor::weightedAverage (ULong a, ULong b, const Vector & vec) {
+	LongLong x = vec.x.get_i(), y = vec.y.get_i();
+	// (a*vec.x)^2 + (b*vec.y)^2, with 28 fraction bits
+	UnsignedLongLong sumOfSquares = UnsignedLongLong (x * x) * a * a +
+		UnsignedLongLong (y * y) * b * b;
+	UnsignedLongLong root = squareRoot (sumOfSquares);
+	if (sumOfSquares - root * root > root)
+		root ++;
+	return F18Dot14 (F18Dot14::int_type (root), fixed_fraction());
+}
+
+
+namespace {
+	// Records a program in a profiler, if there is one, even if executing
+	// it throws an exception
+	class ProfiledProgram {
+		InstructionProfiler *profiler;
+	public:
+		ProfiledProgram (InstructionProfiler *aProfiler, InstructionProcessor::ProcessorState program,
+			ULong glyphId, ULong ppemX, ULong ppemY, ULong pointSize)
+		: profiler (aProfiler) {
+			if (profiler)
+				profiler->beginProgram (program, glyphId, ppemX, ppemY, pointSize);
+		}
+
+		~ProfiledProgram() {
+			if (profiler)
+				profiler->endProgram();
+		}
+	};
+}
 
 void InstructionProcessor::executeInstructions (ProcessorState aState) {
-	Exception::Context c ("executing " + stateToString (aState));
+	Exception::Context c ("executing %1", stateToString (aState));
 
 	state = aState;
 	switch (state) {
@@ -353,20 +678,44 @@ void InstructionProcessor::executeInstructions (ProcessorState aState) {
 		currentGraphicsState = defaultGraphicsState;
 		break;
 	}
-	currentInstruction.position = currentInstruction.stream->instructions.begin();
-	nextInstruction.stream = currentInstruction.stream;
+	stackSize = 0;
+	if (stack.size() < maxStackElements)
+		stack.resize (maxStackElements);
+
+	resetTwilightZone();
 
-	stack.clear();
-	stack.reserve (font->getMaxStackElements());
+	{
+		ProfiledProgram profiled (profiler, state,
+			state == psGlyphProgram ? currentGlyphId : ULong (InstructionProfiler::noGlyph),
+			ppemX, ppemY, pointSize);
 
+		if (useInstructionObjects)
+			executeInstructionObjects();
+		else {
+			nextDecodedProgram = currentInstruction.stream->decoded;
+			executeDecodedProgram (*nextDecodedProgram);
+		}
+	}
+
+	if (currentGraphicsState.loop != 1)
+		addWarning (new InstructionException ("Loop variable " +
+			String (currentGraphicsState.loop) + " after execution"));
+	if (!callStack.empty() || callDepth != 0)
+		addWarning (new InstructionException ("Non-empty call stack after execution"));
+	callStack.clear();
+	callDepth = 0;
+	if (stackSize != 0)
+		addWarning (new InstructionException ("Elements left on the stack after execution: "
+			+ String (stackSize)));
+	stackSize = 0;
 	twilight.clear();
-	GridFittedPoint p;// = {0,0, 0,0, true, false, false, true};
-	p.currentX = p.currentY = p.originalX = p.originalY = 0;
-	p.onCurve = true;
-	p.touchedX = false;
-	p.touchedY = false;
-	p.lastContourPoint = true;
-	twilight.insert (twilight.end(), font->getMaxTwilightPoints(), p);
+
+	state = psNotActive;
+}
+
+void InstructionProcessor::executeInstructionObjects() {
+	currentInstruction.position = currentInstruction.stream->instructions.begin();
+	nextInstruction.stream = currentInstruction.stream;
 
 	ULong instructionNum = 0;
 
@@ -377,6 +726,9 @@ void InstructionProcessor::executeInstructions (ProcessorState aState) {
 				throw InstructionException ("More than 100000 instructions executed; possibly an endless loop");
 
 			nextInstruction.position = currentInstruction.position + 1;
+			if (profiler)
+				profiler->countInstruction ((*currentInstruction.position)->instruction);
+			checkStackEffect (**currentInstruction.position);
 			(*currentInstruction.position)->execute (*this);
 
 			currentInstruction = nextInstruction;
@@ -387,20 +739,410 @@ void InstructionProcessor::executeInstructions (ProcessorState aState) {
 		e.setInstructionPosition (currentInstruction);
 		throw e;
 	}
+}
 
-	if (currentGraphicsState.loop != 1)
-		addWarning (new InstructionException ("Loop variable " +
-			String (currentGraphicsState.loop) + " after execution"));
-	if (!callStack.empty())
-		addWarning (new InstructionException ("Non-empty call stack after execution"));
-	callStack.clear();
-	if (!stack.empty())
-		addWarning (new InstructionException ("Elements left on the stack after execution: "
-			+ String (stack.size())));
-	stack.clear();
-	twilight.clear();
+// This should do exactly what executeInstructionObjects does, and the
+// instructions that do not change the flow of control are shared with it.
+void InstructionProcessor::executeDecodedProgram (const DecodedProgram &program) {
+	DecodedPosition current;
+	current.program = &program;
+	current.begin = current.position = 0;
+	current.end = program.instructions.size();
+	DecodedPosition next = current;
 
-	state = psNotActive;
+	ULong instructionNum = 0;
+
+	try {
+		while (current.position != current.end)
+		{
+			if (instructionNum > 100000)
+				throw InstructionException ("More than 100000 instructions executed; possibly an endless loop");
+
+			const DecodedInstruction &instruction = current.program->instructions [current.position];
+			Byte opcode = instruction.opcode;
+			next.position = current.position + 1;
+			if (profiler)
+				profiler->countInstruction (opcode);
+			checkStackEffect (opcode);
+
+			switch (opcode) {
+			case oiNPUSHB: case oiNPUSHW:
+				{
+					checkPush (instruction.valueNum);
+					ULong end = instruction.argument + instruction.valueNum;
+					for (ULong i = instruction.argument; i < end; i ++)
+						push (current.program->values [i]);
+				}
+				break;
+
+			case oiRS:
+				ReadStoreInstruction::run (*this, opcode);
+				break;
+			case oiWS:
+				WriteStoreInstruction::run (*this, opcode);
+				break;
+			case oiWCVTP:
+				WriteCVTPixelsInstruction::run (*this, opcode);
+				break;
+			case oiWCVTF:
+				WriteCVTFUnitsInstruction::run (*this, opcode);
+				break;
+			case oiRCVT:
+				ReadCVTInstruction::run (*this, opcode);
+				break;
+
+			case oiSVTCAy: case oiSVTCAx:
+				VectorsToAxisInstruction::run (*this, opcode);
+				break;
+			case oiSPVTCAy: case oiSPVTCAx:
+				ProjectionToAxisInstruction::run (*this, opcode);
+				break;
+			case oiSFVTCAy: case oiSFVTCAx:
+				FreedomToAxisInstruction::run (*this, opcode);
+				break;
+			case oiSPVTL: case oiSPVTLperp:
+				ProjectionToLineInstruction::run (*this, opcode);
+				break;
+			case oiSFVTL: case oiSFVTLperp:
+				FreedomToLineInstruction::run (*this, opcode);
+				break;
+			case oiSFVTPV:
+				FreedomToProjectionInstruction::run (*this, opcode);
+				break;
+			case oiSDPVTL: case oiSDPVTLperp:
+				DualProjectionToLineInstruction::run (*this, opcode);
+				break;
+			case oiSPVFS:
+				ProjectionFromStackInstruction::run (*this, opcode);
+				break;
+			case oiSFVFS:
+				FreedomFromStackInstruction::run (*this, opcode);
+				break;
+			case oiGPV:
+				GetProjectionVectorInstruction::run (*this, opcode);
+				break;
+			case oiGFV:
+				GetFreedomVectorInstruction::run (*this, opcode);
+				break;
+			case oiSRP0: case oiSRP1: case oiSRP2:
+				SetReferencePointInstruction::run (*this, opcode);
+				break;
+			case oiSZP0: case oiSZP1: case oiSZP2:
+				SetZonePointerInstruction::run (*this, opcode);
+				break;
+			case oiSZPS:
+				SetZonePointersInstruction::run (*this, opcode);
+				break;
+
+			case oiRTHG:
+				RoundToHalfGridInstruction::run (*this, opcode);
+				break;
+			case oiRTG:
+				RoundToGridInstruction::run (*this, opcode);
+				break;
+			case oiRTDG:
+				RoundToDoubleGridInstruction::run (*this, opcode);
+				break;
+			case oiRDTG:
+				RoundDownToGridInstruction::run (*this, opcode);
+				break;
+			case oiRUTG:
+				RoundUpToGridInstruction::run (*this, opcode);
+				break;
+			case oiROFF:
+				RoundOffInstruction::run (*this, opcode);
+				break;
+			case oiSROUND:
+				SuperRoundInstruction::run (*this, opcode);
+				break;
+			case oiS45ROUND:
+				SuperRound45Instruction::run (*this, opcode);
+				break;
+
+			case oiSLOOP:
+				SetLoopInstruction::run (*this, opcode);
+				break;
+			case oiSMD:
+				SetMinimumDistanceInstruction::run (*this, opcode);
+				break;
+			case oiINSTCTRL:
+				InstructionControlInstruction::run (*this, opcode);
+				break;
+			case oiSCANCTRL:
+				ScanConversionControlInstruction::run (*this, opcode);
+				break;
+			case oiSCANTYPE:
+				ScanTypeInstruction::run (*this, opcode);
+				break;
+			case oiSCVTCI:
+				ControlValueCutInInstruction::run (*this, opcode);
+				break;
+			case oiSSWCI:
+				SetSingleWidthCutInInstruction::run (*this, opcode);
+				break;
+			case oiSSW:
+				SetSingleWidthInstruction::run (*this, opcode);
+				break;
+			case oiFLIPON: case oiFLIPOFF:
+				SetAutoFlipInstruction::run (*this, opcode);
+				break;
+			case oiSDB:
+				DeltaBaseInstruction::run (*this, opcode);
+				break;
+			case oiSDS:
+				DeltaShiftInstruction::run (*this, opcode);
+				break;
+			case oiGCcur: case oiGCorig:
+				GetCoordinateInstruction::run (*this, opcode);
+				break;
+			case oiSCFS:
+				SetCoordinateInstruction::run (*this, opcode);
+				break;
+
+			case oiMDcur: case oiMDorig:
+				MeasureDistanceInstruction::run (*this, opcode);
+				break;
+			case oiMPPEM:
+				MeasurePPEMInstruction::run (*this, opcode);
+				break;
+			case oiMPS:
+				MeasurePointSizeInstruction::run (*this, opcode);
+				break;
+
+			case oiFLIPPT:
+				FlipPointInstruction::run (*this, opcode);
+				break;
+			case oiFLIPRGON: case oiFLIPRGOFF:
+				FlipRangeInstruction::run (*this, opcode);
+				break;
+			case oiSHP21: case oiSHP10:
+				ShiftPointInstruction::run (*this, opcode);
+				break;
+			case oiSHC21: case oiSHC10:
+				ShiftContourInstruction::run (*this, opcode);
+				break;
+			case oiSHZ21: case oiSHZ10:
+				ShiftZoneInstruction::run (*this, opcode);
+				break;
+			case oiSHPIX:
+				ShiftPointByPixelsInstruction::run (*this, opcode);
+				break;
+			case oiMSIRP: case oiMSIRPset:
+				MoveStackIndirectRelativePointInstruction::run (*this, opcode);
+				break;
+			case oiMDAP: case oiMDAPround:
+				MoveDirectAbsolutePointInstruction::run (*this, opcode);
+				break;
+			case oiMIAP: case oiMIAPround:
+				MoveIndirectAbsolutePointInstruction::run (*this, opcode);
+				break;
+			case oiALIGN:
+				AlignInstruction::run (*this, opcode);
+				break;
+			case oiISECT:
+				MoveToIntersectionInstruction::run (*this, opcode);
+				break;
+			case oiALIGNPTS:
+				AlignPointsInstruction::run (*this, opcode);
+				break;
+			case oiIP:
+				InterpolatePointInstruction::run (*this, opcode);
+				break;
+			case oiUTP:
+				UntouchPointInstruction::run (*this, opcode);
+				break;
+			case oiIUPy: case oiIUPx:
+				InterpolateUntouchedPointsInstruction::run (*this, opcode);
+				break;
+			case oiDELTAP1: case oiDELTAP2: case oiDELTAP3:
+				DeltaPInstruction::run (*this, opcode);
+				break;
+			case oiDELTAC1: case oiDELTAC2: case oiDELTAC3:
+				DeltaCInstruction::run (*this, opcode);
+				break;
+			case oiDUP:
+				DuplicateStackElementInstruction::run (*this, opcode);
+				break;
+			case oiPOP:
+				PopInstruction::run (*this, opcode);
+				break;
+			case oiCLEAR:
+				ClearStackInstruction::run (*this, opcode);
+				break;
+			case oiSWAP:
+				SwapStackElementsInstruction::run (*this, opcode);
+				break;
+			case oiDEPTH:
+				StackDepthInstruction::run (*this, opcode);
+				break;
+			case oiCINDEX:
+				CopyIndexInstruction::run (*this, opcode);
+				break;
+			case oiMINDEX:
+				MoveIndexInstruction::run (*this, opcode);
+				break;
+			case oiROLL:
+				RollStackInstruction::run (*this, opcode);
+				break;
+
+			case oiIF:
+				if (!pop())
+					// Continue after the matching ELSE or EIF
+					next.position = instruction.argument + 1;
+				break;
+			case oiELSE:
+				next.position = instruction.argument + 1;
+				break;
+			case oiEIF:
+				break;
+			case oiJR:
+				{
+					Long b = pop();
+					Long jumpOffset = pop();
+					if (b)
+						jumpTo (next, current, instruction.offset + jumpOffset);
+				}
+				break;
+			case oiJMP:
+				{
+					Long jumpOffset = pop();
+					jumpTo (next, current, instruction.offset + jumpOffset);
+				}
+				break;
+			case oiJROF:
+				{
+					Long b = pop();
+					Long jumpOffset = pop();
+					if (!b)
+						jumpTo (next, current, instruction.offset + jumpOffset);
+				}
+				break;
+
+			case oiLT:
+				LessThanInstruction::run (*this, opcode);
+				break;
+			case oiLTEQ:
+				LessThanOrEqualInstruction::run (*this, opcode);
+				break;
+			case oiGT:
+				GreaterThanInstruction::run (*this, opcode);
+				break;
+			case oiGTEQ:
+				GreaterThanOrEqualInstruction::run (*this, opcode);
+				break;
+			case oiEQ:
+				EqualInstruction::run (*this, opcode);
+				break;
+			case oiNEQ:
+				NotEqualInstruction::run (*this, opcode);
+				break;
+			case oiODD:
+				OddInstruction::run (*this, opcode);
+				break;
+			case oiEVEN:
+				EvenInstruction::run (*this, opcode);
+				break;
+			case oiAND:
+				AndInstruction::run (*this, opcode);
+				break;
+			case oiOR:
+				OrInstruction::run (*this, opcode);
+				break;
+			case oiN:
+				NotInstruction::run (*this, opcode);
+				break;
+			case oiADD:
+				AddInstruction::run (*this, opcode);
+				break;
+			case oiSUB:
+				SubtractInstruction::run (*this, opcode);
+				break;
+			case oiDIV:
+				DivideInstruction::run (*this, opcode);
+				break;
+			case oiMUL:
+				MultiplyInstruction::run (*this, opcode);
+				break;
+			case oiABS:
+				AbsoluteInstruction::run (*this, opcode);
+				break;
+			case oiNEG:
+				NegateInstruction::run (*this, opcode);
+				break;
+			case oiFLOOR:
+				FloorInstruction::run (*this, opcode);
+				break;
+			case oiCEILING:
+				CeilingInstruction::run (*this, opcode);
+				break;
+			case oiMAX:
+				MaximumInstruction::run (*this, opcode);
+				break;
+			case oiMIN:
+				MinimumInstruction::run (*this, opcode);
+				break;
+			case oiROUND: case oiROUND + 1: case oiROUND + 2: case oiROUNDend:
+				RoundInstruction::run (*this, opcode);
+				break;
+			case oiNROUND:
+				NoRoundInstruction::run (*this, opcode);
+				break;
+
+			case oiFDEF:
+				{
+					Long id = pop();
+					if (id < 0 || id > 0xFFFF)
+						throw InstructionException ("Function identifier " + String (id) + " invalid");
+					// Continue after the ENDF
+					next.position = instruction.argument + 1;
+					defineFunction (id, current, next.position);
+				}
+				break;
+			case oiENDF:
+				returnFromFunction (next);
+				break;
+			case oiCALL:
+				callFunction (next, pop(), 0);
+				break;
+			case oiLOOPCALL:
+				{
+					Long f, count;
+					f = pop();
+					count = pop();
+					if (count > 0)
+						callFunction (next, f, count - 1);
+				}
+				break;
+			case oiIDEF:
+				InstructionDefInstruction::run (*this, opcode);
+				break;
+			case oiGETINFO:
+				GetInformationInstruction::run (*this, opcode);
+				break;
+
+			default:
+				// The ranges of opcodes; anything else is refused by decodeProgram.
+				if (opcode >= oiMIRP)
+					MoveIndirectRelativePointInstruction::run (*this, opcode);
+				else if (opcode >= oiMDRP)
+					MoveDirectRelativePointInstruction::run (*this, opcode);
+				else {
+					assert (opcode >= oiPUSHB && opcode <= oiPUSHWend);
+					checkPush (instruction.valueNum);
+					ULong end = instruction.argument + instruction.valueNum;
+					for (ULong i = instruction.argument; i < end; i ++)
+						push (current.program->values [i]);
+				}
+			}
+
+			current = next;
+
+			instructionNum ++;
+		}
+	} catch (InstructionException &e) {
+		e.setInstructionPosition (current);
+		throw e;
+	}
 }
 
 NewF26Dot6 InstructionProcessor::roundToGrid (NewF26Dot6 pos) {
@@ -458,20 +1200,210 @@ NewF26Dot6 InstructionProcessor::round (NewF26Dot6 n, NewF26Dot6 period, NewF26D
 }
 
 
-InstructionProcessor::Instructions
-InstructionProcessor::getInstructions (MemoryBlockPtr memory) {
+static void findBlockEnds (const std::vector <Byte> &opcodes, const std::vector <ULong> &offsets,
+						   std::vector <ULong> &blockEnds);
+
+void InstructionProcessor::getInstructions (InstructionStream &stream, MemoryBlockPtr memory) {
 	Exception::Context c ("reading instructions");
 
+	Instructions &instructions = stream.instructions;
+	instructions.clear();
+	stream.offsetIndex = new OffsetIndex;
+	stream.firstIndex = 0;
 	if (!memory)
-		return InstructionProcessor::Instructions ();
-	else {
-		InstructionProcessor::Instructions instructions;
-		MemoryPen pen (memory);
-		while (!pen.endOfBlock()) {
-			instructions.push_back (getOneInstruction (pen));
+		return;
+
+	std::vector <Byte> opcodes;
+	std::vector <ULong> offsets;
+	stream.offsetIndex->insert (stream.offsetIndex->end(), memory->getSize() + 1,
+		(ULong) noInstruction);
+
+	MemoryPen pen (memory);
+	while (!pen.endOfBlock()) {
+		InstructionPtr instruction = getOneInstruction (pen);
+		(*stream.offsetIndex) [instruction->getOffset()] = instructions.size();
+		opcodes.push_back (instruction->instruction);
+		offsets.push_back (instruction->getOffset());
+		instructions.push_back (instruction);
+	}
+
+	std::vector <ULong> blockEnds;
+	findBlockEnds (opcodes, offsets, blockEnds);
+	for (ULong i = 0; i < instructions.size(); i ++) {
+		Byte opcode = opcodes [i];
+		if (opcode == oiIF || opcode == oiELSE || opcode == oiFDEF)
+			static_cast <BlockInstruction &> (*instructions [i]).setBlockLength (blockEnds [i] - i);
+	}
+}
+
+// Return whether getOneInstruction knows the instruction; pushes are handled
+// separately.
+static bool isKnownInstruction (Byte instructionByte) {
+	if (instructionByte >= oiROUND && instructionByte <= oiROUNDend)
+		return true;
+	if (instructionByte >= oiMDRP)
+		return true;
+
+	switch (instructionByte) {
+	case oiRS: case oiWS: case oiWCVTP: case oiWCVTF: case oiRCVT:
+	case oiSVTCAy: case oiSVTCAx: case oiSPVTCAy: case oiSPVTCAx:
+	case oiSFVTCAy: case oiSFVTCAx: case oiSPVTL: case oiSPVTLperp:
+	case oiSFVTL: case oiSFVTLperp: case oiSFVTPV: case oiSDPVTL: case oiSDPVTLperp:
+	case oiSPVFS: case oiSFVFS: case oiGPV: case oiGFV:
+	case oiSRP0: case oiSRP1: case oiSRP2: case oiSZP0: case oiSZP1: case oiSZP2: case oiSZPS:
+	case oiRTHG: case oiRTG: case oiRTDG: case oiRDTG: case oiRUTG: case oiROFF:
+	case oiSROUND: case oiS45ROUND:
+	case oiSLOOP: case oiSMD: case oiINSTCTRL: case oiSCANCTRL: case oiSCANTYPE:
+	case oiSCVTCI: case oiSSWCI: case oiSSW: case oiFLIPON: case oiFLIPOFF:
+	case oiSDB: case oiSDS: case oiGCcur: case oiGCorig: case oiSCFS:
+	case oiMDcur: case oiMDorig: case oiMPPEM: case oiMPS:
+	case oiFLIPPT: case oiFLIPRGON: case oiFLIPRGOFF: case oiSHP21: case oiSHP10:
+	case oiSHC21: case oiSHC10: case oiSHZ21: case oiSHZ10: case oiSHPIX:
+	case oiMSIRP: case oiMSIRPset: case oiMDAP: case oiMDAPround: case oiMIAP: case oiMIAPround:
+	case oiALIGN: case oiISECT: case oiALIGNPTS: case oiIP: case oiUTP: case oiIUPy: case oiIUPx:
+	case oiDELTAP1: case oiDELTAP2: case oiDELTAP3: case oiDELTAC1: case oiDELTAC2: case oiDELTAC3:
+	case oiDUP: case oiPOP: case oiCLEAR: case oiSWAP: case oiDEPTH: case oiCINDEX: case oiMINDEX:
+	case oiROLL: case oiIF: case oiELSE: case oiEIF: case oiJR: case oiJMP: case oiJROF:
+	case oiLT: case oiLTEQ: case oiGT: case oiGTEQ: case oiEQ: case oiNEQ: case oiODD: case oiEVEN:
+	case oiAND: case oiOR: case oiN: case oiADD: case oiSUB: case oiDIV: case oiMUL:
+	case oiABS: case oiNEG: case oiFLOOR: case oiCEILING: case oiMAX: case oiMIN: case oiNROUND:
+	case oiFDEF: case oiENDF: case oiCALL: case oiLOOPCALL: case oiIDEF: case oiGETINFO:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Find for every IF and ELSE the ELSE or EIF that ends its block, and for
+// every FDEF the ENDF; blockEnds receives the index of that instruction.
+// Blocks must be nested properly: an IF block that starts inside a function
+// must end inside it, and functions are not defined inside functions.
+static void findBlockEnds (const std::vector <Byte> &opcodes, const std::vector <ULong> &offsets,
+						   std::vector <ULong> &blockEnds)
+{
+	blockEnds.clear();
+	blockEnds.insert (blockEnds.end(), opcodes.size(),
+		(ULong) InstructionProcessor::noInstruction);
+
+	// The IF or ELSE that the innermost open block started with
+	std::vector <ULong> blocks;
+	// The FDEF of the function being defined, and the number of blocks
+	// that were open outside it
+	ULong function = InstructionProcessor::noInstruction;
+	ULong outerBlockNum = 0;
+
+	for (ULong i = 0; i < opcodes.size(); i ++) {
+		switch (opcodes [i]) {
+		case oiIF:
+			blocks.push_back (i);
+			break;
+		case oiELSE:
+			if (blocks.size() == outerBlockNum)
+				throw InstructionException ("ELSE instruction at offset " +
+					String (offsets [i]) + " without IF");
+			if (opcodes [blocks.back()] == oiELSE)
+				throw InstructionException ("Stray ELSE instruction in ELSE block at offset " +
+					String (offsets [i]));
+			blockEnds [blocks.back()] = i;
+			blocks.back() = i;
+			break;
+		case oiEIF:
+			if (blocks.size() == outerBlockNum)
+				throw InstructionException ("EIF instruction at offset " +
+					String (offsets [i]) + " without IF");
+			blockEnds [blocks.back()] = i;
+			blocks.pop_back();
+			break;
+		case oiFDEF:
+			if (function != InstructionProcessor::noInstruction)
+				throw InstructionException ("FDEF instruction at offset " +
+					String (offsets [i]) + " inside function definition");
+			function = i;
+			outerBlockNum = blocks.size();
+			break;
+		case oiENDF:
+			if (function == InstructionProcessor::noInstruction)
+				throw InstructionException ("ENDF instruction at offset " +
+					String (offsets [i]) + " without FDEF");
+			if (blocks.size() != outerBlockNum)
+				throw InstructionException ("IF instruction at offset " +
+					String (offsets [blocks.back()]) + " without EIF before ENDF");
+			blockEnds [function] = i;
+			function = InstructionProcessor::noInstruction;
+			outerBlockNum = 0;
+			break;
+		}
+	}
+
+	if (function != InstructionProcessor::noInstruction)
+		throw InstructionException ("FDEF instruction at offset " +
+			String (offsets [function]) + " without ENDF");
+	if (!blocks.empty())
+		throw InstructionException ("IF instruction at offset " +
+			String (offsets [blocks.back()]) + " without EIF");
+}
+
+InstructionProcessor::DecodedProgramPtr
+InstructionProcessor::decodeProgram (MemoryBlockPtr memory, ProgramType programType) {
+	Exception::Context c ("reading instructions");
+
+	DecodedProgramPtr program = new DecodedProgram;
+	program->programType = programType;
+	if (!memory)
+		return program;
+
+	std::vector <DecodedInstruction> &instructions = program->instructions;
+	std::vector <Byte> opcodes;
+	std::vector <ULong> offsets;
+	program->offsetIndex.insert (program->offsetIndex.end(), memory->getSize() + 1,
+		(ULong) noInstruction);
+
+	MemoryPen pen (memory);
+	while (!pen.endOfBlock()) {
+		DecodedInstruction instruction;
+		// As Instruction::Instruction (MemoryPen &)
+		instruction.opcode = pen.readByte();
+		instruction.offset = pen.getPosition();
+		instruction.valueNum = 0;
+		instruction.argument = noInstruction;
+
+		Byte opcode = instruction.opcode;
+		if (opcode == oiNPUSHB || opcode == oiNPUSHW ||
+			(opcode >= oiPUSHB && opcode <= oiPUSHWend))
+		{	// As PushInstruction::PushInstruction
+			if (opcode == oiNPUSHB || opcode == oiNPUSHW)
+				instruction.valueNum = pen.readByte();
+			else
+				instruction.valueNum = (opcode & oiPUSHelementNum) + 1;
+			instruction.argument = program->values.size();
+			if (opcode == oiNPUSHB || (opcode >= oiPUSHB && opcode <= oiPUSHBend)) {
+				for (int i = 0; i < instruction.valueNum; i ++)
+					program->values.push_back (pen.readByte());
+			} else {
+				for (int i = 0; i < instruction.valueNum; i ++)
+					program->values.push_back (pen.readShort());
+			}
+		} else {
+			if (!isKnownInstruction (opcode))
+				throw InstructionException ("Unknown instruction " +
+					String (opcode));
 		}
-		return instructions;
+
+		program->offsetIndex [instruction.offset] = instructions.size();
+		instructions.push_back (instruction);
+		opcodes.push_back (opcode);
+		offsets.push_back (instruction.offset);
 	}
+
+	std::vector <ULong> blockEnds;
+	findBlockEnds (opcodes, offsets, blockEnds);
+	for (ULong i = 0; i < instructions.size(); i ++) {
+		Byte opcode = opcodes [i];
+		if (opcode == oiIF || opcode == oiELSE || opcode == oiFDEF)
+			instructions [i].argument = blockEnds [i];
+	}
+
+	return program;
 }
 
 InstructionProcessor::InstructionPtr
@@ -732,7 +1664,28 @@ String InstructionProcessor::positionToString (const InstructionPosition &positi
 		return pos;
 }
 
-String InstructionProcessor::stateToString(ProcessorState s) {
+String InstructionProcessor::positionToString (const DecodedPosition &position) {
+	String pos;
+	switch (position.program->programType) {
+	case ptFontProgram:
+		pos = "Font program";
+		break;
+	case ptCVTProgram:
+		pos = "CVT program";
+		break;
+	case ptGlyphProgram:
+		pos = "Glyph program";
+		break;
+	default:
+		assert (false);
+	}
+	if (position.position != position.end)
+		return pos + ": " + String (position.program->instructions [position.position].offset);
+	else
+		return pos;
+}
+
+const char * InstructionProcessor::stateToString(ProcessorState s) {
 	switch (s) {
 	case psFontProgram:
 		return "font program";
@@ -742,7 +1695,7 @@ String InstructionProcessor::stateToString(ProcessorState s) {
 		return "glyph program";
 	default:
 		assert (false);
-		return String();
+		return "";
 	}
 }
 
@@ -755,7 +1708,7 @@ ULong InstructionProcessor::getPointSize() {
 ULong InstructionProcessor::getPPEM() {
 	if (state != psCVTProgram && state != psGlyphProgram)
 		throw InstructionException ("Point size only known in cvt program and glyph program");
-	return weightedAverage(F18Dot14 (ppemX), F18Dot14 (ppemY),
+	return ppemAlong (ppemX, ppemY,
 		currentGraphicsState.projectionVector).round();
 }
 
@@ -770,12 +1723,8 @@ ULong InstructionProcessor::getPointNum() {
 	return points.size();
 }
 
-InstructionProcessor::InstructionIterator
-InstructionProcessor::skipNextInstruction() {
-	if (nextInstruction.position == nextInstruction.stream->instructions.end())
-		throw InstructionException ("Searching beyond instruction stream");
-	
-	return nextInstruction.position ++;
+void InstructionProcessor::skipBlock (ULong blockLength) {
+	nextInstruction.position = currentInstruction.position + blockLength + 1;
 }
 
 void InstructionProcessor::jumpTo (ULong offset) {
@@ -787,133 +1736,315 @@ void InstructionProcessor::jumpTo (ULong offset) {
 			(*instructions.begin())->getOffset() > offset ||
 			(*(instructions.end() - 1))->getOffset() < offset)
 			throw InstructionException ("Cannot jump outside of instruction stream");
-		Instructions::iterator lower, upper, guess;
-		if (offset < (*currentInstruction.position)->getOffset()) {
-			lower = instructions.begin();
-			upper = currentInstruction.position;
-		} else {
-			lower = currentInstruction.position;
-			upper = instructions.end();
-		}
-
-		while (lower != upper) {
-			guess = lower + (upper-lower)/2;
-			if ((*guess)->getOffset() < offset)
-				lower = guess + 1;
-			else {
-				if (offset < (*guess)->getOffset())
-					upper = guess;
-				else {
-					nextInstruction.position = guess;
-					return;
-				}
-			}
-		}
-
-		throw InstructionException ("Jump offset not found");
+		ULong index = (*currentInstruction.stream->offsetIndex) [offset];
+		if (index == noInstruction)
+			throw InstructionException ("Jump offset not found");
+		nextInstruction.position = instructions.begin() +
+			(index - currentInstruction.stream->firstIndex);
 	}
 }
 
-InstructionProcessor::FunctionDefinitionIterator
-InstructionProcessor::getFunction (ULong id) {
-	FunctionDefinitionIterator lower, upper, guess;
-	lower = functionDefinitions.begin();
-	upper = functionDefinitions.end();
-	guess = lower + (upper - lower) / 2;
-	while (lower != upper) {
-		guess = lower + (upper - lower) / 2;
-		if (id < guess->id)
-			upper = guess;
-		else {
-			if (guess->id < id)
-				lower = guess + 1;
-			else
-				return guess;
-		}
+// As jumpTo (ULong) for decoded programs
+void InstructionProcessor::jumpTo (DecodedPosition &next, const DecodedPosition &current, ULong offset) {
+	const std::vector <DecodedInstruction> &instructions = current.program->instructions;
+	// Instruction::getByteSize() is 1 for all instructions
+	if (instructions [current.end - 1].offset + 1 == offset)
+		next.position = current.end;
+	else {
+		if (current.begin == current.end ||
+			instructions [current.begin].offset > offset ||
+			instructions [current.end - 1].offset < offset)
+			throw InstructionException ("Cannot jump outside of instruction stream");
+
+		ULong index = current.program->offsetIndex [offset];
+		if (index == noInstruction)
+			throw InstructionException ("Jump offset not found");
+		next.position = index;
 	}
-	return guess;
 }
 
 // Sets the function to (currentInstruction, nextInstruction)
 void InstructionProcessor::defineFunction (ULong id) {
-	FunctionDefinitionIterator pos = getFunction (id);
-	if (pos != functionDefinitions.end() && pos->id == id)
+	FunctionDefinition &fd = addFunction (id);
+	fd.stream = new InstructionStream;
+	fd.stream->programType = currentInstruction.stream->programType;
+	fd.stream->instructions = Instructions (currentInstruction.position + 1, nextInstruction.position);
+	fd.stream->offsetIndex = currentInstruction.stream->offsetIndex;
+	fd.stream->firstIndex = currentInstruction.stream->firstIndex +
+		(currentInstruction.position + 1 - currentInstruction.stream->instructions.begin());
+}
+
+// Sets the function to the instructions after the current one up to end
+void InstructionProcessor::defineFunction (ULong id, const DecodedPosition &current, ULong end) {
+	FunctionDefinition &fd = addFunction (id);
+	fd.decoded = nextDecodedProgram;
+	fd.decodedBegin = current.position + 1;
+	fd.decodedEnd = end;
+}
+
+// Returns the entry for function id, which must not have been defined yet
+InstructionProcessor::FunctionDefinition & InstructionProcessor::addFunction (ULong id) {
+	if (id >= functionDefinitions.size()) {
+		FunctionDefinition undefined;
+		undefined.defined = false;
+		functionDefinitions.resize (id + 1, undefined);
+	}
+	FunctionDefinition &fd = functionDefinitions [id];
+	if (fd.defined)
 		throw InstructionException ("Function " + String (id) +
 			" has already been defined");
 
-	FunctionDefinition fd;
-	fd.id = id;
-	fd.stream.programType = currentInstruction.stream->programType;
-	fd.stream.instructions = Instructions (currentInstruction.position + 1, nextInstruction.position);
-	functionDefinitions.push_back (fd);
-
-	if (functionDefinitions.size() > font->getMaxFunctionDefs())
-		addWarning (new InstructionException ("Too many function definitions"));
+	if (id >= font->getMaxFunctionDefs())
+		addWarning (new InstructionException ("Function identifier " + String (id) +
+			" not below the maximum number of function definitions"));
+	fd.defined = true;
+	return fd;
 }
 
-void InstructionProcessor::callFunction (ULong id) {
-	FunctionDefinitionIterator pos = getFunction (id);
-	if (pos == functionDefinitions.end() || pos->id != id)
+const InstructionProcessor::FunctionDefinition & InstructionProcessor::getFunction (ULong id) {
+	if (id >= functionDefinitions.size() || !functionDefinitions [id].defined)
 		throw InstructionException ("Undefined function " +
 			String (id));
+	return functionDefinitions [id];
+}
+
+// As callFunction (ULong, ULong) for decoded programs
+void InstructionProcessor::callFunction (DecodedPosition &next, ULong id, ULong repeat) {
+	const FunctionDefinition &fd = getFunction (id);
 	// Save position
-	callStack.push_back (nextInstruction);
+	if (callDepth == decodedCallStack.size())
+		decodedCallStack.resize (callDepth + initialCallDepth);
+	DecodedReturnPosition &returnPosition = decodedCallStack [callDepth ++];
+	returnPosition.position = next;
+	returnPosition.program = nextDecodedProgram;
+	returnPosition.repeat = repeat;
 
 	// Set new position
-	nextInstruction.stream = &pos->stream;
-	nextInstruction.position = pos->stream.instructions.begin();
+	nextDecodedProgram = fd.decoded;
+	next.program = &*nextDecodedProgram;
+	next.begin = next.position = fd.decodedBegin;
+	next.end = fd.decodedEnd;
+
+	if (profiler)
+		profiler->enterFunction (id);
+}
+
+// As popFunctionCallStack() for decoded programs
+void InstructionProcessor::returnFromFunction (DecodedPosition &next) {
+	if (callDepth == 0)
+		throw InstructionException ("Function call stack empty");
+	DecodedReturnPosition &returnPosition = decodedCallStack [callDepth - 1];
+	if (returnPosition.repeat != 0) {
+		// LOOPCALL: start the function again
+		returnPosition.repeat --;
+		next.position = next.begin;
+		if (profiler)
+			profiler->repeatFunction();
+	} else {
+		next = returnPosition.position;
+		nextDecodedProgram = returnPosition.program;
+		callDepth --;
+		if (profiler)
+			profiler->leaveFunction();
+	}
+}
+
+void InstructionProcessor::callFunction (ULong id, ULong repeat) {
+	const FunctionDefinition &fd = getFunction (id);
+	// Save position
+	ReturnPosition returnPosition;
+	returnPosition.position = nextInstruction;
+	returnPosition.repeat = repeat;
+	callStack.push_back (returnPosition);
+
+	// Set new position
+	nextInstruction.stream = &*fd.stream;
+	nextInstruction.position = fd.stream->instructions.begin();
+
+	if (profiler)
+		profiler->enterFunction (id);
 }
 
 void InstructionProcessor::popFunctionCallStack() {
 	if (callStack.empty())
 		throw InstructionException ("Function call stack empty");
-	nextInstruction = callStack.back();
-	callStack.pop_back();
+	ReturnPosition &returnPosition = callStack.back();
+	if (returnPosition.repeat != 0) {
+		// LOOPCALL: start the function again
+		returnPosition.repeat --;
+		nextInstruction.position = currentInstruction.stream->instructions.begin();
+		if (profiler)
+			profiler->repeatFunction();
+	} else {
+		nextInstruction = returnPosition.position;
+		callStack.pop_back();
+		if (profiler)
+			profiler->leaveFunction();
+	}
+}
+
+/*** Stack effects ***/
+// The number of elements that every instruction pops and pushes. An
+// instruction that uses the loop variable pops that many elements more.
+// The elements pushed by PUSH instructions are checked by push(), and the
+// elements that DELTA, CINDEX and MINDEX need depend on the stack contents,
+// so these check them when they are executed.
+
+struct StackEffect {
+	Byte popNum, pushNum;
+	bool loop;
+};
+
+struct StackEffectRange {
+	Byte first, last;
+	StackEffect effect;
+};
+
+static const StackEffectRange stackEffectRanges [] = {
+	{ oiRS, oiRS, { 1, 1, false } },
+	{ oiWS, oiWS, { 2, 0, false } },
+	{ oiWCVTP, oiWCVTP, { 2, 0, false } },
+	{ oiWCVTF, oiWCVTF, { 2, 0, false } },
+	{ oiRCVT, oiRCVT, { 1, 1, false } },
+	{ oiSPVTL, oiSFVTLperp, { 2, 0, false } },
+	{ oiSDPVTL, oiSDPVTLperp, { 2, 0, false } },
+	{ oiSPVFS, oiSFVFS, { 2, 0, false } },
+	{ oiGPV, oiGFV, { 0, 2, false } },
+	{ oiSRP0, oiSZPS, { 1, 0, false } },
+	{ oiSROUND, oiS45ROUND, { 1, 0, false } },
+	{ oiSLOOP, oiSLOOP, { 1, 0, false } },
+	{ oiSMD, oiSMD, { 1, 0, false } },
+	{ oiINSTCTRL, oiINSTCTRL, { 2, 0, false } },
+	{ oiSCANCTRL, oiSCANCTRL, { 1, 0, false } },
+	{ oiSCANTYPE, oiSCANTYPE, { 1, 0, false } },
+	{ oiSCVTCI, oiSSW, { 1, 0, false } },
+	{ oiSDB, oiSDS, { 1, 0, false } },
+	{ oiGCcur, oiGCorig, { 1, 1, false } },
+	{ oiSCFS, oiSCFS, { 2, 0, false } },
+	{ oiMDcur, oiMDorig, { 2, 1, false } },
+	{ oiMPPEM, oiMPS, { 0, 1, false } },
+	{ oiFLIPPT, oiFLIPPT, { 0, 0, true } },
+	{ oiFLIPRGON, oiFLIPRGOFF, { 2, 0, false } },
+	{ oiSHP21, oiSHP10, { 0, 0, true } },
+	{ oiSHC21, oiSHZ10, { 1, 0, false } },
+	{ oiSHPIX, oiSHPIX, { 1, 0, true } },
+	{ oiMSIRP, oiMSIRPset, { 2, 0, false } },
+	{ oiMDAP, oiMDAPround, { 1, 0, false } },
+	{ oiMIAP, oiMIAPround, { 2, 0, false } },
+	{ oiMDRP, oiMDRPend, { 1, 0, false } },
+	{ oiMIRP, oiMIRPend, { 2, 0, false } },
+	{ oiALIGN, oiALIGN, { 0, 0, true } },
+	{ oiISECT, oiISECT, { 5, 0, false } },
+	{ oiALIGNPTS, oiALIGNPTS, { 2, 0, false } },
+	{ oiIP, oiIP, { 0, 0, true } },
+	{ oiUTP, oiUTP, { 1, 0, false } },
+	{ oiDELTAP1, oiDELTAP1, { 1, 0, false } },
+	{ oiDELTAP2, oiDELTAC3, { 1, 0, false } },
+	{ oiDUP, oiDUP, { 1, 2, false } },
+	{ oiPOP, oiPOP, { 1, 0, false } },
+	{ oiSWAP, oiSWAP, { 2, 2, false } },
+	{ oiDEPTH, oiDEPTH, { 0, 1, false } },
+	{ oiCINDEX, oiMINDEX, { 1, 1, false } },
+	{ oiROLL, oiROLL, { 3, 3, false } },
+	{ oiIF, oiIF, { 1, 0, false } },
+	{ oiJR, oiJROF, { 2, 0, false } },
+	{ oiJMP, oiJMP, { 1, 0, false } },
+	{ oiLT, oiNEQ, { 2, 1, false } },
+	{ oiODD, oiEVEN, { 1, 1, false } },
+	{ oiAND, oiOR, { 2, 1, false } },
+	{ oiN, oiN, { 1, 1, false } },
+	{ oiADD, oiMUL, { 2, 1, false } },
+	{ oiABS, oiCEILING, { 1, 1, false } },
+	{ oiMAX, oiMIN, { 2, 1, false } },
+	{ oiROUND, oiNROUNDend, { 1, 1, false } },
+	{ oiFDEF, oiFDEF, { 1, 0, false } },
+	{ oiCALL, oiCALL, { 1, 0, false } },
+	{ oiLOOPCALL, oiLOOPCALL, { 2, 0, false } },
+	{ oiGETINFO, oiGETINFO, { 1, 1, false } }
+};
+
+// The stack effect of every opcode; instructions that are not in
+// stackEffectRanges neither pop nor push.
+class StackEffects {
+	StackEffect effects [256];
+public:
+	StackEffects() {
+		StackEffect none = { 0, 0, false };
+		for (int i = 0; i < 256; i ++)
+			effects [i] = none;
+		for (size_t r = 0; r < sizeof (stackEffectRanges) / sizeof (StackEffectRange); r ++) {
+			const StackEffectRange &range = stackEffectRanges [r];
+			for (int i = range.first; i <= range.last; i ++)
+				effects [i] = range.effect;
+		}
+	}
+
+	const StackEffect & operator [] (Byte opcode) const {
+		return effects [opcode];
+	}
+};
+
+static const StackEffects stackEffects;
+
+void InstructionProcessor::checkStackEffect (Byte opcode) {
+	const StackEffect &effect = stackEffects [opcode];
+	if (stackSize < effect.popNum ||
+		(effect.loop && stackSize - effect.popNum < getLoop()))
+		throw InstructionException ("Stack empty");
+	if (stackSize - effect.popNum + effect.pushNum > maxStackElements)
+		stackOverflow (stackSize - effect.popNum, effect.pushNum);
+}
+
+void InstructionProcessor::checkStackEffect (const Instruction &instruction) {
+	checkStackEffect (instruction.instruction);
+}
+
+void InstructionProcessor::checkPush (ULong elementNum) {
+	if (stackSize + elementNum > maxStackElements)
+		stackOverflow (stackSize, elementNum);
 }
 
-void InstructionProcessor::push (Long element) {
-	stack.push_back (element);
-	if (stack.size() > font->getMaxStackElements())
+// Warn for every element beyond maxStackElements that pushNum elements on
+// top of size elements take, and make room for them.
+void InstructionProcessor::stackOverflow (ULong size, ULong pushNum) {
+	for (ULong newSize = std::max (size, maxStackElements) + 1; newSize <= size + pushNum; newSize ++)
 		addWarning (new InstructionException ("Too many stack elements: " +
-			String (stack.size())));
+			String (newSize)));
+	if (stack.size() < size + pushNum)
+		stack.resize (2 * (size + pushNum));
 }
 
 void InstructionProcessor::push (const std::vector <Short> &elements) {
+	checkPush (elements.size());
 	PushInstruction::Elements::const_iterator i;
 	for (i = elements.begin(); i != elements.end(); i ++)
 		push (*i);
 }
 
-Long InstructionProcessor::pop() {
-	if (stack.empty())
-		throw InstructionException ("Stack empty");
-	Long e = stack.back();
-	stack.pop_back();
-	return e;
-}
-
 Long InstructionProcessor::getNthStackElement (ULong indexFromLast) {
-	if (stack.size() <= indexFromLast)
+	if (stackSize <= indexFromLast)
 		throw InstructionException ("Cannot get " + String (indexFromLast)
 			+ "th stack element: stack is not deep enough");
-	return stack.at (stack.size() - 1 - indexFromLast);
+	return stack [stackSize - 1 - indexFromLast];
 }
 
 Long InstructionProcessor::removeNthStackElement (ULong indexFromLast) {
-	if ( stack.size() <= indexFromLast)
+	if (stackSize <= indexFromLast)
 		throw InstructionException ("Cannot get " + String (indexFromLast)
 			+ "th stack element: stack is not deep enough");
-	Long value = stack.at (stack.size() - 1 - indexFromLast);
-	stack.erase (stack.end() - 1 - indexFromLast);
+	Long *element = getStackTop() - 1 - indexFromLast;
+	Long value = *element;
+	std::copy (element + 1, getStackTop(), element);
+	stackSize --;
 	return value;
 }
 
 void InstructionProcessor::clearStack() {
-	stack.clear();
+	stackSize = 0;
 }
 
 ULong InstructionProcessor::getStackElementNum() {
-	return stack.size();
+	return stackSize;
 }
 
 void InstructionProcessor::setStorage (ULong location, Long value) {
@@ -948,20 +2079,26 @@ void InstructionProcessor::setInstructionExecutionControl(ULong mask, ULong valu
 }
 
 
-void InstructionProcessor::setFreedomVector (F18Dot14 x, F18Dot14 y) {
+void InstructionProcessor::setFreedomVector (NewF26Dot6 x, NewF26Dot6 y) {
 	assert(state != psNotActive);
 
 	setUnitVector(currentGraphicsState.freedomVector, x, y);
 }
 
-void InstructionProcessor::setProjectionVector (F18Dot14 x, F18Dot14 y) {
+void InstructionProcessor::setFreedomVector (const Vector &vector) {
+	assert(state != psNotActive);
+
+	currentGraphicsState.freedomVector = vector;
+}
+
+void InstructionProcessor::setProjectionVector (NewF26Dot6 x, NewF26Dot6 y) {
 	assert(state != psNotActive);
 
 	setUnitVector(currentGraphicsState.projectionVector, x, y);
 	setUnitVector(currentGraphicsState.dualProjectionVector, x, y);
 }
 
-void InstructionProcessor::setDualProjectionVector (F18Dot14 x, F18Dot14 y) {
+void InstructionProcessor::setDualProjectionVector (NewF26Dot6 x, NewF26Dot6 y) {
 	assert(state != psNotActive);
 
 	setUnitVector(currentGraphicsState.dualProjectionVector, x, y);
@@ -1049,52 +2186,41 @@ Long InstructionProcessor::getReferencePoint(Byte index) {
 	return currentGraphicsState.rp[index];
 }
 
-NewF26Dot6 InstructionProcessor::getPoint(ULong zone, ULong index) {
-	assert(state != psNotActive);
-
+InstructionProcessor::Zone & InstructionProcessor::getZone (ULong zone, ULong index) {
 	if (zone==0)
 	{	// Twilight zone
-		if (index < 0 || index >= twilight.size())
-			throw InstructionException ("Invalid twilight zone point index " + 
+		if (index >= twilight.size())
+			throw InstructionException ("Invalid twilight zone point index " +
 				String(index));
-
-		return projectOnto(twilight[index].currentX, twilight[index].currentY,
-			currentGraphicsState.projectionVector);
+		return twilight;
 	} else
 	{	// Normal zone
-		if (index < 0 || index >= points.size())
-			throw InstructionException ("Invalid contour point index " + 
+		if (index >= points.size())
+			throw InstructionException ("Invalid contour point index " +
 				String(index));
-
-		return projectOnto(points[index].currentX, points[index].currentY,
-			currentGraphicsState.projectionVector);
+		return points;
 	}
 }
 
+NewF26Dot6 InstructionProcessor::getPoint(ULong zone, ULong index) {
+	assert(state != psNotActive);
+
+	Zone &z = getZone (zone, index);
+	return projectOnto(z.currentX [index], z.currentY [index],
+		currentGraphicsState.projectionVector);
+}
+
 NewF26Dot6 InstructionProcessor::getOriginalPoint(ULong zone, ULong index, bool useDual) {
 	assert(state != psNotActive);
 
 	Vector dual;
-	if (useDual) 
+	if (useDual)
 		dual = currentGraphicsState.dualProjectionVector;
 	else
 		dual = currentGraphicsState.projectionVector;
 
-	if (zone==0)
-	{	// Twilight zone
-		if (index < 0 || index >= twilight.size())
-			throw InstructionException ("Invalid twilight zone point index " + 
-				String(index));
-
-		return projectOnto(twilight[index].originalX, twilight[index].originalY, dual);
-	} else
-	{	// Normal zone
-		if (index < 0 || index >= points.size())
-			throw InstructionException ("Invalid contour point index " + 
-				String(index));
-
-		return projectOnto(points[index].originalX, points[index].originalY, dual);
-	}
+	Zone &z = getZone (zone, index);
+	return projectOnto(z.originalX [index], z.originalY [index], dual);
 }
 
 void InstructionProcessor::unTouchPoint(ULong index) {
@@ -1104,9 +2230,9 @@ void InstructionProcessor::unTouchPoint(ULong index) {
 		throw InstructionException ("Points may only be untouched in the glyph program");
 
 	if (currentGraphicsState.freedomVector.x != 0)
-		points [index].touchedX = false;
+		points.flags [index] &= ~Zone::zfTouchedX;
 	if (currentGraphicsState.freedomVector.y != 0)
-		points [index].touchedY = false;
+		points.flags [index] &= ~Zone::zfTouchedY;
 }
 
 ULong InstructionProcessor::getTwilightPointNum() {
@@ -1118,11 +2244,11 @@ ULong InstructionProcessor::getTwilightPointNum() {
 ULong InstructionProcessor::getLastContourPoint(ULong contour) {
 	assert(state != psNotActive);
 
-	Points::iterator p;
-	for (p = points.begin(); p != points.end(); p ++) {
-		if (p->lastContourPoint) {
+	ULong pointNum = points.size();
+	for (ULong p = 0; p < pointNum; p ++) {
+		if (points.flags [p] & Zone::zfLastContourPoint) {
 			if (contour == 0)
-				return p - points.begin();
+				return p;
 			contour --;
 		}
 	}
@@ -1133,52 +2259,27 @@ ULong InstructionProcessor::getLastContourPoint(ULong contour) {
 void InstructionProcessor::movePoint(ULong zone, ULong index, NewF26Dot6 newPos) {
 	assert(state != psNotActive);
 
-	if ((currentGraphicsState.projectionVector.x * currentGraphicsState.freedomVector.x + 
+	if ((currentGraphicsState.projectionVector.x * currentGraphicsState.freedomVector.x +
 		currentGraphicsState.projectionVector.y * currentGraphicsState.freedomVector.y) == 0)
 		throw InstructionException (
 			"Projection and freedom vectors may not be orthogonal while moving points");
 
-	if (zone==0)
-	{	// Twilight zone
-		if (index < 0 || index >= twilight.size())
-			throw InstructionException ("Invalid twilight zone point index " + 
-				String(index));
-
-		NewF26Dot6 moveByProj =  newPos -
-			projectOnto(twilight [index].currentX, twilight [index].currentY,
-			currentGraphicsState.projectionVector);
-		NewF26Dot6 moveByFreedom = moveByProj /
-			(currentGraphicsState.projectionVector.x * currentGraphicsState.freedomVector.x +
-			currentGraphicsState.projectionVector.y * currentGraphicsState.freedomVector.y);
+	Zone &z = getZone (zone, index);
 
-		twilight [index].currentX += moveByFreedom * currentGraphicsState.freedomVector.x;
-		twilight [index].currentY += moveByFreedom * currentGraphicsState.freedomVector.y;
-		// Touch point
-		if (currentGraphicsState.freedomVector.x != 0)
-			twilight[index].touchedX = true;
-		if (currentGraphicsState.freedomVector.y != 0)
-			twilight[index].touchedY = true;
-	} else
-	{	// Normal zone
-		if (index < 0 || index >= points.size())
-			throw InstructionException ("Invalid contour point index " + 
-				String(index));
-
-		NewF26Dot6 moveByProj =  newPos -
-			projectOnto(points [index].currentX, points [index].currentY,
-			currentGraphicsState.projectionVector);
-		NewF26Dot6 moveByFreedom = moveByProj /
-			(currentGraphicsState.projectionVector.x * currentGraphicsState.freedomVector.x +
-			currentGraphicsState.projectionVector.y * currentGraphicsState.freedomVector.y);
+	NewF26Dot6 moveByProj =  newPos -
+		projectOnto(z.currentX [index], z.currentY [index],
+		currentGraphicsState.projectionVector);
+	NewF26Dot6 moveByFreedom = moveByProj /
+		(currentGraphicsState.projectionVector.x * currentGraphicsState.freedomVector.x +
+		currentGraphicsState.projectionVector.y * currentGraphicsState.freedomVector.y);
 
-		points [index].currentX += moveByFreedom * currentGraphicsState.freedomVector.x;
-		points [index].currentY += moveByFreedom * currentGraphicsState.freedomVector.y;
-		// Touch point
-		if (currentGraphicsState.freedomVector.x != 0)
-			points[index].touchedX = true;
-		if (currentGraphicsState.freedomVector.y != 0)
-			points[index].touchedY = true;
-	}
+	z.currentX [index] += moveByFreedom * currentGraphicsState.freedomVector.x;
+	z.currentY [index] += moveByFreedom * currentGraphicsState.freedomVector.y;
+	// Touch point
+	if (currentGraphicsState.freedomVector.x != 0)
+		z.flags [index] |= Zone::zfTouchedX;
+	if (currentGraphicsState.freedomVector.y != 0)
+		z.flags [index] |= Zone::zfTouchedY;
 }
 
 void InstructionProcessor::moveOriginalPointToXY (ULong zone, ULong index, NewF26Dot6 newX, NewF26Dot6 newY)
@@ -1187,12 +2288,12 @@ void InstructionProcessor::moveOriginalPointToXY (ULong zone, ULong index, NewF2
 	assert (state != psNotActive);
 	assert (zone == 0);
 
-	if (index < 0 || index >= twilight.size())
-		throw InstructionException ("Invalid twilight zone point index " + 
+	if (index >= twilight.size())
+		throw InstructionException ("Invalid twilight zone point index " +
 			String(index));
 
-	twilight [index].originalX = newX;
-	twilight [index].originalY = newY;
+	twilight.originalX [index] = newX;
+	twilight.originalY [index] = newY;
 }
 
 void InstructionProcessor::moveOriginalPoint(ULong zone, ULong index, NewF26Dot6 newPos) {
@@ -1201,90 +2302,93 @@ void InstructionProcessor::moveOriginalPoint(ULong zone, ULong index, NewF26Dot6
 	assert (state != psNotActive);
 	assert (zone == 0);
 
-	if ((currentGraphicsState.projectionVector.x * currentGraphicsState.freedomVector.x + 
+	if ((currentGraphicsState.projectionVector.x * currentGraphicsState.freedomVector.x +
 		currentGraphicsState.projectionVector.y * currentGraphicsState.freedomVector.y) == 0)
 		throw InstructionException (
 			"Projection and freedom vectors may not be orthogonal while moving points");
 
-	if (index < 0 || index >= twilight.size())
-		throw InstructionException ("Invalid twilight zone point index " + 
+	if (index >= twilight.size())
+		throw InstructionException ("Invalid twilight zone point index " +
 			String(index));
 
 	NewF26Dot6 moveByProj =  newPos -
-		projectOnto(twilight [index].originalX, twilight [index].originalY,
+		projectOnto(twilight.originalX [index], twilight.originalY [index],
 		currentGraphicsState.projectionVector);
 	NewF26Dot6 moveByFreedom = moveByProj /
 		(currentGraphicsState.projectionVector.x * currentGraphicsState.freedomVector.x +
 		currentGraphicsState.projectionVector.y * currentGraphicsState.freedomVector.y);
 
-	twilight [index].originalX += moveByFreedom * currentGraphicsState.freedomVector.x;
-	twilight [index].originalY += moveByFreedom * currentGraphicsState.freedomVector.y;
+	twilight.originalX [index] += moveByFreedom * currentGraphicsState.freedomVector.x;
+	twilight.originalY [index] += moveByFreedom * currentGraphicsState.freedomVector.y;
 }
 
 void InstructionProcessor::shiftPoint(ULong zone, ULong index, NewF26Dot6 amount, bool touch) {
 	assert(state != psNotActive);
 
-	if (zone==0)
-	{	// Twilight zone
-		if (index < 0 || index >= twilight.size())
-			throw InstructionException ("Invalid twilight zone point index " + 
-				String(index));
+	Zone &z = getZone (zone, index);
 
-		twilight [index].currentX += amount * currentGraphicsState.freedomVector.x;
-		twilight [index].currentY += amount * currentGraphicsState.freedomVector.y;
+	z.currentX [index] += amount * currentGraphicsState.freedomVector.x;
+	z.currentY [index] += amount * currentGraphicsState.freedomVector.y;
 
-		if (touch) {
-			// Touch point
-			if (currentGraphicsState.freedomVector.x != 0)
-				twilight [index].touchedX = true;
-			if (currentGraphicsState.freedomVector.y != 0)
-				twilight [index].touchedY = true;
-		}
-	} else
-	{	// Normal zone
-		if (index < 0 || index >= points.size())
-			throw InstructionException ("Invalid contour point index " + 
-				String(index));
+	if (touch) {
+		// Touch point
+		if (currentGraphicsState.freedomVector.x != 0)
+			z.flags [index] |= Zone::zfTouchedX;
+		if (currentGraphicsState.freedomVector.y != 0)
+			z.flags [index] |= Zone::zfTouchedY;
+	}
+}
 
-		points [index].currentX += amount * currentGraphicsState.freedomVector.x;
-		points [index].currentY += amount * currentGraphicsState.freedomVector.y;
+void InstructionProcessor::shiftPoints(ULong zone, ULong begin, ULong end, ULong skip,
+	NewF26Dot6 amount, bool touch)
+{
+	assert(state != psNotActive);
 
-		if (touch) {
-			// Touch point
-			if (currentGraphicsState.freedomVector.x != 0)
-				points[index].touchedX = true;
-			if (currentGraphicsState.freedomVector.y != 0)
-				points[index].touchedY = true;
-		}
+	if (begin >= end)
+		return;
+	Zone &z = getZone (zone, begin);
+	if (end > z.size())
+		// Throw for the first point that does not exist
+		getZone (zone, z.size());
+
+	// Shift along one axis at a time
+	NewF26Dot6 shiftX = amount * currentGraphicsState.freedomVector.x;
+	NewF26Dot6 shiftY = amount * currentGraphicsState.freedomVector.y;
+	Byte touched = 0;
+	if (touch) {
+		if (currentGraphicsState.freedomVector.x != 0)
+			touched |= Zone::zfTouchedX;
+		if (currentGraphicsState.freedomVector.y != 0)
+			touched |= Zone::zfTouchedY;
+	}
+
+	NewF26Dot6 *currentX = &z.currentX [0];
+	NewF26Dot6 *currentY = &z.currentY [0];
+	Byte *flags = &z.flags [0];
+	ULong i;
+	for (i = begin; i < end; i ++) {
+		if (i != skip)
+			currentX [i] += shiftX;
+	}
+	for (i = begin; i < end; i ++) {
+		if (i != skip)
+			currentY [i] += shiftY;
+	}
+	for (i = begin; i < end; i ++) {
+		if (i != skip)
+			flags [i] |= touched;
 	}
 }
 
 void InstructionProcessor::movePointToXY(ULong zone, ULong index, NewF26Dot6 newX, NewF26Dot6 newY) {
 	assert(state != psNotActive);
 
-	if (zone==0)
-	{	// Twilight zone
-		if (index < 0 || index >= twilight.size())
-			throw InstructionException ("Invalid twilight zone point index " + 
-				String(index));
-
-		twilight [index].currentX = newX;
-		twilight [index].currentY = newY;
-		// Touch point
-		twilight [index].touchedX = true;
-		twilight [index].touchedY = true;
-	} else
-	{	// Normal zone
-		if (index < 0 || index >= points.size())
-			throw InstructionException ("Invalid contour point index " + 
-				String(index));
+	Zone &z = getZone (zone, index);
 
-		points [index].currentX = newX;
-		points [index].currentY = newY;
-		// Touch point
-		points [index].touchedX = true;
-		points [index].touchedY = true;
-	}
+	z.currentX [index] = newX;
+	z.currentY [index] = newY;
+	// Touch point
+	z.flags [index] |= Zone::zfTouchedX | Zone::zfTouchedY;
 }
 
 void InstructionProcessor::setOnCurve(ULong index, bool aOnCurve) {
@@ -1294,11 +2398,14 @@ void InstructionProcessor::setOnCurve(ULong index, bool aOnCurve) {
 		throw InstructionException (
 			"Flipping the on curve state of points is possible only in the glyph program");
 
-	if (index > points.size())
+	if (index >= points.size())
 		throw InstructionException (
 			"Point index " + String (index) + " too high when flipping on curve state");
 
-	points [index].onCurve = aOnCurve;
+	if (aOnCurve)
+		points.flags [index] |= Zone::zfOnCurve;
+	else
+		points.flags [index] &= ~Zone::zfOnCurve;
 }
 
 bool InstructionProcessor::getOnCurve(ULong index) {
@@ -1307,96 +2414,39 @@ bool InstructionProcessor::getOnCurve(ULong index) {
 	if (state != psGlyphProgram)
 		throw InstructionException (
 			"Querying the on curve state of points is possible only in the glyph program");
-	
-	if (index > points.size())
+
+	if (index >= points.size())
 		throw InstructionException (
 			"Point index " + String (index) + " too high when looking at on curve state");
 
-	return points [index].onCurve;
+	return (points.flags [index] & Zone::zfOnCurve) != 0;
 }
 
 NewF26Dot6 InstructionProcessor::getPointX(ULong zone, ULong index) {
 	assert(state != psNotActive);
 
-	if (zone==0)
-	{	// Twilight zone
-		if (index < 0 || index >= twilight.size())
-			throw InstructionException ("Invalid twilight zone point index " + 
-				String(index));
-
-		return twilight [index].currentX;
-	} else
-	{	// Normal zone
-		if (index < 0 || index >= points.size())
-			throw InstructionException ("Invalid contour point index " + 
-				String(index));
-
-		return points [index].currentX;
-	}
+	return getZone (zone, index).currentX [index];
 }
 
 NewF26Dot6 InstructionProcessor::getPointY(ULong zone, ULong index) {
 	assert(state != psNotActive);
 
-	if (zone==0)
-	{	// Twilight zone
-		if (index < 0 || index >= twilight.size())
-			throw InstructionException ("Invalid twilight zone point index " + 
-				String(index));
-
-		return twilight [index].currentY;
-	} else
-	{	// Normal zone
-		if (index < 0 || index >= points.size())
-			throw InstructionException ("Invalid contour point index " + 
-				String(index));
-
-		return points [index].currentY;
-	}
+	return getZone (zone, index).currentY [index];
 }
 
 
 NewF26Dot6 InstructionProcessor::getOriginalPointX(ULong zone, ULong index) {
 	assert(state != psNotActive);
 
-	if (zone==0)
-	{	// Twilight zone
-		if (index < 0 || index >= twilight.size())
-			throw InstructionException ("Invalid twilight zone point index " + 
-				String(index));
-
-		return twilight [index].originalX;
-	} else
-	{	// Normal zone
-		if (index < 0 || index >= points.size())
-			throw InstructionException ("Invalid contour point index " + 
-				String(index));
-
-		return points[index].originalX;
-	}
+	return getZone (zone, index).originalX [index];
 }
 
 NewF26Dot6 InstructionProcessor::getOriginalPointY(ULong zone, ULong index) {
 	assert(state != psNotActive);
 
-	if (zone==0)
-	{	// Twilight zone
-		if (index < 0 || index >= twilight.size())
-			throw InstructionException ("Invalid twilight zone point index " + 
-				String(index));
-
-		return twilight [index].originalY;
-	} else
-	{	// Normal zone
-		if (index < 0 || index >= points.size())
-			throw InstructionException ("Invalid contour point index " + 
-				String(index));
-
-		return points [index].originalY;
-	}
+	return getZone (zone, index).originalY [index];
 }
 
-
 /***********
 
   Interpolating points in TrueType works thus:
@@ -1407,171 +2457,190 @@ NewF26Dot6 InstructionProcessor::getOriginalPointY(ULong zone, ULong index) {
   2. else if xp >= x2 then move xp the amount x2 has.
   3. else (if x1 < xp < x2) then move xp so that (x1-xp)/(x2-xp) remains the same.
 
+  Only the coordinates along one axis are needed, so this is done for one
+  array of original and one array of current coordinates at a time.
+
   *********/
 
-void InstructionProcessor::interpolatePointsX() {
-	assert(state != psNotActive);
+namespace {
+
+	// The type of the quotient in the interpolation below: a product of two
+	// NewF26Dot6 divided by a NewF26Dot6. It has fewer fraction bits than
+	// this suggests, because it must fit in 64 bits, so the result is
+	// rounded twice.
+	typedef util::fixed <2 * 26 + 6, 2 * 6 + 26> InterpolationQuotient;
+
+	// The two touched points that the untouched points between them are
+	// interpolated between
+	struct InterpolationRange {
+		NewF26Dot6 lowest, highest;
+		NewF26Dot6 lowestShift, highestShift;
+		NewF26Dot6 divisor;
+
+		// Within these limits the fixed-point arithmetic cannot overflow, and
+		// interpolate() does exactly the same in integers.
+		enum {
+			maxCoordinate = 1 << 24,
+			maxShift = 1 << 20,
+			quotientShift = InterpolationQuotient::fraction_bits - 6
+		};
+		bool useIntegers;
+
+		InterpolationRange (const NewF26Dot6 *original, const NewF26Dot6 *current,
+			ULong first, ULong second)
+		{
+			ULong low = first, high = second;
+			if (original [first] > original [second]) {
+				low = second;
+				high = first;
+			}
+			lowest = original [low];
+			highest = original [high];
+			lowestShift = current [low] - original [low];
+			highestShift = current [high] - original [high];
+			divisor = highest - lowest;
+
+			useIntegers = withinLimit (lowest.get_i(), maxCoordinate) &&
+				withinLimit (highest.get_i(), maxCoordinate) &&
+				withinLimit (lowestShift.get_i(), maxShift) &&
+				withinLimit (highestShift.get_i(), maxShift);
+		}
 
-	if (state!=psGlyphProgram)
-		throw InstructionException (
-			"Points can only be interpolated within the glyph program");
+		static bool withinLimit (Long i, Long limit) {
+			return -limit < i && i < limit;
+		}
 
-	Points::iterator i;
+		NewF26Dot6 interpolate (NewF26Dot6 o) const {
+			if (o <= lowest)
+				return o + lowestShift;
+			else if (o >= highest)
+				return o + highestShift;
+			else
+				return o + (lowestShift * (highest - o) +
+					highestShift * (o - lowest)) / divisor;
+		}
 
-	Points::iterator firstContourPoint;
-	Points::iterator lastContourPoint;
+		// Interpolate the points [begin, end), which are consecutive in memory
+		void interpolate (const NewF26Dot6 *original, NewF26Dot6 *current,
+			ULong begin, ULong end) const
+		{
+			if (!useIntegers) {
+				for (ULong k = begin; k < end; k ++)
+					current [k] = interpolate (original [k]);
+				return;
+			}
 
-	for (firstContourPoint = points.begin(); firstContourPoint != points.end();
-	firstContourPoint = lastContourPoint + 1) {
-		lastContourPoint = firstContourPoint;
-		while (!lastContourPoint->lastContourPoint)
-			lastContourPoint ++;
+			Long lowestI = lowest.get_i();
+			Long highestI = highest.get_i();
+			Long lowestShiftI = lowestShift.get_i();
+			Long highestShiftI = highestShift.get_i();
+			util::unsigned_long_long_int divisorI = divisor.get_i();
+			for (ULong k = begin; k < end; k ++) {
+				Long o = original [k].get_i();
+				Long shift;
+				if (o <= lowestI)
+					shift = lowestShiftI;
+				else if (o >= highestI)
+					shift = highestShiftI;
+				else {
+					// As divide_and_shift: the quotient is computed on the
+					// magnitudes, bit by bit, and the last bit is rounded.
+					LongLong dividend = LongLong (lowestShiftI) * (highestI - o) +
+						LongLong (highestShiftI) * (o - lowestI);
+					bool negative = dividend < 0;
+					util::unsigned_long_long_int magnitude = negative ? -dividend : dividend;
+					magnitude <<= quotientShift - 1;
+					util::unsigned_long_long_int quotient = magnitude / divisorI;
+					util::unsigned_long_long_int remainder = magnitude % divisorI;
+					quotient = (quotient << 1) | ((2 * remainder + divisorI / 2) / divisorI);
+					LongLong signedQuotient = negative ? - LongLong (quotient) : LongLong (quotient);
+					// Add and round to 26.6
+					current [k] = NewF26Dot6 (Long (((LongLong (o) << quotientShift) +
+						signedQuotient + (LongLong (1) << (quotientShift - 1))) >> quotientShift),
+						util::fixed_fraction());
+					continue;
+				}
+				// Leave overflows to the checked arithmetic
+				if (withinLimit (o, 1 << 30))
+					current [k] = NewF26Dot6 (o + shift, util::fixed_fraction());
+				else
+					current [k] = original [k] + NewF26Dot6 (shift, util::fixed_fraction());
+			}
+		}
+	};
 
-		i = firstContourPoint;
-		while (i <= lastContourPoint && !i->touchedX)
-			i++;
-		if (i <= lastContourPoint) {
-			Points::iterator first = i;
+	void interpolateUntouchedPoints (const NewF26Dot6 *original, NewF26Dot6 *current,
+		const Byte *flags, ULong pointNum, Byte touchedFlag)
+	{
+		ULong firstContourPoint, lastContourPoint;
+		for (firstContourPoint = 0; firstContourPoint < pointNum;
+		firstContourPoint = lastContourPoint + 1) {
+			lastContourPoint = firstContourPoint;
+			while (!(flags [lastContourPoint] & InstructionProcessor::Zone::zfLastContourPoint))
+				lastContourPoint ++;
+
+			ULong i = firstContourPoint;
+			while (i <= lastContourPoint && !(flags [i] & touchedFlag))
+				i ++;
+			if (i > lastContourPoint)
+				continue;
+
+			ULong first = i;
 			do {
-				Points::iterator second = first;
-				// Find next touched pair
+				// Find next touched point, going round the contour
+				ULong second = first;
 				do {
 					second ++;
 					if (second > lastContourPoint) {
 						second = i;
 						break;
 					}
-				} while (!second->touchedX);
-
-				// Now "first" and "second" points are touched points with inbetween
-				// untouched points in between them
-
-				if (first + 1 != second && (first != lastContourPoint || firstContourPoint != second)) {
-					Points::iterator lowest, highest;
-					if (first->originalX <= second->originalX) {
-						lowest = first;
-						highest = second;
-					} else {
-						highest = first;
-						lowest = second;
-					}
-
-					NewF26Dot6 lowestShift = lowest->currentX - lowest->originalX;
-					NewF26Dot6 highestShift = highest->currentX - highest->originalX;
-					NewF26Dot6 divisor = highest->originalX - lowest->originalX;
-
-					Points::iterator k;
-					if (first == lastContourPoint)
-						k = firstContourPoint;
-					else
-						k = first + 1;
-					while (k != second) {
-						if (k->originalX <= lowest->originalX)
-							k->currentX = k->originalX + lowestShift;
-						else {
-							if (k->originalX >= highest->originalX)
-								k->currentX = k->originalX + highestShift;
-							else {
-								k->currentX = k->originalX + 
-									(lowestShift * (highest->originalX - k->originalX) +
-									highestShift * (k->originalX - lowest->originalX))/divisor;
-							}
-						}
-						if (k == lastContourPoint)
-							k = firstContourPoint;
-						else
-							k ++;
+				} while (!(flags [second] & touchedFlag));
+
+				// The untouched points between "first" and "second" are in one
+				// piece, or in two pieces if the contour wraps around
+				// between them.
+				ULong begin = first + 1;
+				if (begin > lastContourPoint)
+					begin = firstContourPoint;
+				if (begin != second) {
+					InterpolationRange range (original, current, first, second);
+					if (begin < second)
+						range.interpolate (original, current, begin, second);
+					else {
+						range.interpolate (original, current, begin, lastContourPoint + 1);
+						range.interpolate (original, current, firstContourPoint, second);
 					}
 				}
-				
+
 				first = second;
 			} while (first != i);
 		}
 	}
 }
 
-// Same as above, except for having replaced "X" by "Y" throughout
-// Except for InstructionEyception of course
-
-void InstructionProcessor::interpolatePointsY() {
+void InstructionProcessor::interpolatePointsX() {
 	assert(state != psNotActive);
 
 	if (state!=psGlyphProgram)
 		throw InstructionException (
 			"Points can only be interpolated within the glyph program");
 
-	Points::iterator i;
-
-	Points::iterator firstContourPoint;
-	Points::iterator lastContourPoint;
+	if (!points.empty())
+		interpolateUntouchedPoints (&points.originalX [0], &points.currentX [0],
+			&points.flags [0], points.size(), Zone::zfTouchedX);
+}
 
-	for (firstContourPoint = points.begin(); firstContourPoint != points.end();
-	firstContourPoint = lastContourPoint + 1) {
-		lastContourPoint = firstContourPoint;
-		while (!lastContourPoint->lastContourPoint)
-			lastContourPoint ++;
+void InstructionProcessor::interpolatePointsY() {
+	assert(state != psNotActive);
 
-		i = firstContourPoint;
-		while (i <= lastContourPoint && !i->touchedY)
-			i++;
-		if (i <= lastContourPoint) {
-			Points::iterator first = i;
-			do {
-				Points::iterator second = first;
-				// Find neyt touched pair
-				do {
-					second ++;
-					if (second > lastContourPoint) {
-						second = i;
-						break;
-					}
-				} while (!second->touchedY);
-
-				// Now "first" and "second" points are touched points with inbetween
-				// untouched points in between them
-
-				if (first + 1 != second && (first != lastContourPoint || firstContourPoint != second)) {
-					Points::iterator lowest, highest;
-					if (first->originalY <= second->originalY) {
-						lowest = first;
-						highest = second;
-					} else {
-						highest = first;
-						lowest = second;
-					}
+	if (state!=psGlyphProgram)
+		throw InstructionException (
+			"Points can only be interpolated within the glyph program");
 
-					NewF26Dot6 lowestShift = lowest->currentY - lowest->originalY;
-					NewF26Dot6 highestShift = highest->currentY - highest->originalY;
-					NewF26Dot6 divisor = highest->originalY - lowest->originalY;
-
-					Points::iterator k;
-					if (first == lastContourPoint)
-						k = firstContourPoint;
-					else
-						k = first + 1;
-					while (k != second) {
-						if (k->originalY <= lowest->originalY)
-							k->currentY = k->originalY + lowestShift;
-						else {
-							if (k->originalY >= highest->originalY)
-								k->currentY = k->originalY + highestShift;
-							else {
-								k->currentY = k->originalY + 
-									(lowestShift * (highest->originalY - k->originalY) +
-									highestShift * (k->originalY - lowest->originalY))/divisor;
-							}
-						}
-						if (k == lastContourPoint)
-							k = firstContourPoint;
-						else
-							k ++;
-					}
-				}
-				
-				first = second;
-			} while (first != i);
-		}
-	}
+	if (!points.empty())
+		interpolateUntouchedPoints (&points.originalY [0], &points.currentY [0],
+			&points.flags [0], points.size(), Zone::zfTouchedY);
 }
 
 
@@ -1646,7 +2715,7 @@ NewF26Dot6 InstructionProcessor::getCVTValue (ULong index) {
 	}
 
 	return cvt [index].value *
-		weightedAverage (F18Dot14 (ppemX), F18Dot14 (ppemY), currentGraphicsState.projectionVector) /
+		ppemAlong (ppemX, ppemY, currentGraphicsState.projectionVector) /
 		cvt [index].ppem;
 }
 
@@ -1668,8 +2737,8 @@ void InstructionProcessor::setCVTValuePixels(ULong index, NewF26Dot6 aValue) {
 
 	cvt [index].set = true;
 	cvt [index].value = aValue.get_i();
-	cvt [index].ppem = weightedAverage(NewF26Dot6 (ppemX), NewF26Dot6 (ppemY),
-		currentGraphicsState.projectionVector).get_i();
+	cvt [index].ppem = NewF26Dot6 (ppemAlong (ppemX, ppemY,
+		currentGraphicsState.projectionVector)).get_i();
 }
 
 void InstructionProcessor::setCVTValueFUnits(ULong index, Long aValue) {
@@ -1747,4 +2816,9 @@ void InstructionException::setInstructionPosition (const InstructionProcessor::I
 	context.push_back ("at " + InstructionProcessor::positionToString (aPosition));
 }
 
+void InstructionException::setInstructionPosition (const InstructionProcessor::DecodedPosition &aPosition) {
+
+	context.push_back ("at " + InstructionProcessor::positionToString (aPosition));
+}
+
 } // end namespace OpenType
@@ -86,10 +86,18 @@ LIB32=link.exe -lib
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=.\BatchHinter.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\InstructionProcessor.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\InstructionProfiler.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Instructions.h
 # End Source File
 # End Group
@@ -98,10 +106,18 @@ SOURCE=.\Instructions.h
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=.\BatchHinter.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\InstructionProcessor.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\InstructionProfiler.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Instructions.cpp
 # End Source File
 # End Group
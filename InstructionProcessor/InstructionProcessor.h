@@ -43,6 +43,7 @@
 namespace OpenType {
 	class Instruction;
 	class InstructionException;
+	class InstructionProfiler;
 	typedef util::smart_ptr <InstructionException> InstructionExceptionPtr;
 
 	class InstructionProcessor {
@@ -59,6 +60,33 @@ namespace OpenType {
 
 		typedef std::vector <GridFittedPoint> Points;
 
+		// The points of one zone, with every coordinate in an array of its
+		// own, so that instructions that work along one axis only go
+		// through the memory for that axis.
+		struct Zone {
+			enum Flags {
+				zfOnCurve = 1, zfTouchedX = 2, zfTouchedY = 4, zfLastContourPoint = 8
+			};
+
+			std::vector <NewF26Dot6> currentX, currentY;
+			std::vector <NewF26Dot6> originalX, originalY;
+			// Flags for every point
+			std::vector <Byte> flags;
+
+			ULong size() const { return flags.size(); }
+			bool empty() const { return flags.empty(); }
+			void clear();
+			void reserve (ULong pointNum);
+			void swap (Zone &other);
+			// Replace the points by pointNum points at (0,0) with aFlags
+			void assign (ULong pointNum, Byte aFlags);
+			void push_back (const GridFittedPoint &p);
+			// Append the points [begin, end) of other
+			void append (const Zone &other, ULong begin, ULong end);
+			GridFittedPoint getPoint (ULong index) const;
+			void getPoints (Points &result) const;
+		};
+
 		typedef util::smart_ptr <Instruction> InstructionPtr;
 		typedef std::vector <InstructionPtr> Instructions;
 		typedef Instructions::iterator InstructionIterator;
@@ -71,9 +99,48 @@ namespace OpenType {
 			ptFontProgram, ptCVTProgram, ptGlyphProgram, ptUnknown
 		};
 
+		// Index of the instruction at every offset, or noInstruction
+		typedef std::vector <ULong> OffsetIndex;
+		typedef util::smart_ptr <OffsetIndex> OffsetIndexPtr;
+
+		enum { noInstruction = 0xFFFFFFFF };
+
+		/*** Decoded programs ***/
+		// Unless instruction objects are requested, programs are decoded into
+		// a flat array that executeInstructions runs with a single switch.
+		// The pushed values are kept in a separate array, and the targets of
+		// IF, ELSE and FDEF, and the instruction at every offset, are found
+		// when the program is decoded.
+
+		struct DecodedInstruction {
+			Byte opcode;
+			// PUSH: number of values
+			UShort valueNum;
+			// As Instruction::getOffset()
+			ULong offset;
+			// PUSH: index of the first value; IF, ELSE, FDEF: index of the
+			// instruction that ends the block
+			ULong argument;
+		};
+
+		struct DecodedProgram {
+			ProgramType programType;
+			std::vector <DecodedInstruction> instructions;
+			std::vector <Long> values;
+			OffsetIndex offsetIndex;
+		};
+
+		typedef util::smart_ptr <DecodedProgram> DecodedProgramPtr;
+
 		struct InstructionStream {
 			ProgramType programType;
 			Instructions instructions;
+			// The index of the instruction at every offset in the program that
+			// instructions were read from. A function shares this with that
+			// program, in which its first instruction has index firstIndex.
+			OffsetIndexPtr offsetIndex;
+			ULong firstIndex;
+			DecodedProgramPtr decoded;
 		};
 
 		struct InstructionPosition {
@@ -81,8 +148,17 @@ namespace OpenType {
 			InstructionIterator position;
 		};
 
+		// The instructions [begin, end) of a decoded program are executed;
+		// this is either the whole program or the body of a function.
+		struct DecodedPosition {
+			const DecodedProgram *program;
+			ULong begin, end;
+			ULong position;
+		};
+
 		static util::String positionToString(const InstructionPosition &p);
-		static util::String stateToString(ProcessorState s);
+		static util::String positionToString(const DecodedPosition &p);
+		static const char * stateToString(ProcessorState s);
 
 		struct StorageElement {
 			Long n;
@@ -129,30 +205,77 @@ namespace OpenType {
 	protected:
 		util::smart_ptr <OpenTypeFont> font;
 
-		Instructions getInstructions (MemoryBlockPtr memory);
+		void getInstructions (InstructionStream &stream, MemoryBlockPtr memory);
 		InstructionPtr getOneInstruction (MemoryPen &pen);
+		DecodedProgramPtr decodeProgram (MemoryBlockPtr memory, ProgramType programType);
+		void loadProgram (InstructionStream &stream, MemoryBlockPtr memory, ProgramType programType);
+
+		// A position to return to. For LOOPCALL, the function is executed
+		// repeat times more before returning.
+		struct ReturnPosition {
+			InstructionPosition position;
+			ULong repeat;
+		};
+
+		typedef std::vector <ReturnPosition> CallStack;
 
-		typedef std::vector <InstructionPosition> CallStack;
+		// As ReturnPosition for decoded programs, with the program, which is
+		// kept alive even if the call stack is left after an exception
+		struct DecodedReturnPosition {
+			DecodedPosition position;
+			DecodedProgramPtr program;
+			ULong repeat;
+		};
+
+		typedef std::vector <DecodedReturnPosition> DecodedCallStack;
 
 		typedef struct {
-			ULong id;
-			InstructionStream stream;
+			bool defined;
+			// The body of the function up to and including the ENDF, as
+			// Instruction objects; only if useInstructionObjects is set
+			util::smart_ptr <InstructionStream> stream;
+			// The body of the function in the decoded program it is in
+			DecodedProgramPtr decoded;
+			ULong decodedBegin, decodedEnd;
 		} FunctionDefinition;
 
+		// Indexed by function identifier
 		typedef std::vector <FunctionDefinition> FunctionDefinitions;
-		typedef FunctionDefinitions::iterator FunctionDefinitionIterator;
 
+		// a * vec.x + b * vec.y, rounded as NewF26Dot6 (a * vec.x + b * vec.y)
+		// would be, but in integers. As in FreeType, a vector with a
+		// component of exactly 1 is taken to be that axis, even if the
+		// other component is not quite 0.
 		static NewF26Dot6 projectOnto (NewF26Dot6 a, NewF26Dot6 b, const Vector & vec) {
-			return a * vec.x + b * vec.y;
+			if (vec.x.get_i() == 0x4000)
+				return a;
+			if (vec.y.get_i() == 0x4000)
+				return b;
+			LongLong product = LongLong (a.get_i()) * vec.x.get_i() +
+				LongLong (b.get_i()) * vec.y.get_i();
+			return NewF26Dot6 (NewF26Dot6::int_type ((product + 0x2000) >> 14), util::fixed_fraction());
 		}
 
-		static NewF26Dot6 weightedAverage (NewF26Dot6 a, NewF26Dot6 b, const Vector & vec) {
-			return NewF26Dot6 (sqrt (vec.x * vec.x * a * a + vec.y * vec.y * b * b));
+		// The size of a pixel along vec, if it is a units horizontally and b
+		// vertically: sqrt ((a*vec.x)^2 + (b*vec.y)^2), rounded to the
+		// nearest.
+		static F18Dot14 weightedAverage (ULong a, ULong b, const Vector & vec);
+
+		// The ppem along vec. For square pixels this is the ppem itself,
+		// whatever vec is, as in FreeType; otherwise it is weightedAverage.
+		static F18Dot14 ppemAlong (ULong ppemX, ULong ppemY, const Vector & vec) {
+			if (ppemX == ppemY)
+				return F18Dot14 (ppemX);
+			return weightedAverage (ppemX, ppemY, vec);
 		}
 
-		static F18Dot14 weightedAverage (F18Dot14 a, F18Dot14 b, const Vector & vec) {
-			return F18Dot14 (sqrt (vec.x * vec.x * a * a + vec.y * vec.y * b * b));
-		}
+		// The largest integer whose square is at most n
+		static util::unsigned_long_long_int squareRoot (util::unsigned_long_long_int n);
+
+		// Set vector to (x, y) scaled to unit length. This is rounded as
+		// FreeType's Normalize does, so that vectors set from points are
+		// the same as in FreeType. Only the direction of (x, y) matters.
+		static void setUnitVector (Vector &vector, NewF26Dot6 x, NewF26Dot6 y);
 
 	protected:
 		/*** Currently loaded font ***/
@@ -162,32 +285,102 @@ namespace OpenType {
 		InstructionStream glyphProgram;
 		FunctionDefinitions functionDefinitions;
 
-		FunctionDefinitionIterator getFunction (ULong id);
-
 		ULong unitsPerEm, ppemX, ppemY, pointSize;
 		Storage storage;
 		CVT cvt;
 
+		// The font program cannot measure the size, so it is executed once
+		// per font; the storage and the function definitions after that are
+		// kept.
+		bool fontProgramExecuted;
+		Storage fontProgramStorage;
+		FunctionDefinitions fontProgramFunctions;
+
+		// The state after the CVT program has been executed for a size, so
+		// that setPPEM need not execute it again for that size.
+		struct PPEMState {
+			ULong ppemX, ppemY, pointSize;
+			CVT cvt;
+			Storage storage;
+			GraphicsState graphicsState;
+			// Functions defined by the font program and the CVT program
+			FunctionDefinitions functionDefinitions;
+			// For finding the least recently used state
+			ULong lastUse;
+		};
+
+		typedef std::vector <PPEMState> PPEMStates;
+		enum { maxPPEMStates = 16 };
+		PPEMStates ppemStates;
+		ULong ppemStateUse;
+
+		void executeFontProgram();
+		void executeCVTProgram();
+
 		GraphicsState defaultGraphicsState;
 		GraphicsState currentGraphicsState;
 		void resetGraphicsState (bool initially);
-		void setUnitVector (Vector &vector, F18Dot14 x, F18Dot14 y);
-		Points points;
+		Zone points;
 
 		/*** Current processor state ***/
+		// The stack holds stackSize elements. It is allocated to hold
+		// maxStackElements elements when a program is executed, and only
+		// grows if a program pushes more than the maxp table allows.
 		std::vector <Long> stack;
+		ULong stackSize;
+		ULong maxStackElements;
 
-		Points twilight;
+		Zone twilight;
 		Points contourPoints;
 
+		// For every level of nesting of composite glyphs, the zone that the
+		// components are put together in. These keep their memory between
+		// glyphs.
+		std::vector <util::smart_ptr <Zone> > compositeZones;
+		// Glyph programs by glyph id, decoded when the glyph is first loaded
+		std::vector <DecodedProgramPtr> glyphPrograms;
+		DecodedProgramPtr emptyGlyphProgram;
+
 		ProcessorState state;
 		InstructionPosition currentInstruction;
 		InstructionPosition nextInstruction;
 		CallStack callStack;
+		// The call stack holds callDepth frames; the other frames are kept
+		// so that calling a function does not allocate memory.
+		DecodedCallStack decodedCallStack;
+		ULong callDepth;
+		enum { initialCallDepth = 16 };
+		// The decoded program that the next instruction is in
+		DecodedProgramPtr nextDecodedProgram;
+
+		// Whether programs are executed as Instruction objects, which can be
+		// stepped through, rather than as decoded programs.
+		bool useInstructionObjects;
+
+		// Where execution is recorded, or NULL
+		InstructionProfiler *profiler;
+		// The glyph whose program is executed
+		UShort currentGlyphId;
+
+		void executeInstructionObjects();
+		// Check that the stack holds the elements that an instruction pops,
+		// and that there is room for the elements that it pushes, so that
+		// push() and pop() need not check anything.
+		void checkStackEffect (Byte opcode);
+		void checkStackEffect (const Instruction &instruction);
+		void checkPush (ULong elementNum);
+		void stackOverflow (ULong size, ULong pushNum);
+		void executeDecodedProgram (const DecodedProgram &program);
+		void jumpTo (DecodedPosition &next, const DecodedPosition &current, ULong offset);
+		void defineFunction (ULong id, const DecodedPosition &current, ULong end);
+		FunctionDefinition & addFunction (ULong id);
+		const FunctionDefinition & getFunction (ULong id);
+		void returnFromFunction (DecodedPosition &next);
+		void callFunction (DecodedPosition &next, ULong id, ULong repeat);
 
 	public:
 		/*** Public methods ***/
-		InstructionProcessor();
+		InstructionProcessor (bool aUseInstructionObjects = false);
 		// Set current font
 		void setFont (util::smart_ptr <OpenTypeFont> aFont);
 		// Set font from InstructionProcessor, eliminating the instruction
@@ -196,6 +389,11 @@ namespace OpenType {
 		virtual ~InstructionProcessor();
 		void setPPEM (ULong aPPEMx, ULong aPPEMy, ULong aPointSize);
 		Points getGlyphPoints (UShort glyphId);
+		// As above, reusing the memory that points has
+		void getGlyphPoints (UShort glyphId, Points &points);
+		// Record the programs executed from now on in aProfiler, which is
+		// not owned by this, or stop recording if aProfiler is NULL
+		void setProfiler (InstructionProfiler *aProfiler);
 
 		static NewF26Dot6 roundToGrid (NewF26Dot6 pos);
 		static NewF26Dot6 round (NewF26Dot6 n, NewF26Dot6 period, NewF26Dot6 phase, NewF26Dot6 threshold);
@@ -209,7 +407,14 @@ namespace OpenType {
 		}
 
 	protected:
-		void loadGlyph (GlyphPtr glyph);
+		void loadGlyph (GlyphPtr glyph, UShort glyphId, ULong depth = 0);
+		DecodedProgramPtr getDecodedGlyphProgram (UShort glyphId, MemoryBlockPtr memory);
+		// Load and instruct a glyph, leaving its points in points
+		void instructGlyph (UShort glyphId, ULong depth);
+		// Load and instruct a glyph, leaving its points in result
+		void getGlyphZone (UShort glyphId, Zone &result);
+		// Fill the twilight zone with points at (0,0)
+		void resetTwilightZone();
 		virtual void executeInstructions(ProcessorState aState);
 
 	protected:
@@ -219,19 +424,24 @@ namespace OpenType {
 		ULong			getPointSize();
 		bool			getGreyscale();
 		ULong			getPointNum();
-		InstructionIterator
-						skipNextInstruction();
+			// Continue after the instruction that is blockLength instructions
+			// after the current one
+		void			skipBlock (ULong blockLength);
 		void			jumpTo (ULong offset);
 			// Set the function to (currentInstruction, nextInstruction)
 		void			defineFunction(ULong id);
-		void			callFunction(ULong id);
+			// Call the function, and then repeat more times
+		void			callFunction(ULong id, ULong repeat = 0);
 		void			popFunctionCallStack();
 
+			// push() and pop() are only used after checkStackEffect()
 		void			push (const std::vector <Short> &elements);
-		void			push (Long element);
+		void			push (Long element) { stack [stackSize ++] = element; }
 		void			push (NewF26Dot6 element) { push (element.get_i()); }
-		Long			pop();
+		Long			pop() { return stack [-- stackSize]; }
 		NewF26Dot6		popFixed() { return NewF26Dot6 (pop(), util::fixed_fraction()); }
+			// The element just above the top of the stack
+		Long *			getStackTop() { return &stack [0] + stackSize; }
 		Long			getNthStackElement (ULong indexFromLast);
 		Long			removeNthStackElement (ULong indexFromLast);
 		void			clearStack();
@@ -244,10 +454,11 @@ namespace OpenType {
 		ULong			getLoop();
 		void			setInstructionExecutionControl(ULong mask, ULong value);
 
-		void			setFreedomVector(F18Dot14 x, F18Dot14 y);
+		void			setFreedomVector(NewF26Dot6 x, NewF26Dot6 y);
+		void			setFreedomVector(const Vector &vector);
 			// Set both the projectionVector and the dualProjectionVector
-		void			setProjectionVector(F18Dot14 x, F18Dot14 y);
-		void			setDualProjectionVector(F18Dot14 x, F18Dot14 y);
+		void			setProjectionVector(NewF26Dot6 x, NewF26Dot6 y);
+		void			setDualProjectionVector(NewF26Dot6 x, NewF26Dot6 y);
 		Vector			getFreedomVector();
 		Vector			getProjectionVector();
 		void			setRoundingState(NewF26Dot6 aPeriod, NewF26Dot6 aPhase, NewF26Dot6 aThreshold);
@@ -278,6 +489,9 @@ namespace OpenType {
 		void			moveOriginalPoint (ULong zone, ULong index, NewF26Dot6 newPos);
 		void			moveOriginalPointToXY (ULong zone, ULong index, NewF26Dot6 newX, NewF26Dot6 newY);
 		void			shiftPoint (ULong zone, ULong index, NewF26Dot6 amount, bool touch = true);
+			// Shift the points [begin, end) except for skip
+		void			shiftPoints (ULong zone, ULong begin, ULong end, ULong skip,
+							NewF26Dot6 amount, bool touch = true);
 		void			movePointToXY (ULong zone, ULong index, NewF26Dot6 newX, NewF26Dot6 newY);
 		void			setOnCurve (ULong index, bool aOnCurve);
 		bool			getOnCurve (ULong index);
@@ -294,6 +508,8 @@ namespace OpenType {
 		NewF26Dot6		getOriginalPointY(ULong zone, ULong index);
 		void			unTouchPoint(ULong index);
 		ULong			getTwilightPointNum();
+			// Return the zone, after checking that it has a point index
+		Zone &			getZone (ULong zone, ULong index);
 
 		NewF26Dot6		compensateForColour (NewF26Dot6 n, Byte colour);
 
@@ -418,9 +634,7 @@ namespace OpenType {
 		Byte instruction;
 		ULong offset;
 
-		friend class IfInstruction;
-		friend class ElseInstruction;
-		friend class FunctionDefInstruction;
+		friend class InstructionProcessor;
 
 	public:
 						// Read data from *aBuffer and set to next instruction in instruction stream
@@ -447,6 +661,7 @@ namespace OpenType {
 		virtual ~InstructionException();
 
 		void setInstructionPosition (const InstructionProcessor::InstructionPosition &aPosition);
+		void setInstructionPosition (const InstructionProcessor::DecodedPosition &aPosition);
 	};
 }
 
@@ -0,0 +1,430 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	\file InstructionProfiler records what an InstructionProcessor executes.
+*/
+
+#ifdef _MSC_VER
+// Disable "type name to long to fit in debug information file" warning on Visual C++
+#pragma warning(disable:4786)
+#endif
+
+#include <algorithm>
+#include <ostream>
+
+#ifdef _WIN32
+// Only for QueryPerformanceCounter; keep min and max usable
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#include "InstructionProfiler.h"
+
+using util::String;
+
+namespace OpenType {
+
+namespace {
+
+	// Wall time in seconds from some fixed point
+	double getTime() {
+#ifdef _WIN32
+		LARGE_INTEGER count, frequency;
+		QueryPerformanceCounter (&count);
+		QueryPerformanceFrequency (&frequency);
+		return double (count.QuadPart) / double (frequency.QuadPart);
+#else
+		timeval time;
+		gettimeofday (&time, NULL);
+		return time.tv_sec + time.tv_usec * 1e-6;
+#endif
+	}
+
+	// Write s as a CSV field, quoting it if necessary
+	void writeCSVField (std::ostream &o, const String &s) {
+		bool quote = false;
+		int i;
+		for (i = 0; i < s.length(); i ++) {
+			if (s [i] == ',' || s [i] == '"' || s [i] == '\n')
+				quote = true;
+		}
+		if (!quote) {
+			o << s;
+			return;
+		}
+		o << '"';
+		for (i = 0; i < s.length(); i ++) {
+			if (s [i] == '"')
+				o << '"';
+			o << s [i];
+		}
+		o << '"';
+	}
+
+	void writeJSONString (std::ostream &o, const String &s) {
+		o << '"';
+		for (int i = 0; i < s.length(); i ++) {
+			char c = s [i];
+			if (c == '"' || c == '\\')
+				o << '\\' << c;
+			else if ((unsigned char) c < 0x20)
+				o << "\\u00" << "0123456789abcdef" [c >> 4] << "0123456789abcdef" [c & 0xF];
+			else
+				o << c;
+		}
+		o << '"';
+	}
+
+	const char * opcodeNames [256] = {
+		/* 0x00 */ "SVTCA", "SVTCA", "SPVTCA", "SPVTCA", "SFVTCA", "SFVTCA", "SPVTL", "SPVTL",
+		/* 0x08 */ "SFVTL", "SFVTL", "SPVFS", "SFVFS", "GPV", "GFV", "SFVTPV", "ISECT",
+		/* 0x10 */ "SRP0", "SRP1", "SRP2", "SZP0", "SZP1", "SZP2", "SZPS", "SLOOP",
+		/* 0x18 */ "RTG", "RTHG", "SMD", "ELSE", "JMPR", "SCVTCI", "SSWCI", "SSW",
+		/* 0x20 */ "DUP", "POP", "CLEAR", "SWAP", "DEPTH", "CINDEX", "MINDEX", "ALIGNPTS",
+		/* 0x28 */ NULL, "UTP", "LOOPCALL", "CALL", "FDEF", "ENDF", "MDAP", "MDAP",
+		/* 0x30 */ "IUP", "IUP", "SHP", "SHP", "SHC", "SHC", "SHZ", "SHZ",
+		/* 0x38 */ "SHPIX", "IP", "MSIRP", "MSIRP", "ALIGNRP", "RTDG", "MIAP", "MIAP",
+		/* 0x40 */ "NPUSHB", "NPUSHW", "WS", "RS", "WCVTP", "RCVT", "GC", "GC",
+		/* 0x48 */ "SCFS", "MD", "MD", "MPPEM", "MPS", "FLIPON", "FLIPOFF", "DEBUG",
+		/* 0x50 */ "LT", "LTEQ", "GT", "GTEQ", "EQ", "NEQ", "ODD", "EVEN",
+		/* 0x58 */ "IF", "EIF", "AND", "OR", "NOT", "DELTAP1", "SDB", "SDS",
+		/* 0x60 */ "ADD", "SUB", "DIV", "MUL", "ABS", "NEG", "FLOOR", "CEILING",
+		/* 0x68 */ "ROUND", "ROUND", "ROUND", "ROUND", "NROUND", "NROUND", "NROUND", "NROUND",
+		/* 0x70 */ "WCVTF", "DELTAP2", "DELTAP3", "DELTAC1", "DELTAC2", "DELTAC3", "SROUND", "S45ROUND",
+		/* 0x78 */ "JROT", "JROF", "ROFF", NULL, "RUTG", "RDTG", "SANGW", "AA",
+		/* 0x80 */ "FLIPPT", "FLIPRGON", "FLIPRGOFF", NULL, NULL, "SCANCTRL", "SDPVTL", "SDPVTL",
+		/* 0x88 */ "GETINFO", "IDEF", "ROLL", "MAX", "MIN", "SCANTYPE", "INSTCTRL", NULL,
+		/* 0x90 */ NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+		/* 0x98 */ NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+		/* 0xA0 */ NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+		/* 0xA8 */ NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+		/* 0xB0 */ "PUSHB", "PUSHB", "PUSHB", "PUSHB", "PUSHB", "PUSHB", "PUSHB", "PUSHB",
+		/* 0xB8 */ "PUSHW", "PUSHW", "PUSHW", "PUSHW", "PUSHW", "PUSHW", "PUSHW", "PUSHW",
+		/* 0xC0 */ "MDRP", "MDRP", "MDRP", "MDRP", "MDRP", "MDRP", "MDRP", "MDRP",
+		/* 0xC8 */ "MDRP", "MDRP", "MDRP", "MDRP", "MDRP", "MDRP", "MDRP", "MDRP",
+		/* 0xD0 */ "MDRP", "MDRP", "MDRP", "MDRP", "MDRP", "MDRP", "MDRP", "MDRP",
+		/* 0xD8 */ "MDRP", "MDRP", "MDRP", "MDRP", "MDRP", "MDRP", "MDRP", "MDRP",
+		/* 0xE0 */ "MIRP", "MIRP", "MIRP", "MIRP", "MIRP", "MIRP", "MIRP", "MIRP",
+		/* 0xE8 */ "MIRP", "MIRP", "MIRP", "MIRP", "MIRP", "MIRP", "MIRP", "MIRP",
+		/* 0xF0 */ "MIRP", "MIRP", "MIRP", "MIRP", "MIRP", "MIRP", "MIRP", "MIRP",
+		/* 0xF8 */ "MIRP", "MIRP", "MIRP", "MIRP", "MIRP", "MIRP", "MIRP", "MIRP"
+	};
+}
+
+/*** Key ***/
+
+bool InstructionProfiler::Key::operator < (const Key &other) const {
+	if (program != other.program)
+		return program < other.program;
+	if (glyphId != other.glyphId)
+		return glyphId < other.glyphId;
+	if (ppemX != other.ppemX)
+		return ppemX < other.ppemX;
+	if (ppemY != other.ppemY)
+		return ppemY < other.ppemY;
+	return pointSize < other.pointSize;
+}
+
+/*** InstructionProfiler ***/
+
+InstructionProfiler::InstructionProfiler() : running (false) {
+	clear();
+}
+
+void InstructionProfiler::setFunctionName (ULong id, const String &name) {
+	if (id >= functionNames.size())
+		functionNames.resize (id + 1);
+	functionNames [id] = name;
+}
+
+// Forget everything that has been recorded, but not the function names
+void InstructionProfiler::clear() {
+	assert (!running);
+	records.clear();
+
+	// The roots of the call stacks
+	StackNode root;
+	root.function = noFunction;
+	root.parent = noFunction;
+	root.instructions = 0;
+	stacks.assign (InstructionProcessor::psGlyphProgram + 1, root);
+
+	stackInstructions = 0;
+	callCounts.clear();
+	calledFunctions.clear();
+}
+
+void InstructionProfiler::beginProgram (InstructionProcessor::ProcessorState program,
+		ULong glyphId, ULong ppemX, ULong ppemY, ULong pointSize) {
+	assert (!running);
+	current.program = program;
+	current.glyphId = glyphId;
+	current.ppemX = ppemX;
+	current.ppemY = ppemY;
+	current.pointSize = pointSize;
+
+	std::fill (opcodeCounts, opcodeCounts + 256, 0);
+	stackInstructions = 0;
+	currentStack = program;
+	running = true;
+	startTime = getTime();
+}
+
+// Add the run that has just finished to its record. This is also called if
+// the program was aborted by an exception.
+void InstructionProfiler::endProgram() {
+	double seconds = getTime() - startTime;
+	assert (running);
+	running = false;
+	flushStack();
+
+	Record run;
+	run.runs = 1;
+	run.instructions = 0;
+	run.seconds = seconds;
+	Count count;
+	ULong i;
+	for (i = 0; i < 256; i ++) {
+		if (opcodeCounts [i]) {
+			run.instructions += opcodeCounts [i];
+			count.id = i;
+			count.count = opcodeCounts [i];
+			run.opcodes.push_back (count);
+		}
+	}
+	std::sort (calledFunctions.begin(), calledFunctions.end());
+	for (i = 0; i < calledFunctions.size(); i ++) {
+		count.id = calledFunctions [i];
+		count.count = callCounts [count.id];
+		callCounts [count.id] = 0;
+		run.calls.push_back (count);
+	}
+	calledFunctions.clear();
+
+	Records::iterator record = records.find (current);
+	if (record == records.end())
+		records.insert (Records::value_type (current, run));
+	else {
+		record->second.runs ++;
+		record->second.instructions += run.instructions;
+		record->second.seconds += run.seconds;
+		addCounts (record->second.calls, run.calls);
+		addCounts (record->second.opcodes, run.opcodes);
+	}
+}
+
+// Add the sorted counts added to the sorted counts
+void InstructionProfiler::addCounts (Counts &counts, const Counts &added) {
+	Counts result;
+	result.reserve (counts.size() + added.size());
+	Counts::const_iterator i = counts.begin(), j = added.begin();
+	while (i != counts.end() || j != added.end()) {
+		if (j == added.end() || (i != counts.end() && i->id < j->id))
+			result.push_back (*i++);
+		else if (i == counts.end() || j->id < i->id)
+			result.push_back (*j++);
+		else {
+			Count sum = *i++;
+			sum.count += j++->count;
+			result.push_back (sum);
+		}
+	}
+	counts.swap (result);
+}
+
+void InstructionProfiler::flushStack() {
+	stacks [currentStack].instructions += stackInstructions;
+	stackInstructions = 0;
+}
+
+void InstructionProfiler::countCall (ULong id) {
+	if (id >= callCounts.size())
+		callCounts.resize (id + 1, 0);
+	if (callCounts [id] ++ == 0)
+		calledFunctions.push_back (id);
+}
+
+void InstructionProfiler::enterFunction (ULong id) {
+	flushStack();
+	countCall (id);
+
+	std::map <ULong, ULong>::iterator child = stacks [currentStack].children.find (id);
+	if (child != stacks [currentStack].children.end())
+		currentStack = child->second;
+	else {
+		StackNode node;
+		node.function = id;
+		node.parent = currentStack;
+		node.instructions = 0;
+		ULong nodeIndex = stacks.size();
+		stacks.push_back (node);
+		stacks [currentStack].children [id] = nodeIndex;
+		currentStack = nodeIndex;
+	}
+}
+
+void InstructionProfiler::repeatFunction() {
+	if (stacks [currentStack].function != noFunction)
+		countCall (stacks [currentStack].function);
+}
+
+void InstructionProfiler::leaveFunction() {
+	flushStack();
+	if (stacks [currentStack].function != noFunction)
+		currentStack = stacks [currentStack].parent;
+}
+
+/*** Names ***/
+
+const char * InstructionProfiler::getProgramName (InstructionProcessor::ProcessorState program) {
+	switch (program) {
+	case InstructionProcessor::psFontProgram:
+		return "fpgm";
+	case InstructionProcessor::psCVTProgram:
+		return "prep";
+	case InstructionProcessor::psGlyphProgram:
+		return "glyf";
+	default:
+		assert (false);
+		return "";
+	}
+}
+
+const char * InstructionProfiler::getOpcodeName (Byte opcode) {
+	return opcodeNames [opcode];
+}
+
+String InstructionProfiler::getFunctionName (ULong id) const {
+	if (id < functionNames.size() && !functionNames [id].empty())
+		return functionNames [id];
+	return String ("function ") + String (id);
+}
+
+// The names of the programs and functions in the stack, separated by ';'
+String InstructionProfiler::getStackName (ULong stack) const {
+	if (stacks [stack].function == noFunction)
+		return getProgramName (InstructionProcessor::ProcessorState (stack));
+	return getStackName (stacks [stack].parent) + ';' +
+		getFunctionName (stacks [stack].function);
+}
+
+/*** Output ***/
+
+void InstructionProfiler::writeCSV (std::ostream &o) const {
+	o << "program,glyph,ppem_x,ppem_y,point_size,counter,key,name,value\n";
+	Records::const_iterator record;
+	for (record = records.begin(); record != records.end(); record ++) {
+		const Key &key = record->first;
+		const Record &r = record->second;
+
+		String prefix = String (getProgramName (key.program)) + ',';
+		if (key.glyphId != noGlyph)
+			prefix += String (key.glyphId);
+		prefix += ',';
+		prefix += String (key.ppemX) + ',' + String (key.ppemY) + ',' +
+			String (key.pointSize) + ',';
+
+		o << prefix << "runs,,," << r.runs << '\n';
+		o << prefix << "instructions,,," << r.instructions << '\n';
+		o << prefix << "seconds,,," << r.seconds << '\n';
+		Counts::const_iterator count;
+		for (count = r.calls.begin(); count != r.calls.end(); count ++) {
+			o << prefix << "calls," << count->id << ',';
+			writeCSVField (o, getFunctionName (count->id));
+			o << ',' << count->count << '\n';
+		}
+		for (count = r.opcodes.begin(); count != r.opcodes.end(); count ++) {
+			const char *name = getOpcodeName (Byte (count->id));
+			o << prefix << "opcode," << count->id << ',' << (name ? name : "") <<
+				',' << count->count << '\n';
+		}
+	}
+}
+
+void InstructionProfiler::writeJSON (std::ostream &o) const {
+	o << "{\n\t\"functions\": [";
+	ULong i;
+	bool first = true;
+	for (i = 0; i < functionNames.size(); i ++) {
+		if (functionNames [i].empty())
+			continue;
+		o << (first ? "\n" : ",\n") << "\t\t{\"id\": " << i << ", \"name\": ";
+		writeJSONString (o, functionNames [i]);
+		o << "}";
+		first = false;
+	}
+	o << "\n\t],\n\t\"records\": [";
+
+	Records::const_iterator record;
+	for (record = records.begin(); record != records.end(); record ++) {
+		const Key &key = record->first;
+		const Record &r = record->second;
+
+		o << (record == records.begin() ? "\n" : ",\n");
+		o << "\t\t{\"program\": \"" << getProgramName (key.program) << "\", \"glyph\": ";
+		if (key.glyphId != noGlyph)
+			o << key.glyphId;
+		else
+			o << "null";
+		o << ", \"ppemX\": " << key.ppemX << ", \"ppemY\": " << key.ppemY <<
+			", \"pointSize\": " << key.pointSize << ",\n";
+		o << "\t\t\t\"runs\": " << r.runs << ", \"instructions\": " << r.instructions <<
+			", \"seconds\": " << r.seconds << ",\n";
+
+		o << "\t\t\t\"calls\": [";
+		Counts::const_iterator count;
+		for (count = r.calls.begin(); count != r.calls.end(); count ++) {
+			o << (count == r.calls.begin() ? "" : ", ") << "{\"id\": " << count->id << ", \"name\": ";
+			writeJSONString (o, getFunctionName (count->id));
+			o << ", \"count\": " << count->count << "}";
+		}
+		o << "],\n\t\t\t\"opcodes\": [";
+		for (count = r.opcodes.begin(); count != r.opcodes.end(); count ++) {
+			const char *name = getOpcodeName (Byte (count->id));
+			o << (count == r.opcodes.begin() ? "" : ", ") << "{\"opcode\": " << count->id <<
+				", \"name\": ";
+			if (name)
+				o << '"' << name << '"';
+			else
+				o << "null";
+			o << ", \"count\": " << count->count << "}";
+		}
+		o << "]}";
+	}
+	o << "\n\t]\n}\n";
+}
+
+void InstructionProfiler::writeFoldedStacks (std::ostream &o) const {
+	for (ULong i = 0; i < stacks.size(); i ++) {
+		if (stacks [i].instructions != 0)
+			o << getStackName (i) << ' ' << stacks [i].instructions << '\n';
+	}
+}
+
+}	// end namespace OpenType
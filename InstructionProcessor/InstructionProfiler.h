@@ -0,0 +1,153 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	InstructionProfiler records what an InstructionProcessor executes: for
+	every program run (the font program, the CVT program at every size, and
+	every glyph program at every size) the number of instructions, the wall
+	time, the number of calls to every function and the number of times
+	every opcode was executed. It also keeps the number of instructions
+	executed in every function call stack, which can be written out in the
+	"folded stacks" format that flame graph tools read.
+*/
+
+#ifndef OTINSTRUCTIONPROFILER_H
+#define OTINSTRUCTIONPROFILER_H
+
+#include <vector>
+#include <map>
+#include <iosfwd>
+
+#include "../Util/String.h"
+#include "InstructionProcessor.h"
+
+namespace OpenType {
+	class InstructionProfiler {
+	public:
+		enum { noGlyph = 0xFFFFFFFF, noFunction = 0xFFFFFFFF };
+
+		// The program, glyph and size that a record is for. glyphId is
+		// noGlyph for the font program and the CVT program.
+		struct Key {
+			InstructionProcessor::ProcessorState program;
+			ULong glyphId;
+			ULong ppemX, ppemY, pointSize;
+
+			bool operator < (const Key &other) const;
+		};
+
+		struct Count {
+			ULong id;
+			ULong count;
+		};
+
+		typedef std::vector <Count> Counts;
+
+		struct Record {
+			// The number of times the program was executed
+			ULong runs;
+			ULong instructions;
+			double seconds;
+			// Sorted by function identifier and by opcode
+			Counts calls;
+			Counts opcodes;
+		};
+
+		typedef std::map <Key, Record> Records;
+
+	private:
+		// A function call stack, as a node in a tree of stacks. The roots
+		// are the programs, indexed by ProcessorState.
+		struct StackNode {
+			ULong function;
+			ULong parent;
+			// Instructions executed in this stack, not counting functions
+			// called from it
+			ULong instructions;
+			std::map <ULong, ULong> children;
+		};
+
+		std::vector <util::String> functionNames;
+		Records records;
+		std::vector <StackNode> stacks;
+
+		// The program being executed
+		bool running;
+		Key current;
+		double startTime;
+		ULong currentStack;
+		ULong opcodeCounts [256];
+		// Instructions executed in currentStack that have not been added
+		// to it yet
+		ULong stackInstructions;
+		// Calls by function identifier, and the identifiers that are not 0
+		std::vector <ULong> callCounts;
+		std::vector <ULong> calledFunctions;
+
+		void flushStack();
+		void countCall (ULong id);
+		static void addCounts (Counts &counts, const Counts &added);
+		util::String getFunctionName (ULong id) const;
+		util::String getStackName (ULong stack) const;
+
+	public:
+		InstructionProfiler();
+
+		// Name function id after the TTI function it was compiled from
+		void setFunctionName (ULong id, const util::String &name);
+		void clear();
+
+		// Called by InstructionProcessor for every program it executes.
+		void beginProgram (InstructionProcessor::ProcessorState program, ULong glyphId,
+			ULong ppemX, ULong ppemY, ULong pointSize);
+		void endProgram();
+
+		// Called by InstructionProcessor for every instruction it executes
+		void countInstruction (Byte opcode) {
+			opcodeCounts [opcode] ++;
+			stackInstructions ++;
+		}
+		void enterFunction (ULong id);
+		// LOOPCALL executes the function on top of the call stack again
+		void repeatFunction();
+		void leaveFunction();
+
+		const Records & getRecords() const { return records; }
+
+		// One line per counter, with the columns
+		// program,glyph,ppem_x,ppem_y,point_size,counter,key,name,value
+		// where counter is "runs", "instructions" or "seconds" with an empty
+		// key, "calls" with the function identifier as key, or "opcode" with
+		// the opcode as key.
+		void writeCSV (std::ostream &o) const;
+		// The same, as an array of objects, one for each record
+		void writeJSON (std::ostream &o) const;
+		// One line per call stack, with the functions separated by ';' and
+		// the number of instructions executed in it
+		void writeFoldedStacks (std::ostream &o) const;
+
+		static const char * getProgramName (InstructionProcessor::ProcessorState program);
+		// The mnemonic for opcode, or NULL if it is not an instruction
+		static const char * getOpcodeName (Byte opcode);
+	};
+}
+
+#endif // OTINSTRUCTIONPROFILER_H
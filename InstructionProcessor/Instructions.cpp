@@ -24,6 +24,7 @@
 */
 
 #include <cassert>
+#include <algorithm>
 
 #include "../OTFont/OTMemoryBlock.h"
 
@@ -182,6 +183,10 @@ String PushInstruction::getName() const {
 /*** The RS instruction ***/
 
 void ReadStoreInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void ReadStoreInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.push(proc.getStorage(proc.pop()));
 }
 
@@ -192,6 +197,10 @@ String ReadStoreInstruction::getName() const {
 /*** The WS instruction ***/
 
 void WriteStoreInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void WriteStoreInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long value = proc.pop();
 	Long location = proc.pop();
 	proc.setStorage(location, value);
@@ -204,6 +213,10 @@ String WriteStoreInstruction::getName() const {
 /*** The WCVTP instruction ***/
 
 void WriteCVTPixelsInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void WriteCVTPixelsInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	NewF26Dot6 value = proc.popFixed();
 	Long location = proc.pop();
 	proc.setCVTValuePixels(location, value);
@@ -216,6 +229,10 @@ String WriteCVTPixelsInstruction::getName() const {
 /*** The WCVTF instruction ***/
 
 void WriteCVTFUnitsInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void WriteCVTFUnitsInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long value = proc.pop();
 	Long location = proc.pop();
 	proc.setCVTValueFUnits(location, value);
@@ -228,6 +245,10 @@ String WriteCVTFUnitsInstruction::getName() const {
 /*** The RCVT instruction ***/
 
 void ReadCVTInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void ReadCVTInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.push(proc.getCVTValue(proc.pop()));
 }
 
@@ -243,6 +264,10 @@ String ReadCVTInstruction::getName() const {
 VectorsToAxisInstruction::VectorsToAxisInstruction(bool x) : Instruction(x ? oiSVTCAx : oiSVTCAy) {}
 
 void VectorsToAxisInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void VectorsToAxisInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	if (instruction == oiSVTCAy) {
 		proc.setFreedomVector(0, 1);
 		proc.setProjectionVector(0, 1);
@@ -261,6 +286,10 @@ String VectorsToAxisInstruction::getName() const {
 ProjectionToAxisInstruction::ProjectionToAxisInstruction(bool x) : Instruction(x ? oiSPVTCAx : oiSPVTCAy) {}
 
 void ProjectionToAxisInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void ProjectionToAxisInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	if (instruction == oiSPVTCAy)
 		// y axis
 		proc.setProjectionVector(0, 1);
@@ -277,6 +306,10 @@ String ProjectionToAxisInstruction::getName() const {
 FreedomToAxisInstruction::FreedomToAxisInstruction(bool x) : Instruction(x ? oiSFVTCAx : oiSFVTCAy) {}
 
 void FreedomToAxisInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void FreedomToAxisInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	if (instruction == oiSFVTCAy)
 		// y axis
 		proc.setFreedomVector(0, 1);
@@ -294,6 +327,10 @@ ProjectionToLineInstruction::ProjectionToLineInstruction(bool perp) :
 Instruction(perp ? oiSPVTLperp : oiSPVTL) {}
 
 void ProjectionToLineInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void ProjectionToLineInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	// zp1 and zp2 are reversed (making zp1 belong to p1 and zp2 to p2)
 	Long p1 = proc.pop();
 	Long p2 = proc.pop();
@@ -325,6 +362,10 @@ FreedomToLineInstruction::FreedomToLineInstruction(bool perp) :
 Instruction(perp? oiSFVTLperp : oiSFVTL) {}
 
 void FreedomToLineInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void FreedomToLineInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	// zp1 and zp2 are reversed (making zp1 belong to p1 and zp2 to p2)
 	Long p1 = proc.pop();
 	Long p2 = proc.pop();
@@ -355,8 +396,11 @@ String FreedomToLineInstruction::getName() const {
 FreedomToProjectionInstruction::FreedomToProjectionInstruction() : Instruction(oiSFVTPV) {}
 
 void FreedomToProjectionInstruction::execute (InstructionProcessor &proc) const {
-	InstructionProcessor::Vector proj = proc.getProjectionVector();
-	proc.setFreedomVector (proj.x, proj.y);
+	run (proc, instruction);
+}
+
+void FreedomToProjectionInstruction::run (InstructionProcessor &proc, Byte instruction) {
+	proc.setFreedomVector (proc.getProjectionVector());
 }
 
 String FreedomToProjectionInstruction::getName() const {
@@ -369,6 +413,10 @@ DualProjectionToLineInstruction::DualProjectionToLineInstruction(bool perp) :
 Instruction(perp ? oiSDPVTLperp : oiSDPVTL) {}
 
 void DualProjectionToLineInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void DualProjectionToLineInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	// zp1 and zp2 are reversed (making zp1 belong to p1 and zp2 to p2)
 	Long p1 = proc.pop();
 	Long p2 = proc.pop();
@@ -404,9 +452,14 @@ String DualProjectionToLineInstruction::getName() const {
 ProjectionFromStackInstruction::ProjectionFromStackInstruction() : Instruction(oiSPVFS) {}
 
 void ProjectionFromStackInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void ProjectionFromStackInstruction::run (InstructionProcessor &proc, Byte instruction) {
+	// Only the low 16 bits are used, as in FreeType
 	NewF26Dot6 y, x;
-	y = proc.popFixed();
-	x = proc.popFixed();
+	y = NewF26Dot6 (Short (proc.pop()), fixed_fraction());
+	x = NewF26Dot6 (Short (proc.pop()), fixed_fraction());
 	proc.setProjectionVector(x, y);
 }
 
@@ -419,9 +472,14 @@ String ProjectionFromStackInstruction::getName() const {
 FreedomFromStackInstruction::FreedomFromStackInstruction() : Instruction(oiSFVFS) {}
 
 void FreedomFromStackInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void FreedomFromStackInstruction::run (InstructionProcessor &proc, Byte instruction) {
+	// Only the low 16 bits are used, as in FreeType
 	NewF26Dot6 y, x;
-	y = proc.popFixed();
-	x = proc.popFixed();
+	y = NewF26Dot6 (Short (proc.pop()), fixed_fraction());
+	x = NewF26Dot6 (Short (proc.pop()), fixed_fraction());
 	proc.setFreedomVector(x, y);
 }
 
@@ -432,6 +490,10 @@ String FreedomFromStackInstruction::getName() const {
 /*** The GPV instruction ***/
 
 void GetProjectionVectorInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void GetProjectionVectorInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	InstructionProcessor::Vector proj = proc.getProjectionVector();
 	proc.push (proj.x.get_i());
 	proc.push (proj.y.get_i());
@@ -444,6 +506,10 @@ String GetProjectionVectorInstruction::getName() const {
 /*** The GFV instruction ***/
 
 void GetFreedomVectorInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void GetFreedomVectorInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	InstructionProcessor::Vector freedom = proc.getFreedomVector();
 	proc.push (freedom.x.get_i());
 	proc.push (freedom.y.get_i());
@@ -460,6 +526,10 @@ SetReferencePointInstruction::SetReferencePointInstruction(Byte rp) : Instructio
 }
 
 void SetReferencePointInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void SetReferencePointInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.setReferencePoint(instruction - oiSRP0, proc.pop());
 }
 
@@ -474,6 +544,10 @@ SetZonePointerInstruction::SetZonePointerInstruction(Byte zp) : Instruction(oiSZ
 }
 
 void SetZonePointerInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void SetZonePointerInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.setZonePointer(instruction - oiSZP0, proc.pop());
 }
 
@@ -484,6 +558,10 @@ String SetZonePointerInstruction::getName() const {
 /*** The SZPS instruction ***/
 
 void SetZonePointersInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void SetZonePointersInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long zone = proc.pop();
 	proc.setZonePointer(0, zone);
 	proc.setZonePointer(1, zone);
@@ -499,6 +577,10 @@ String SetZonePointersInstruction::getName() const {
 RoundToHalfGridInstruction::RoundToHalfGridInstruction() : Instruction(oiRTHG) {}
 
 void RoundToHalfGridInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void RoundToHalfGridInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.setRoundingState(1, NewF26Dot6 (.5), NewF26Dot6 (.5));
 }
 
@@ -511,6 +593,10 @@ String RoundToHalfGridInstruction::getName() const {
 RoundToGridInstruction::RoundToGridInstruction() : Instruction(oiRTG) {}
 
 void RoundToGridInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void RoundToGridInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.setRoundingState(1, 0, NewF26Dot6 (.5));
 }
 
@@ -523,6 +609,10 @@ String RoundToGridInstruction::getName() const {
 RoundToDoubleGridInstruction::RoundToDoubleGridInstruction() : Instruction(oiRTDG) {}
 
 void RoundToDoubleGridInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void RoundToDoubleGridInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.setRoundingState(NewF26Dot6 (.5), 0, NewF26Dot6 (.25));
 }
 
@@ -535,6 +625,10 @@ String RoundToDoubleGridInstruction::getName() const {
 RoundDownToGridInstruction::RoundDownToGridInstruction() : Instruction(oiRDTG) {}
 
 void RoundDownToGridInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void RoundDownToGridInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.setRoundingState(1, 0, 0);
 }
 
@@ -547,6 +641,10 @@ String RoundDownToGridInstruction::getName() const {
 RoundUpToGridInstruction::RoundUpToGridInstruction() : Instruction(oiRUTG) {}
 
 void RoundUpToGridInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void RoundUpToGridInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.setRoundingState(1, 0, 1 - NewF26Dot6 (1, fixed_fraction()));
 }
 
@@ -559,6 +657,10 @@ String RoundUpToGridInstruction::getName() const {
 RoundOffInstruction::RoundOffInstruction() : Instruction(oiROFF) {}
 
 void RoundOffInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void RoundOffInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.setRoundingState(NewF26Dot6 (1, fixed_fraction()), 0, 0);
 }
 
@@ -571,6 +673,10 @@ String RoundOffInstruction::getName() const {
 SuperRoundInstruction::SuperRoundInstruction() : Instruction(oiSROUND) {}
 
 void SuperRoundInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void SuperRoundInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long n = proc.pop();
 	NewF26Dot6 period, phase, threshold;
 
@@ -605,6 +711,10 @@ String SuperRoundInstruction::getName() const {
 SuperRound45Instruction::SuperRound45Instruction() : Instruction(oiSROUND) {}
 
 void SuperRound45Instruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void SuperRound45Instruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long n = proc.pop();
 	NewF26Dot6 period, phase, threshold;
 
@@ -637,6 +747,10 @@ String SuperRound45Instruction::getName() const {
 /*** The SLOOP instruction ***/
 
 void SetLoopInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void SetLoopInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.setLoop(proc.pop());
 }
 
@@ -649,6 +763,10 @@ String SetLoopInstruction::getName() const {
 SetMinimumDistanceInstruction::SetMinimumDistanceInstruction() : Instruction(oiSMD) {}
 
 void SetMinimumDistanceInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void SetMinimumDistanceInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.setMinimumDistance(proc.popFixed());
 }
 
@@ -661,6 +779,10 @@ String SetMinimumDistanceInstruction::getName() const {
 InstructionControlInstruction::InstructionControlInstruction() : Instruction(oiINSTCTRL) {}
 
 void InstructionControlInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void InstructionControlInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	ULong mask, value;
 	mask = proc.pop();
 	value = proc.pop();
@@ -679,6 +801,10 @@ String InstructionControlInstruction::getName() const {
 ScanConversionControlInstruction::ScanConversionControlInstruction() : Instruction(oiSCANCTRL) {}
 
 void ScanConversionControlInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void ScanConversionControlInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	// does nothing (yet)
 	proc.pop();
 }
@@ -692,6 +818,10 @@ String ScanConversionControlInstruction::getName() const {
 ScanTypeInstruction::ScanTypeInstruction() : Instruction(oiSCANTYPE) {}
 
 void ScanTypeInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void ScanTypeInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	// does nothing (yet)
 	proc.pop();
 }
@@ -705,6 +835,10 @@ String ScanTypeInstruction::getName() const {
 ControlValueCutInInstruction::ControlValueCutInInstruction() : Instruction(oiSCVTCI) {}
 
 void ControlValueCutInInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void ControlValueCutInInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.setControlValueCutIn(proc.popFixed());
 }
 
@@ -717,6 +851,10 @@ String ControlValueCutInInstruction::getName() const {
 SetSingleWidthCutInInstruction::SetSingleWidthCutInInstruction() : Instruction(oiSSWCI) {}
 
 void SetSingleWidthCutInInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void SetSingleWidthCutInInstruction::run (InstructionProcessor &proc, Byte instruction) {
 
 	proc.setSingleWidthCutIn(proc.popFixed());
 }
@@ -730,6 +868,10 @@ String SetSingleWidthCutInInstruction::getName() const {
 SetSingleWidthInstruction::SetSingleWidthInstruction() : Instruction(oiSSW) {}
 
 void SetSingleWidthInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void SetSingleWidthInstruction::run (InstructionProcessor &proc, Byte instruction) {
 
 	// pop in 16.16 units, apparently
 	proc.setSingleWidthValue(util::fixed <16, 16> (proc.pop(), fixed_fraction()));
@@ -744,6 +886,10 @@ String SetSingleWidthInstruction::getName() const {
 SetAutoFlipInstruction::SetAutoFlipInstruction(bool on) : Instruction(on ? oiFLIPON : oiFLIPOFF) {}
 
 void SetAutoFlipInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void SetAutoFlipInstruction::run (InstructionProcessor &proc, Byte instruction) {
 
 	proc.setAutoFlip(instruction == oiFLIPON);
 }
@@ -762,6 +908,10 @@ String SetAutoFlipInstruction::getName() const {
 DeltaBaseInstruction::DeltaBaseInstruction() : Instruction(oiSDB) {}
 
 void DeltaBaseInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void DeltaBaseInstruction::run (InstructionProcessor &proc, Byte instruction) {
 
 	proc.setDeltaBase(proc.pop());
 }
@@ -775,6 +925,10 @@ String DeltaBaseInstruction::getName() const {
 DeltaShiftInstruction::DeltaShiftInstruction() : Instruction(oiSDS) {}
 
 void DeltaShiftInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void DeltaShiftInstruction::run (InstructionProcessor &proc, Byte instruction) {
 
 	proc.setDeltaShift(proc.pop());
 }
@@ -787,8 +941,11 @@ String DeltaShiftInstruction::getName() const {
 
 GetCoordinateInstruction::GetCoordinateInstruction(bool orig) : Instruction(orig ? oiGCorig : oiGCcur) {}
 
-void GetCoordinateInstruction::execute (InstructionProcessor &proc) const
-{
+void GetCoordinateInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void GetCoordinateInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long p = proc.pop();
 	Long zp2 = proc.getZonePointer(2);
 	if (instruction==oiGCcur)
@@ -808,6 +965,10 @@ String GetCoordinateInstruction::getName() const {
 SetCoordinateInstruction::SetCoordinateInstruction() : Instruction(oiSCFS) {}
 
 void SetCoordinateInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void SetCoordinateInstruction::run (InstructionProcessor &proc, Byte instruction) {
 
 	NewF26Dot6 value = proc.popFixed();
 	Long p = proc.pop();
@@ -829,6 +990,10 @@ String SetCoordinateInstruction::getName() const {
 MeasureDistanceInstruction::MeasureDistanceInstruction(bool orig) : Instruction(orig ? oiMDorig : oiMDcur) {}
 
 void MeasureDistanceInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void MeasureDistanceInstruction::run (InstructionProcessor &proc, Byte instruction) {
 
 	Long p1, p2, zp0, zp1;
 	p1 = proc.pop();
@@ -852,6 +1017,10 @@ String MeasureDistanceInstruction::getName() const {
 MeasurePPEMInstruction::MeasurePPEMInstruction() : Instruction(oiMPPEM) {}
 
 void MeasurePPEMInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void MeasurePPEMInstruction::run (InstructionProcessor &proc, Byte instruction) {
 
 	proc.push(proc.getPPEM());
 }
@@ -865,6 +1034,10 @@ String MeasurePPEMInstruction::getName() const {
 MeasurePointSizeInstruction::MeasurePointSizeInstruction() : Instruction(oiMPS) {}
 
 void MeasurePointSizeInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void MeasurePointSizeInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.push(proc.getPointSize());
 }
 
@@ -877,6 +1050,10 @@ String MeasurePointSizeInstruction::getName() const {
 FlipPointInstruction::FlipPointInstruction() : Instruction(oiFLIPPT) {}
 
 void FlipPointInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void FlipPointInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	// Use loop variable
 	ULong loop = proc.getLoop();
 	if (proc.getZonePointer(0) != 1)
@@ -901,6 +1078,10 @@ String FlipPointInstruction::getName() const {
 FlipRangeInstruction::FlipRangeInstruction() : Instruction(oiFLIPRGON) {}
 
 void FlipRangeInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void FlipRangeInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	ULong high, low;
 	high = proc.pop();
 	low = proc.pop();
@@ -920,6 +1101,10 @@ String FlipRangeInstruction::getName() const {
 ShiftPointInstruction::ShiftPointInstruction(bool use10) : Instruction(use10 ? oiSHP10 : oiSHP21) {}
 
 void ShiftPointInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void ShiftPointInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	// Use Loop variable
 	ULong loop = proc.getLoop();
 	ULong zp2, zp, rp;
@@ -954,6 +1139,10 @@ String ShiftPointInstruction::getName() const {
 ShiftContourInstruction::ShiftContourInstruction(bool use10) : Instruction(use10 ? oiSHC10 : oiSHC21) {}
 
 void ShiftContourInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void ShiftContourInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	ULong zp2, zp, rp;
 	zp2 = proc.getZonePointer(2);
 	if (instruction==oiSHC21) {
@@ -980,10 +1169,7 @@ void ShiftContourInstruction::execute (InstructionProcessor &proc) const {
 
 	assert (! (first > last));
 
-	for (ULong i=first; i<=last; i++) {
-		if (zp!=1 || i != rp)
-			proc.shiftPoint(1, i, distance);
-	}
+	proc.shiftPoints(1, first, last + 1, zp == 1 ? rp : last + 1, distance);
 }
 
 String ShiftContourInstruction::getName() const {
@@ -996,6 +1182,10 @@ String ShiftContourInstruction::getName() const {
 ShiftZoneInstruction::ShiftZoneInstruction(bool use10) : Instruction(use10 ? oiSHZ10 : oiSHZ21) {}
 
 void ShiftZoneInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void ShiftZoneInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	ULong zone = proc.pop();
 
 	ULong zp, rp;
@@ -1020,10 +1210,7 @@ void ShiftZoneInstruction::execute (InstructionProcessor &proc) const {
 
 	/*** UNDOCUMENTED: the points are not touched. ***/
 
-	for (ULong i=0; i<max; i++) {
-		if (zone!=zp || i != rp)
-			proc.shiftPoint(zone, i, distance, false);
-	}
+	proc.shiftPoints(zone, 0, max, zone == zp ? rp : max, distance, false);
 }
 
 String ShiftZoneInstruction::getName() const {
@@ -1036,6 +1223,10 @@ String ShiftZoneInstruction::getName() const {
 ShiftPointByPixelsInstruction::ShiftPointByPixelsInstruction() : Instruction(oiSHPIX) {}
 
 void ShiftPointByPixelsInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void ShiftPointByPixelsInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	NewF26Dot6 amount = proc.popFixed();
 	Long zp2 = proc.getZonePointer(2);
 
@@ -1059,6 +1250,10 @@ MoveStackIndirectRelativePointInstruction::MoveStackIndirectRelativePointInstruc
 Instruction(setrp0 ? oiMSIRPset : oiMSIRP) {}
 
 void MoveStackIndirectRelativePointInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void MoveStackIndirectRelativePointInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	NewF26Dot6 distance = proc.popFixed();
 	Long p = proc.pop();
 	Long rp0 = proc.getReferencePoint(0);
@@ -1092,6 +1287,10 @@ MoveDirectAbsolutePointInstruction::MoveDirectAbsolutePointInstruction(bool roun
 Instruction(round ? oiMDAPround : oiMDAP) {}
 
 void MoveDirectAbsolutePointInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void MoveDirectAbsolutePointInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long p = proc.pop();
 	Long zp0 = proc.getZonePointer(0);
 	if (instruction == oiMDAP)
@@ -1116,6 +1315,10 @@ MoveIndirectAbsolutePointInstruction::MoveIndirectAbsolutePointInstruction(bool
 Instruction(round ? oiMIAPround : oiMIAP) {}
 
 void MoveIndirectAbsolutePointInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void MoveIndirectAbsolutePointInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	ULong n, p;
 	n = proc.pop();
 	p = proc.pop();
@@ -1165,6 +1368,10 @@ Instruction(oiMDRP | (setrp0 ? oiMRPsetrp0 : 0) | (minDist ? oiMRPminDist : 0) |
 			  (round ? oiMRPround : 0) | colour) {}
 
 void MoveDirectRelativePointInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void MoveDirectRelativePointInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long p = proc.pop();
 	Long zp1 = proc.getZonePointer(1);
 	Long rp0 = proc.getReferencePoint(0);
@@ -1232,6 +1439,10 @@ Instruction(oiMIRP | (setrp0 ? oiMRPsetrp0 : 0) | (minDist ? oiMRPminDist : 0) |
 			  (round ? oiMRPround : 0) | colour) {}
 
 void MoveIndirectRelativePointInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void MoveIndirectRelativePointInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	NewF26Dot6 cvtDist = proc.getCVTValue (proc.pop());
 	Long p = proc.pop();
 	Long rp0 = proc.getReferencePoint(0);
@@ -1302,6 +1513,10 @@ String MoveIndirectRelativePointInstruction::getName() const {
 AlignInstruction::AlignInstruction() : Instruction(oiALIGN) {}
 
 void AlignInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void AlignInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long rp0 = proc.getReferencePoint(0);
 	Long zp0 = proc.getZonePointer(0);
 	Long zp1 = proc.getZonePointer(1);
@@ -1330,6 +1545,10 @@ MoveToIntersectionInstruction::MoveToIntersectionInstruction() : Instruction(oiI
 // See documentation for calculations behind all this; keep in mind that parallel lines
 // Should result in putting the point in the exact middle.
 void MoveToIntersectionInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void MoveToIntersectionInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	ULong a0, a1, b0, b1, p;
 	b1 = proc.pop();
 	b0 = proc.pop();
@@ -1425,6 +1644,10 @@ String MoveToIntersectionInstruction::getName() const {
 AlignPointsInstruction::AlignPointsInstruction() : Instruction(oiALIGNPTS) {}
 
 void AlignPointsInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void AlignPointsInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long rp0 = proc.getReferencePoint(0);
 	Long zp0 = proc.getZonePointer(0);
 	Long zp1 = proc.getZonePointer(1);
@@ -1445,6 +1668,10 @@ String AlignPointsInstruction::getName() const {
 InterpolatePointInstruction::InterpolatePointInstruction() : Instruction(oiIP) {}
 
 void InterpolatePointInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void InterpolatePointInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	ULong loop = proc.getLoop();
 	while (loop) {
 		NewF26Dot6 original1, original2, originalPos, current1, current2, newPos;
@@ -1485,6 +1712,10 @@ String InterpolatePointInstruction::getName() const {
 UntouchPointInstruction::UntouchPointInstruction() : Instruction(oiUTP) {}
 
 void UntouchPointInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void UntouchPointInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	if (proc.getZonePointer(0)!=1)
 		throw InstructionException ("Untouching points is only possible in zone 1");
 
@@ -1501,6 +1732,10 @@ InterpolateUntouchedPointsInstruction::InterpolateUntouchedPointsInstruction(boo
 Instruction(x ? oiIUPx : oiIUPy) {}
 
 void InterpolateUntouchedPointsInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void InterpolateUntouchedPointsInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	if (proc.getZonePointer (2) != 1)
 		throw InstructionException ("IUP instruction only works with zone 1");
 
@@ -1521,7 +1756,14 @@ DeltaPInstruction::DeltaPInstruction(Byte type) : Instruction(oiDELTAP1 - 1 + ty
 }
 
 void DeltaPInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void DeltaPInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long n = proc.pop();
+	// n pairs of arguments follow
+	if (n > 0 && proc.getStackElementNum() / 2 < ULong (n))
+		throw InstructionException ("Stack empty");
 	ULong zp = proc.getZonePointer(0);
 	ULong deltaBase = proc.getDeltaBase();
 	ULong deltaShift = proc.getDeltaShift();
@@ -1574,7 +1816,14 @@ DeltaCInstruction::DeltaCInstruction(Byte type) : Instruction(oiDELTAC1 - 1 + ty
 }
 
 void DeltaCInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void DeltaCInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long n = proc.pop();
+	// n pairs of arguments follow
+	if (n > 0 && proc.getStackElementNum() / 2 < ULong (n))
+		throw InstructionException ("Stack empty");
 	ULong zp = proc.getZonePointer(0);
 	ULong deltaBase = proc.getDeltaBase();
 	ULong deltaShift = proc.getDeltaShift();
@@ -1624,9 +1873,11 @@ String DeltaCInstruction::getName() const {
 DuplicateStackElementInstruction::DuplicateStackElementInstruction() : Instruction(oiDUP) {}
 
 void DuplicateStackElementInstruction::execute (InstructionProcessor &proc) const {
-	Long el = proc.pop();
-	proc.push(el);
-	proc.push(el);
+	run (proc, instruction);
+}
+
+void DuplicateStackElementInstruction::run (InstructionProcessor &proc, Byte instruction) {
+	proc.push (proc.getStackTop() [-1]);
 }
 
 String DuplicateStackElementInstruction::getName() const {
@@ -1638,6 +1889,10 @@ String DuplicateStackElementInstruction::getName() const {
 PopInstruction::PopInstruction() : Instruction(oiPOP) {}
 
 void PopInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void PopInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.pop();
 }
 
@@ -1648,6 +1903,10 @@ String PopInstruction::getName() const {
 /*** The CLEAR instruction ***/
 
 void ClearStackInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void ClearStackInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.clearStack();
 }
 
@@ -1660,11 +1919,12 @@ String ClearStackInstruction::getName() const {
 SwapStackElementsInstruction::SwapStackElementsInstruction() : Instruction(oiSWAP) {}
 
 void SwapStackElementsInstruction::execute (InstructionProcessor &proc) const {
-	Long e1, e2;
-	e2 = proc.pop();
-	e1 = proc.pop();
-	proc.push(e2);
-	proc.push(e1);
+	run (proc, instruction);
+}
+
+void SwapStackElementsInstruction::run (InstructionProcessor &proc, Byte instruction) {
+	Long *top = proc.getStackTop();
+	std::swap (top [-1], top [-2]);
 }
 
 String SwapStackElementsInstruction::getName() const {
@@ -1674,6 +1934,10 @@ String SwapStackElementsInstruction::getName() const {
 /*** The DEPTH instruction ***/
 
 void StackDepthInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void StackDepthInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.push(proc.getStackElementNum());
 }
 
@@ -1684,6 +1948,10 @@ String StackDepthInstruction::getName() const {
 /*** The CINDEX instruction ***/
 
 void CopyIndexInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void CopyIndexInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	// Duplicate n - pop()th stack element; compensate for popping by subtracting 1
 	proc.push(proc.getNthStackElement(proc.pop()-1));
 }
@@ -1695,6 +1963,10 @@ String CopyIndexInstruction::getName() const {
 /*** The MINDEX instruction ***/
 
 void MoveIndexInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void MoveIndexInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.push(proc.removeNthStackElement(proc.pop()-1));
 }
 
@@ -1705,12 +1977,16 @@ String MoveIndexInstruction::getName() const {
 /*** The ROLL instruction ***/
 
 void RollStackInstruction::execute (InstructionProcessor &proc) const {
-	Long a = proc.pop();
-	Long b = proc.pop();
-	Long c = proc.pop();
-	proc.push(b);
-	proc.push(a);
-	proc.push(c);
+	run (proc, instruction);
+}
+
+void RollStackInstruction::run (InstructionProcessor &proc, Byte instruction) {
+	// Move the third element to the top
+	Long *top = proc.getStackTop();
+	Long c = top [-3];
+	top [-3] = top [-2];
+	top [-2] = top [-1];
+	top [-1] = c;
 }
 
 String RollStackInstruction::getName() const {
@@ -1721,22 +1997,8 @@ String RollStackInstruction::getName() const {
 
 void IfInstruction::execute (InstructionProcessor &proc) const {
 	if (! proc.pop())
-	{
-		// Level of IF statements
-		int level = 1;
-		while (true) {
-			InstructionProcessor::InstructionIterator i = proc.skipNextInstruction();
-			if ((*i)->instruction == oiELSE && level == 1)
-				return;
-			if ((*i)->instruction == oiEIF) {
-				level --;
-				if (level == 0)
-					return;
-			}
-			if ((*i)->instruction == oiIF)
-				level ++;
-		}
-	}
+		// Continue after the matching ELSE or EIF
+		proc.skipBlock (blockLength);
 }
 
 String IfInstruction::getName() const {
@@ -1746,19 +2008,7 @@ String IfInstruction::getName() const {
 /*** The ELSE instruction jumps over the "else" block when executed ***/
 
 void ElseInstruction::execute (InstructionProcessor &proc) const {
-	int level = 1;
-	while (true) {
-		InstructionProcessor::InstructionIterator i = proc.skipNextInstruction();
-		if ((*i)->instruction == oiELSE && level == 1)
-			throw InstructionException ("Stray ELSE instruction in ELSE block");
-		if ((*i)->instruction == oiEIF) {
-			level --;
-			if (level == 0)
-				return;
-		}
-		if  ((*i)->instruction == oiIF)
-			level ++;
-	}
+	proc.skipBlock (blockLength);
 }
 
 String ElseInstruction::getName() const {
@@ -1819,6 +2069,10 @@ String JumpRelOnFalseInstruction::getName() const {
 LessThanInstruction::LessThanInstruction() : Instruction(oiLT) {}
 
 void LessThanInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void LessThanInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long e2 = proc.pop();
 	Long e1 = proc.pop();
 	if (e1 < e2)
@@ -1836,6 +2090,10 @@ String LessThanInstruction::getName() const {
 LessThanOrEqualInstruction::LessThanOrEqualInstruction() : Instruction(oiLTEQ) {}
 
 void LessThanOrEqualInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void LessThanOrEqualInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long e2 = proc.pop();
 	Long e1 = proc.pop();
 	if (e1 <= e2)
@@ -1853,6 +2111,10 @@ String LessThanOrEqualInstruction::getName() const {
 GreaterThanInstruction::GreaterThanInstruction() : Instruction(oiGT) {}
 
 void GreaterThanInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void GreaterThanInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long e2 = proc.pop();
 	Long e1 = proc.pop();
 	if (e1 > e2)
@@ -1870,6 +2132,10 @@ String GreaterThanInstruction::getName() const {
 GreaterThanOrEqualInstruction::GreaterThanOrEqualInstruction() : Instruction(oiGTEQ) {}
 
 void GreaterThanOrEqualInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void GreaterThanOrEqualInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long e2 = proc.pop();
 	Long e1 = proc.pop();
 	if (e1 >= e2)
@@ -1887,6 +2153,10 @@ String GreaterThanOrEqualInstruction::getName() const {
 EqualInstruction::EqualInstruction() : Instruction(oiEQ) {}
 
 void EqualInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void EqualInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	ULong e2 = proc.pop();
 	ULong e1 = proc.pop();
 	if (e1 == e2)
@@ -1904,6 +2174,10 @@ String EqualInstruction::getName() const {
 NotEqualInstruction::NotEqualInstruction() : Instruction(oiNEQ) {}
 
 void NotEqualInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void NotEqualInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	ULong e2 = proc.pop();
 	ULong e1 = proc.pop();
 	if (e1 != e2)
@@ -1921,6 +2195,10 @@ String NotEqualInstruction::getName() const {
 OddInstruction::OddInstruction() : Instruction (oiODD) {}
 
 void OddInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void OddInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.push ((proc.round (proc.popFixed()).get_integer()) & 0x01);
 }
 
@@ -1933,6 +2211,10 @@ String OddInstruction::getName() const {
 EvenInstruction::EvenInstruction() : Instruction(oiEVEN) {}
 
 void EvenInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void EvenInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.push (!((proc.round (proc.popFixed()).get_integer()) & 0x01));
 }
 
@@ -1945,6 +2227,10 @@ String EvenInstruction::getName() const {
 AndInstruction::AndInstruction() : Instruction(oiAND) {}
 
 void AndInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void AndInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long n1 = proc.pop();
 	Long n2 = proc.pop();
 	proc.push(n1 && n2);
@@ -1959,6 +2245,10 @@ String AndInstruction::getName() const {
 OrInstruction::OrInstruction() : Instruction(oiOR) {}
 
 void OrInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void OrInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long n1 = proc.pop();
 	Long n2 = proc.pop();
 	proc.push(n1 || n2);
@@ -1973,6 +2263,10 @@ String OrInstruction::getName() const {
 NotInstruction::NotInstruction() : Instruction(oiN) {}
 
 void NotInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void NotInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.push(!proc.pop());
 }
 
@@ -1985,6 +2279,10 @@ String NotInstruction::getName() const {
 AddInstruction::AddInstruction() : Instruction(oiADD) {}
 
 void AddInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void AddInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.push(proc.pop() + proc.pop());
 }
 
@@ -1997,6 +2295,10 @@ String AddInstruction::getName() const {
 SubtractInstruction::SubtractInstruction() : Instruction(oiSUB) {}
 
 void SubtractInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void SubtractInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long n1, n2;
 	n1 = proc.pop();
 	n2 = proc.pop();
@@ -2012,6 +2314,10 @@ String SubtractInstruction::getName() const {
 DivideInstruction::DivideInstruction() : Instruction(oiDIV) {}
 
 void DivideInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void DivideInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	NewF26Dot6 n1, n2;
 	n1 = proc.popFixed();
 	n2 = proc.popFixed();
@@ -2030,6 +2336,10 @@ String DivideInstruction::getName() const {
 MultiplyInstruction::MultiplyInstruction() : Instruction(oiMUL) {}
 
 void MultiplyInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void MultiplyInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	NewF26Dot6 n1, n2;
 	n1 = proc.popFixed();
 	n2 = proc.popFixed();
@@ -2045,6 +2355,10 @@ String MultiplyInstruction::getName() const {
 AbsoluteInstruction::AbsoluteInstruction() : Instruction(oiABS) {}
 
 void AbsoluteInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void AbsoluteInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long n = proc.pop();
 	if (n<0)
 		proc.push(-n);
@@ -2061,6 +2375,10 @@ String AbsoluteInstruction::getName() const {
 NegateInstruction::NegateInstruction() : Instruction(oiNEG) {}
 
 void NegateInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void NegateInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.push(-proc.pop());
 }
 
@@ -2073,6 +2391,10 @@ String NegateInstruction::getName() const {
 FloorInstruction::FloorInstruction() : Instruction(oiFLOOR) {}
 
 void FloorInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void FloorInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.push(proc.pop() & ~0x3F);
 }
 
@@ -2085,6 +2407,10 @@ String FloorInstruction::getName() const {
 CeilingInstruction::CeilingInstruction() : Instruction(oiCEILING) {}
 
 void CeilingInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void CeilingInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.push((proc.pop() + 0x3F) & ~0x3F);
 }
 
@@ -2097,6 +2423,10 @@ String CeilingInstruction::getName() const {
 MaximumInstruction::MaximumInstruction() : Instruction(oiMAX) {}
 
 void MaximumInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void MaximumInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long n1, n2;
 	n1 = proc.pop();
 	n2 = proc.pop();
@@ -2115,6 +2445,10 @@ String MaximumInstruction::getName() const {
 MinimumInstruction::MinimumInstruction() : Instruction(oiMIN) {}
 
 void MinimumInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void MinimumInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long n1, n2;
 	n1 = proc.pop();
 	n2 = proc.pop();
@@ -2135,6 +2469,10 @@ RoundInstruction::RoundInstruction(Byte colour) : Instruction(oiROUND + colour)
 }
 
 void RoundInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void RoundInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.push (proc.round (proc.compensateForColour (proc.popFixed(), instruction & 0x03)));
 }
 
@@ -2149,6 +2487,10 @@ NoRoundInstruction::NoRoundInstruction(Byte colour) : Instruction(oiNROUND + col
 }
 
 void NoRoundInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void NoRoundInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	proc.push (proc.compensateForColour (proc.popFixed(), instruction & 0x03));
 }
 
@@ -2159,22 +2501,16 @@ String NoRoundInstruction::getName() const {
 /*** The FDEF instruction defines the begin of a function; executing it results in the 
 	 function being defined. ***/
 
-FunctionDefInstruction::FunctionDefInstruction() : Instruction(oiFDEF) {}
+FunctionDefInstruction::FunctionDefInstruction() : BlockInstruction(oiFDEF) {}
 
 void FunctionDefInstruction::execute (InstructionProcessor &proc) const {
 	Long id = proc.pop();
 	if (id < 0 || id > 0xFFFF)
 		throw InstructionException ("Function identifier " + String (id) + " invalid");
 
-	// Find ENDF
-	InstructionProcessor::InstructionIterator instruction;
-	while (true) {
-		instruction = proc.skipNextInstruction();
-		if ((*instruction)->instruction == oiENDF) {
-			proc.defineFunction (id);
-			return;
-		}
-	}
+	// Continue after the ENDF
+	proc.skipBlock (blockLength);
+	proc.defineFunction (id);
 }
 
 String FunctionDefInstruction::getName() const {
@@ -2212,10 +2548,8 @@ void LoopCallInstruction::execute (InstructionProcessor &proc) const {
 	Long f, count;
 	f = proc.pop();
 	count = proc.pop();
-	while (count) {
-		proc.callFunction(f);
-		count--;
-	}
+	if (count > 0)
+		proc.callFunction(f, count - 1);
 }
 
 String LoopCallInstruction::getName() const {
@@ -2225,6 +2559,10 @@ String LoopCallInstruction::getName() const {
 /*** The IDEF instruction ***/
 
 void InstructionDefInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void InstructionDefInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	//Default handler
 	//Instruction::execute (proc);
 	throw InstructionException ("The IDEF instruction is not supported");
@@ -2239,6 +2577,10 @@ String InstructionDefInstruction::getName() const {
 GetInformationInstruction::GetInformationInstruction() : Instruction (oiGETINFO) {}
 
 void GetInformationInstruction::execute (InstructionProcessor &proc) const {
+	run (proc, instruction);
+}
+
+void GetInformationInstruction::run (InstructionProcessor &proc, Byte instruction) {
 	Long selector = proc.pop();
 	Long result = 0;
 
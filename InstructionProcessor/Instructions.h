@@ -222,6 +222,10 @@ namespace OpenType {
 
 	/*** Classes ***/
 
+	// Instructions that do not change the flow of control have a static run()
+	// next to execute(), so that the decoded programs of InstructionProcessor
+	// can be executed without Instruction objects.
+
 	class PushInstruction : public Instruction {
 	public:
 		typedef std::vector <Short> Elements;
@@ -239,6 +243,7 @@ namespace OpenType {
 		ReadStoreInstruction(MemoryPen &pen) : Instruction (pen) {}
 		ReadStoreInstruction() : Instruction (oiRS) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -247,6 +252,7 @@ namespace OpenType {
 		WriteStoreInstruction(MemoryPen &pen) : Instruction (pen) {}
 		WriteStoreInstruction() : Instruction (oiWS) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -255,6 +261,7 @@ namespace OpenType {
 		WriteCVTPixelsInstruction(MemoryPen &pen) : Instruction (pen) {}
 		WriteCVTPixelsInstruction(): Instruction(oiWCVTP) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -263,6 +270,7 @@ namespace OpenType {
 		WriteCVTFUnitsInstruction(MemoryPen &pen) : Instruction (pen) {}
 		WriteCVTFUnitsInstruction() : Instruction(oiWCVTF) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -271,6 +279,7 @@ namespace OpenType {
 		ReadCVTInstruction(MemoryPen &pen) : Instruction (pen) {}
 		ReadCVTInstruction() : Instruction(oiRCVT) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -279,6 +288,7 @@ namespace OpenType {
 		VectorsToAxisInstruction(MemoryPen &pen) : Instruction (pen) {}
 		VectorsToAxisInstruction(bool x);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -287,6 +297,7 @@ namespace OpenType {
 		ProjectionToAxisInstruction(MemoryPen &pen) : Instruction (pen) {}
 		ProjectionToAxisInstruction(bool x);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -295,6 +306,7 @@ namespace OpenType {
 		FreedomToAxisInstruction(MemoryPen &pen) : Instruction (pen) {}
 		FreedomToAxisInstruction(bool x);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -303,6 +315,7 @@ namespace OpenType {
 		ProjectionToLineInstruction(MemoryPen &pen) : Instruction (pen) {}
 		ProjectionToLineInstruction(bool perp);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -311,6 +324,7 @@ namespace OpenType {
 		FreedomToLineInstruction(MemoryPen &pen) : Instruction (pen) {}
 		FreedomToLineInstruction(bool perp);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -319,6 +333,7 @@ namespace OpenType {
 		FreedomToProjectionInstruction(MemoryPen &pen) : Instruction (pen) {}
 		FreedomToProjectionInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -327,6 +342,7 @@ namespace OpenType {
 		DualProjectionToLineInstruction(MemoryPen &pen) : Instruction (pen) {}
 		DualProjectionToLineInstruction(bool perp);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -335,6 +351,7 @@ namespace OpenType {
 		ProjectionFromStackInstruction(MemoryPen &pen) : Instruction (pen) {}
 		ProjectionFromStackInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -343,6 +360,7 @@ namespace OpenType {
 		FreedomFromStackInstruction(MemoryPen &pen) : Instruction (pen) {}
 		FreedomFromStackInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -350,6 +368,7 @@ namespace OpenType {
 	public:
 		GetProjectionVectorInstruction(MemoryPen &pen) : Instruction (pen) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -357,6 +376,7 @@ namespace OpenType {
 	public:
 		GetFreedomVectorInstruction(MemoryPen &pen) : Instruction (pen) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -365,6 +385,7 @@ namespace OpenType {
 		SetReferencePointInstruction(MemoryPen &pen) : Instruction (pen) {}
 		SetReferencePointInstruction(Byte rp);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -373,6 +394,7 @@ namespace OpenType {
 		SetZonePointerInstruction(MemoryPen &pen) : Instruction (pen) {}
 		SetZonePointerInstruction(Byte zp);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -380,6 +402,7 @@ namespace OpenType {
 	public:
 		SetZonePointersInstruction(MemoryPen &pen) : Instruction (pen) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -388,6 +411,7 @@ namespace OpenType {
 		RoundToHalfGridInstruction(MemoryPen &pen) : Instruction (pen) {}
 		RoundToHalfGridInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -396,6 +420,7 @@ namespace OpenType {
 		RoundToGridInstruction(MemoryPen &pen) : Instruction (pen) {}
 		RoundToGridInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -404,6 +429,7 @@ namespace OpenType {
 		RoundToDoubleGridInstruction(MemoryPen &pen) : Instruction (pen) {}
 		RoundToDoubleGridInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -412,6 +438,7 @@ namespace OpenType {
 		RoundDownToGridInstruction(MemoryPen &pen) : Instruction (pen) {}
 		RoundDownToGridInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -420,6 +447,7 @@ namespace OpenType {
 		RoundUpToGridInstruction(MemoryPen &pen) : Instruction (pen) {}
 		RoundUpToGridInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -428,6 +456,7 @@ namespace OpenType {
 		RoundOffInstruction(MemoryPen &pen) : Instruction (pen) {}
 		RoundOffInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -436,6 +465,7 @@ namespace OpenType {
 		SuperRoundInstruction(MemoryPen &pen) : Instruction (pen) {}
 		SuperRoundInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -444,6 +474,7 @@ namespace OpenType {
 		SuperRound45Instruction(MemoryPen &pen) : Instruction (pen) {}
 		SuperRound45Instruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -451,6 +482,7 @@ namespace OpenType {
 	public:
 		SetLoopInstruction(MemoryPen &pen) : Instruction (pen) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -459,6 +491,7 @@ namespace OpenType {
 		SetMinimumDistanceInstruction(MemoryPen &pen) : Instruction (pen) {}
 		SetMinimumDistanceInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -467,6 +500,7 @@ namespace OpenType {
 		InstructionControlInstruction(MemoryPen &pen) : Instruction (pen) {}
 		InstructionControlInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -475,6 +509,7 @@ namespace OpenType {
 		ScanConversionControlInstruction(MemoryPen &pen) : Instruction (pen) {}
 		ScanConversionControlInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -483,6 +518,7 @@ namespace OpenType {
 		ScanTypeInstruction(MemoryPen &pen) : Instruction (pen) {}
 		ScanTypeInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -491,6 +527,7 @@ namespace OpenType {
 		ControlValueCutInInstruction(MemoryPen &pen) : Instruction (pen) {}
 		ControlValueCutInInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -499,6 +536,7 @@ namespace OpenType {
 		SetSingleWidthCutInInstruction(MemoryPen &pen) : Instruction (pen) {}
 		SetSingleWidthCutInInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -507,6 +545,7 @@ namespace OpenType {
 		SetSingleWidthInstruction(MemoryPen &pen) : Instruction (pen) {}
 		SetSingleWidthInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -515,6 +554,7 @@ namespace OpenType {
 		SetAutoFlipInstruction(MemoryPen &pen) : Instruction (pen) {}
 		SetAutoFlipInstruction(bool on);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -523,6 +563,7 @@ namespace OpenType {
 		DeltaBaseInstruction(MemoryPen &pen) : Instruction (pen) {}
 		DeltaBaseInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -531,6 +572,7 @@ namespace OpenType {
 		DeltaShiftInstruction(MemoryPen &pen) : Instruction (pen) {}
 		DeltaShiftInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -539,6 +581,7 @@ namespace OpenType {
 		GetCoordinateInstruction(MemoryPen &pen) : Instruction (pen) {}
 		GetCoordinateInstruction(bool orig);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -547,6 +590,7 @@ namespace OpenType {
 		SetCoordinateInstruction(MemoryPen &pen) : Instruction (pen) {}
 		SetCoordinateInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -555,6 +599,7 @@ namespace OpenType {
 		MeasureDistanceInstruction(MemoryPen &pen) : Instruction (pen) {}
 		MeasureDistanceInstruction(bool orig);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -563,6 +608,7 @@ namespace OpenType {
 		MeasurePPEMInstruction(MemoryPen &pen) : Instruction (pen) {}
 		MeasurePPEMInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -571,6 +617,7 @@ namespace OpenType {
 		MeasurePointSizeInstruction(MemoryPen &pen) : Instruction (pen) {}
 		MeasurePointSizeInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -579,6 +626,7 @@ namespace OpenType {
 		FlipPointInstruction(MemoryPen &pen) : Instruction (pen) {}
 		FlipPointInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -587,6 +635,7 @@ namespace OpenType {
 		FlipRangeInstruction(MemoryPen &pen) : Instruction (pen) {}
 		FlipRangeInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -595,6 +644,7 @@ namespace OpenType {
 		ShiftPointInstruction(MemoryPen &pen) : Instruction (pen) {}
 		ShiftPointInstruction(bool use10);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -603,6 +653,7 @@ namespace OpenType {
 		ShiftContourInstruction(MemoryPen &pen) : Instruction (pen) {}
 		ShiftContourInstruction(bool use10);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -611,6 +662,7 @@ namespace OpenType {
 		ShiftZoneInstruction(MemoryPen &pen) : Instruction (pen) {}
 		ShiftZoneInstruction(bool use10);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -619,6 +671,7 @@ namespace OpenType {
 		ShiftPointByPixelsInstruction(MemoryPen &pen) : Instruction (pen) {}
 		ShiftPointByPixelsInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -627,6 +680,7 @@ namespace OpenType {
 		MoveStackIndirectRelativePointInstruction(MemoryPen &pen) : Instruction (pen) {}
 		MoveStackIndirectRelativePointInstruction(bool setrp0);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -635,6 +689,7 @@ namespace OpenType {
 		MoveDirectAbsolutePointInstruction(MemoryPen &pen) : Instruction (pen) {}
 		MoveDirectAbsolutePointInstruction(bool round);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -643,6 +698,7 @@ namespace OpenType {
 		MoveIndirectAbsolutePointInstruction(MemoryPen &pen) : Instruction (pen) {}
 		MoveIndirectAbsolutePointInstruction(bool round);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -651,6 +707,7 @@ namespace OpenType {
 		MoveDirectRelativePointInstruction(MemoryPen &pen) : Instruction (pen) {}
 		MoveDirectRelativePointInstruction(bool setrp0, bool minDist, bool round, Byte colour);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -659,6 +716,7 @@ namespace OpenType {
 		MoveIndirectRelativePointInstruction(MemoryPen &pen) : Instruction (pen) {}
 		MoveIndirectRelativePointInstruction(bool setrp0, bool minDist, bool round, Byte colour);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -667,6 +725,7 @@ namespace OpenType {
 		AlignInstruction(MemoryPen &pen) : Instruction (pen) {}
 		AlignInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -675,6 +734,7 @@ namespace OpenType {
 		MoveToIntersectionInstruction(MemoryPen &pen) : Instruction (pen) {}
 		MoveToIntersectionInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -683,6 +743,7 @@ namespace OpenType {
 		AlignPointsInstruction(MemoryPen &pen) : Instruction (pen) {}
 		AlignPointsInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -691,6 +752,7 @@ namespace OpenType {
 		InterpolatePointInstruction(MemoryPen &pen) : Instruction (pen) {}
 		InterpolatePointInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -699,6 +761,7 @@ namespace OpenType {
 		UntouchPointInstruction(MemoryPen &pen) : Instruction (pen) {}
 		UntouchPointInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -707,6 +770,7 @@ namespace OpenType {
 		InterpolateUntouchedPointsInstruction(MemoryPen &pen) : Instruction (pen) {}
 		InterpolateUntouchedPointsInstruction(bool x);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -715,6 +779,7 @@ namespace OpenType {
 		DeltaPInstruction(MemoryPen &pen) : Instruction (pen) {}
 		DeltaPInstruction(Byte type);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -723,6 +788,7 @@ namespace OpenType {
 		DeltaCInstruction(MemoryPen &pen) : Instruction (pen) {}
 		DeltaCInstruction(Byte type);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -731,6 +797,7 @@ namespace OpenType {
 		DuplicateStackElementInstruction(MemoryPen &pen) : Instruction (pen) {}
 		DuplicateStackElementInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -739,6 +806,7 @@ namespace OpenType {
 		PopInstruction();
 		PopInstruction(MemoryPen &pen) : Instruction (pen) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -746,6 +814,7 @@ namespace OpenType {
 	public:
 		ClearStackInstruction(MemoryPen &pen) : Instruction (pen) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -754,6 +823,7 @@ namespace OpenType {
 		SwapStackElementsInstruction(MemoryPen &pen) : Instruction (pen) {}
 		SwapStackElementsInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -761,6 +831,7 @@ namespace OpenType {
 	public:
 		StackDepthInstruction(MemoryPen &pen) : Instruction (pen) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -768,6 +839,7 @@ namespace OpenType {
 	public:
 		CopyIndexInstruction(MemoryPen &pen) : Instruction (pen) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -775,6 +847,7 @@ namespace OpenType {
 	public:
 		MoveIndexInstruction(MemoryPen &pen) : Instruction (pen) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -782,19 +855,33 @@ namespace OpenType {
 	public:
 		RollStackInstruction(MemoryPen &pen) : Instruction (pen) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
-	class IfInstruction : public Instruction {
+	// IF, ELSE and FDEF may skip the instructions up to the ELSE, EIF or ENDF
+	// that ends their block. Where that is is found when the instructions are
+	// read, by InstructionProcessor::getInstructions.
+	class BlockInstruction : public Instruction {
+	protected:
+		// The number of instructions from this one to the one ending the block
+		ULong blockLength;
+	public:
+		BlockInstruction(MemoryPen &pen) : Instruction (pen), blockLength (0) {}
+		BlockInstruction(Byte instruction) : Instruction (instruction), blockLength (0) {}
+		void setBlockLength (ULong aBlockLength) { blockLength = aBlockLength; }
+	};
+
+	class IfInstruction : public BlockInstruction {
 	public:
-		IfInstruction(MemoryPen &pen) : Instruction (pen) {}
+		IfInstruction(MemoryPen &pen) : BlockInstruction (pen) {}
 		virtual void execute (InstructionProcessor &proc) const;
 		virtual util::String getName() const;
 	};
 
-	class ElseInstruction : public Instruction {
+	class ElseInstruction : public BlockInstruction {
 	public:
-		ElseInstruction(MemoryPen &pen) : Instruction (pen) {}
+		ElseInstruction(MemoryPen &pen) : BlockInstruction (pen) {}
 		virtual void execute (InstructionProcessor &proc) const;
 		virtual util::String getName() const;
 	};
@@ -834,6 +921,7 @@ namespace OpenType {
 		LessThanInstruction(MemoryPen &pen) : Instruction (pen) {}
 		LessThanInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -842,6 +930,7 @@ namespace OpenType {
 		LessThanOrEqualInstruction(MemoryPen &pen) : Instruction (pen) {}
 		LessThanOrEqualInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -850,6 +939,7 @@ namespace OpenType {
 		GreaterThanInstruction(MemoryPen &pen) : Instruction (pen) {}
 		GreaterThanInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -858,6 +948,7 @@ namespace OpenType {
 		GreaterThanOrEqualInstruction(MemoryPen &pen) : Instruction (pen) {}
 		GreaterThanOrEqualInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -866,6 +957,7 @@ namespace OpenType {
 		EqualInstruction(MemoryPen &pen) : Instruction (pen) {}
 		EqualInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -874,6 +966,7 @@ namespace OpenType {
 		NotEqualInstruction(MemoryPen &pen) : Instruction (pen) {}
 		NotEqualInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -882,6 +975,7 @@ namespace OpenType {
 		OddInstruction(MemoryPen &pen) : Instruction (pen) {}
 		OddInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -890,6 +984,7 @@ namespace OpenType {
 		EvenInstruction(MemoryPen &pen) : Instruction (pen) {}
 		EvenInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -898,6 +993,7 @@ namespace OpenType {
 		AndInstruction(MemoryPen &pen) : Instruction (pen) {}
 		AndInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -906,6 +1002,7 @@ namespace OpenType {
 		OrInstruction(MemoryPen &pen) : Instruction (pen) {}
 		OrInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -914,6 +1011,7 @@ namespace OpenType {
 		NotInstruction(MemoryPen &pen) : Instruction (pen) {}
 		NotInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -922,6 +1020,7 @@ namespace OpenType {
 		AddInstruction(MemoryPen &pen) : Instruction (pen) {}
 		AddInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -930,6 +1029,7 @@ namespace OpenType {
 		SubtractInstruction(MemoryPen &pen) : Instruction (pen) {}
 		SubtractInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -938,6 +1038,7 @@ namespace OpenType {
 		DivideInstruction(MemoryPen &pen) : Instruction (pen) {}
 		DivideInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -946,6 +1047,7 @@ namespace OpenType {
 		MultiplyInstruction(MemoryPen &pen) : Instruction (pen) {}
 		MultiplyInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -954,6 +1056,7 @@ namespace OpenType {
 		AbsoluteInstruction(MemoryPen &pen) : Instruction (pen) {}
 		AbsoluteInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -962,6 +1065,7 @@ namespace OpenType {
 		NegateInstruction(MemoryPen &pen) : Instruction (pen) {}
 		NegateInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -970,6 +1074,7 @@ namespace OpenType {
 		FloorInstruction(MemoryPen &pen) : Instruction (pen) {}
 		FloorInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -978,6 +1083,7 @@ namespace OpenType {
 		CeilingInstruction(MemoryPen &pen) : Instruction (pen) {}
 		CeilingInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -986,6 +1092,7 @@ namespace OpenType {
 		MaximumInstruction(MemoryPen &pen) : Instruction (pen) {}
 		MaximumInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -994,6 +1101,7 @@ namespace OpenType {
 		MinimumInstruction(MemoryPen &pen) : Instruction (pen) {}
 		MinimumInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -1002,6 +1110,7 @@ namespace OpenType {
 		RoundInstruction(MemoryPen &pen) : Instruction (pen) {}
 		RoundInstruction(Byte colour);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -1010,12 +1119,13 @@ namespace OpenType {
 		NoRoundInstruction(MemoryPen &pen) : Instruction (pen) {}
 		NoRoundInstruction(Byte colour);
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
-	class FunctionDefInstruction : public Instruction {
+	class FunctionDefInstruction : public BlockInstruction {
 	public:
-		FunctionDefInstruction(MemoryPen &pen) : Instruction (pen) {}
+		FunctionDefInstruction(MemoryPen &pen) : BlockInstruction (pen) {}
 		FunctionDefInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
 		virtual util::String getName() const;
@@ -1048,6 +1158,7 @@ namespace OpenType {
 	public:
 		InstructionDefInstruction(MemoryPen &pen) : Instruction (pen) {}
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 
@@ -1056,6 +1167,7 @@ namespace OpenType {
 		GetInformationInstruction(MemoryPen &pen) : Instruction (pen) {}
 		GetInformationInstruction();
 		virtual void execute (InstructionProcessor &proc) const;
+		static void run (InstructionProcessor &proc, Byte instruction);
 		virtual util::String getName() const;
 	};
 }
@@ -0,0 +1,280 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	\file ThreadTest hints every glyph of a frozen font at a range of sizes
+	from 16 threads at the same time, each with its own
+	InstructionProcessor, and checks that every thread gets the same points
+	as hinting the same glyphs in one thread from a separate copy of the
+	font. The threads start with nothing read from the font yet, so that
+	they read glyphs, tables and instructions at the same time.
+
+	It also checks that BatchHinter, with one thread and with four, gives
+	the same points, flags and errors as hinting every glyph in one
+	InstructionProcessor at 9 to 72 ppem.
+*/
+
+#ifdef _MSC_VER
+// Disable "type name to long to fit in debug information file" warning on Visual C++
+#pragma warning(disable:4786)
+#endif
+
+#include <iostream>
+#include <vector>
+
+#include "../Util/smart_ptr.h"
+#include "../Util/parallel.h"
+#include "../OTFont/OpenTypeFont.h"
+#include "../OTFont/OTException.h"
+#include "InstructionProcessor.h"
+#include "BatchHinter.h"
+
+using std::cout;
+using std::endl;
+using std::vector;
+using util::smart_ptr;
+using util::String;
+using namespace OpenType;
+
+class QuietOpenTypeFont : public OpenTypeFont {
+public:
+	virtual void addWarning (ExceptionPtr aWarning) {}
+};
+
+class QuietInstructionProcessor : public InstructionProcessor {
+protected:
+	virtual void addWarning (InstructionExceptionPtr aWarning) {}
+};
+
+enum { threadNum = 16, minPPEM = 9, maxPPEM = 24 };
+
+// A hash of the points of every glyph at every size, with 0 for glyphs
+// that could not be hinted. The glyphs are hinted starting from firstGlyph
+// so that different threads read different glyphs first.
+void hintFont (smart_ptr <OpenTypeFont> font, UShort firstGlyph, vector <ULong> &hashes) {
+	QuietInstructionProcessor processor;
+	processor.setFont (font);
+	UShort glyphNum = font->getGlyphNum();
+	hashes.assign ((maxPPEM - minPPEM + 1) * glyphNum, 0);
+	InstructionProcessor::Points points;
+
+	for (ULong ppem = minPPEM; ppem <= maxPPEM; ppem ++) {
+		try {
+			processor.setPPEM (ppem, ppem, ppem * 3 / 4);
+		} catch (...) {
+			continue;
+		}
+		for (UShort i = 0; i < glyphNum; i ++) {
+			UShort glyphId = (firstGlyph + i) % glyphNum;
+			try {
+				processor.getGlyphPoints (glyphId, points);
+			} catch (...) {
+				continue;
+			}
+			ULong hash = 2166136261u;
+			for (InstructionProcessor::Points::iterator point = points.begin();
+				point != points.end(); point ++)
+			{
+				Long values [] = { point->currentX.get_i(), point->currentY.get_i(),
+					point->originalX.get_i(), point->originalY.get_i(),
+					point->onCurve + 2 * point->lastContourPoint };
+				for (int v = 0; v < 5; v ++)
+					hash = (hash ^ ULong (values [v])) * 16777619u;
+			}
+			hashes [(ppem - minPPEM) * glyphNum + glyphId] = hash | 1;
+		}
+	}
+}
+
+class HintTask : public util::parallel_task {
+	smart_ptr <OpenTypeFont> font;
+	vector <vector <ULong> > &hashes;
+public:
+	HintTask (smart_ptr <OpenTypeFont> aFont, vector <vector <ULong> > &aHashes)
+		: font (aFont), hashes (aHashes) {}
+
+	virtual void run (size_t begin, size_t end) {
+		for (size_t thread = begin; thread != end; thread ++)
+			hintFont (font, UShort (thread * font->getGlyphNum() / threadNum), hashes [thread]);
+	}
+};
+
+bool testFont (const char *fileName) {
+	smart_ptr <OpenTypeFont> serialFont = new QuietOpenTypeFont;
+	serialFont->readFromFile (fileName);
+	vector <ULong> expected;
+	hintFont (serialFont, 0, expected);
+
+	smart_ptr <OpenTypeFont> sharedFont = new QuietOpenTypeFont;
+	sharedFont->readFromFile (fileName);
+	sharedFont->freeze();
+	vector <vector <ULong> > hashes (threadNum);
+	HintTask task (sharedFont, hashes);
+	util::set_thread_num (threadNum);
+	bool completed = util::parallel_for (task, threadNum);
+
+	ULong hinted = 0, different = 0;
+	for (ULong i = 0; i < expected.size(); i ++) {
+		if (expected [i])
+			hinted ++;
+	}
+	for (int thread = 0; thread < threadNum; thread ++) {
+		for (ULong i = 0; i < expected.size(); i ++) {
+			if (i >= hashes [thread].size() || hashes [thread] [i] != expected [i])
+				different ++;
+		}
+	}
+
+	cout << fileName << ": " << serialFont->getGlyphNum() << " glyphs at " <<
+		(maxPPEM - minPPEM + 1) << " sizes, " << hinted << " hinted, " << different <<
+		" different in " << threadNum << " threads" << endl;
+	return completed && different == 0;
+}
+
+enum { batchMinPPEM = 9, batchMaxPPEM = 72 };
+
+// The glyph ids in reverse, so that job j is not glyph j
+void getBatchGlyphs (UShort glyphNum, BatchHinter::GlyphIds &glyphIds) {
+	glyphIds.clear();
+	for (UShort i = glyphNum; i != 0; i --)
+		glyphIds.push_back (i - 1);
+}
+
+void getBatchSizes (BatchHinter::Sizes &sizes) {
+	sizes.clear();
+	for (ULong ppem = batchMinPPEM; ppem <= batchMaxPPEM; ppem ++) {
+		BatchHinter::Size size = { ppem, ppem, ppem * 3 / 4 };
+		sizes.push_back (size);
+	}
+}
+
+// The number of jobs in batch that are different from hinting with
+// processor, which hints the same font
+ULong compareBatch (QuietInstructionProcessor &processor, const BatchHinter::GlyphIds &glyphIds,
+	const BatchHinter::Sizes &sizes, const BatchHinter::HintedPoints &batch)
+{
+	ULong different = 0;
+	InstructionProcessor::Points points;
+	for (ULong s = 0; s < sizes.size(); s ++) {
+		String sizeError;
+		try {
+			processor.setPPEM (sizes [s].ppemX, sizes [s].ppemY, sizes [s].pointSize);
+		} catch (Exception &e) {
+			sizeError = e.getFullDescription();
+		} catch (util::overflow_exception &) {
+			sizeError = "Overflow while setting point sizes";
+		}
+
+		for (ULong g = 0; g < glyphIds.size(); g ++) {
+			String error = sizeError;
+			points.clear();
+			if (error.empty()) {
+				try {
+					processor.getGlyphPoints (glyphIds [g], points);
+				} catch (Exception &e) {
+					error = e.getFullDescription();
+					points.clear();
+				} catch (util::overflow_exception &) {
+					error = "Overflow while hinting glyph " + String (glyphIds [g]);
+					points.clear();
+				}
+			}
+
+			ULong job = batch.getJob (s, g);
+			ULong begin = batch.pointBegin [job];
+			bool same = batch.errors [job] == error &&
+				batch.pointBegin [job + 1] - begin == points.size();
+			for (ULong i = 0; same && i < points.size(); i ++) {
+				const InstructionProcessor::GridFittedPoint &point = points [i];
+				Byte flags = (point.onCurve ? BatchHinter::pfOnCurve : 0) |
+					(point.touchedX ? BatchHinter::pfTouchedX : 0) |
+					(point.touchedY ? BatchHinter::pfTouchedY : 0) |
+					(point.lastContourPoint ? BatchHinter::pfLastContourPoint : 0);
+				same = batch.currentX [begin + i].get_i() == point.currentX.get_i() &&
+					batch.currentY [begin + i].get_i() == point.currentY.get_i() &&
+					batch.originalX [begin + i].get_i() == point.originalX.get_i() &&
+					batch.originalY [begin + i].get_i() == point.originalY.get_i() &&
+					batch.flags [begin + i] == flags;
+			}
+			if (!same)
+				different ++;
+		}
+	}
+	return different;
+}
+
+bool testBatchHinter (const char *fileName) {
+	smart_ptr <OpenTypeFont> serialFont = new QuietOpenTypeFont;
+	serialFont->readFromFile (fileName);
+	QuietInstructionProcessor processor;
+	processor.setFont (serialFont);
+
+	smart_ptr <OpenTypeFont> batchFont = new QuietOpenTypeFont;
+	batchFont->readFromFile (fileName);
+	BatchHinter hinter (batchFont);
+
+	BatchHinter::GlyphIds glyphIds;
+	getBatchGlyphs (batchFont->getGlyphNum(), glyphIds);
+	BatchHinter::Sizes sizes;
+	getBatchSizes (sizes);
+
+	// With one thread, and then with four, even on one processor, so that
+	// the work is shared; the second time the processors are reused
+	bool passed = true;
+	unsigned int threadNums [] = { 1, 4 };
+	for (int t = 0; t < 2; t ++) {
+		util::set_thread_num (threadNums [t]);
+		BatchHinter::HintedPoints batch;
+		hinter.hint (glyphIds, sizes, batch);
+		ULong different = compareBatch (processor, glyphIds, sizes, batch);
+		ULong errorNum = 0;
+		for (ULong job = 0; job < batch.errors.size(); job ++) {
+			if (!batch.errors [job].empty())
+				errorNum ++;
+		}
+		cout << fileName << ": " << glyphIds.size() << " glyphs at " << sizes.size() <<
+			" sizes in a batch, " << errorNum << " errors, " << different <<
+			" different in " << threadNums [t] << " threads" << endl;
+		if (different != 0 || batch.pointBegin.size() != batch.errors.size() + 1)
+			passed = false;
+	}
+	return passed;
+}
+
+int main (int argc, char **argv) {
+	if (argc < 2) {
+		cout << "Usage: threadtest font..." << endl;
+		return 1;
+	}
+	bool passed = true;
+	for (int i = 1; i < argc; i ++) {
+		try {
+			if (!testFont (argv [i]))
+				passed = false;
+			if (!testBatchHinter (argv [i]))
+				passed = false;
+		} catch (Exception &e) {
+			cout << "Error: " << e << endl;
+			passed = false;
+		}
+	}
+	return passed ? 0 : 1;
+}
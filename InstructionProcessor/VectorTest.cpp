@@ -0,0 +1,248 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	\file VectorTest checks the integer vector arithmetic of
+	InstructionProcessor: squareRoot at its edges, setUnitVector against
+	long double on random vectors and against values that FreeType's
+	TrueType interpreter (version 35) produced for SPVFS and SPVTL,
+	projectOnto against FreeType's GC results, and weightedAverage and
+	ppemAlong.
+*/
+
+#include <iostream>
+#include <cmath>
+
+#include "InstructionProcessor.h"
+
+using std::cout;
+using std::endl;
+using namespace OpenType;
+
+typedef util::unsigned_long_long_int UnsignedLongLong;
+
+namespace {
+
+	// Makes the vector arithmetic, which is protected, available
+	class Arithmetic : public InstructionProcessor {
+	public:
+		using InstructionProcessor::squareRoot;
+		using InstructionProcessor::setUnitVector;
+		using InstructionProcessor::projectOnto;
+		using InstructionProcessor::weightedAverage;
+		using InstructionProcessor::ppemAlong;
+	};
+
+	ULong failures = 0;
+
+	void check (bool passed, const char *what, LongLong a, LongLong b,
+		LongLong result, LongLong expected)
+	{
+		if (!passed) {
+			if (failures < 20)
+				cout << what << " (" << a << ", " << b << "): " << result <<
+					" instead of " << expected << endl;
+			failures ++;
+		}
+	}
+
+	Arithmetic::Vector unitVector (Long x, Long y) {
+		Arithmetic::Vector vector;
+		Arithmetic::setUnitVector (vector,
+			NewF26Dot6 (x, util::fixed_fraction()), NewF26Dot6 (y, util::fixed_fraction()));
+		return vector;
+	}
+
+	void checkSquareRoot (UnsignedLongLong n, UnsignedLongLong expected) {
+		UnsignedLongLong root = Arithmetic::squareRoot (n);
+		check (root == expected, "squareRoot", n >> 32, n & 0xFFFFFFFFu,
+			root, expected);
+	}
+
+	void testSquareRoot() {
+		checkSquareRoot (0, 0);
+		checkSquareRoot (1, 1);
+		checkSquareRoot (2, 1);
+		checkSquareRoot (3, 1);
+		checkSquareRoot (4, 2);
+		UnsignedLongLong roots [] = { 5, 1000, 46341, 65535, 65536,
+			0x7FFFFFFFu, 0x80000000u, 0x80000001u, 0xFFFFFFFEu, 0xFFFFFFFFu };
+		for (int i = 0; i < 10; i ++) {
+			UnsignedLongLong root = roots [i];
+			checkSquareRoot (root * root, root);
+			checkSquareRoot (root * root - 1, root - 1);
+			checkSquareRoot (root * root + 2 * root, root);
+		}
+		UnsignedLongLong twoTo62 = UnsignedLongLong (1) << 62;
+		checkSquareRoot (twoTo62, 0x80000000u);
+		checkSquareRoot (twoTo62 - 1, 0x7FFFFFFFu);
+		checkSquareRoot (twoTo62 + 1, 0x80000000u);
+		checkSquareRoot (~UnsignedLongLong (0), 0xFFFFFFFFu);
+	}
+
+	// FreeType's Newton iteration stops within a few units of 2^-16, and
+	// the result is then truncated to 2.14, so every component should be
+	// within two units of the exact value. (x, y) should keep its signs.
+	void testUnitVectorRandom() {
+		ULong random = 12345;
+		for (int i = 0; i < 200000; i ++) {
+			random = random * 1103515245 + 12345;
+			Long x = Long (random >> 8) >> (random & 15);
+			random = random * 1103515245 + 12345;
+			Long y = Long (random >> 8) >> (random & 15);
+			random = random * 1103515245 + 12345;
+			if (random & 0x100)
+				x = -x;
+			if (random & 0x200)
+				y = -y;
+			if (x == 0 && y == 0)
+				continue;
+
+			Arithmetic::Vector vector = unitVector (x, y);
+			long double length = std::sqrt ((long double) x * x + (long double) y * y);
+			long double exactX = x * 16384.0L / length;
+			long double exactY = y * 16384.0L / length;
+			check (std::fabs (vector.x.get_i() - exactX) < 2 && vector.x.get_i() * exactX >= 0,
+				"setUnitVector x", x, y, vector.x.get_i(), LongLong (exactX));
+			check (std::fabs (vector.y.get_i() - exactY) < 2 && vector.y.get_i() * exactY >= 0,
+				"setUnitVector y", x, y, vector.y.get_i(), LongLong (exactY));
+		}
+	}
+
+	// From SPVFS and SPVTL in FreeType 2.12, with the differences
+	// between the points that SPVTL was given
+	struct UnitVectorCase {
+		Long x, y;
+		Short expectedX, expectedY;
+	};
+
+	const UnitVectorCase unitVectorCases [] = {
+		{ 1, 1, 11585, 11585 },
+		{ 3, 4, 9830, 13107 },
+		{ 5460, 15447, 5460, 15447 },
+		{ 16384, 16384, 11585, 11585 },
+		{ -3, 7, -6454, 15059 },
+		{ 100, -1, 16383, -163 },
+		{ 32767, 1, 16383, 0 },
+		{ 12345, 678, 16359, 898 },
+		{ -1, -1, -11585, -11585 },
+		{ 11585, 11585, 11585, 11585 },
+		{ -16384, 1, -16383, 0 },
+		{ 1, -16384, 0, -16383 },
+		{ -32768, -32768, -11585, -11585 },
+		{ 9, -38, 3775, -15943 },
+		{ 15, 35, 6454, 15059 },
+		{ -32, -21, -13698, -8989 },
+		{ -9837, -12378, -10193, -12826 },
+		{ 4, -2, 14654, -7327 },
+		{ 5516, 10014, 7905, 14351 },
+		{ 7, -2, 15753, -4501 },
+		{ -1, 0, -16384, 0 },
+		{ 3236, -10566, 4797, -15665 },
+		{ -407, -942, -6498, -15040 },
+		{ 5, -7, 9523, -13332 },
+		{ -1, 6, -2693, 16161 },
+		{ -499, 131, -15847, 4160 },
+		{ 926, 1300, 9505, 13344 },
+		{ -10595, -2416, -15974, -3642 },
+		{ -2897, 6179, -6955, 14834 },
+		{ 2968, -4464, 9071, -13643 },
+		{ 3, -1, 15543, -5181 },
+		{ 0, 1, 0, 16384 }
+	};
+
+	// From SPVFS followed by GC in FreeType 2.12
+	struct ProjectionCase {
+		Long vectorX, vectorY;
+		Long x, y;
+		Long expected;
+	};
+
+	const ProjectionCase projectionCases [] = {
+		// (11356, -3) becomes (16384, -4), which FreeType takes as the x axis
+		{ 11356, -3, 12244, -27693, 12244 },
+		{ -15933, -15178, 823, -660, -141 },
+		{ -13597, 1011, 28954, -8611, -29511 },
+		{ -643, -10345, -11314, 17539, -16803 },
+		{ 7202, 11288, 8207, 4417, 8138 },
+		{ -7880, -12000, 54, 846, -737 },
+		{ 3621, -3420, 12620, 27014, -9373 },
+		{ -11117, -9659, -4880, 13376, -5089 },
+		{ -5154, 7125, 8055, 5431, -321 },
+		{ 15397, 1817, 632, -776, 537 }
+	};
+
+	void testFreeTypeCases() {
+		for (size_t i = 0; i < sizeof (unitVectorCases) / sizeof (UnitVectorCase); i ++) {
+			const UnitVectorCase &c = unitVectorCases [i];
+			Arithmetic::Vector vector = unitVector (c.x, c.y);
+			check (vector.x.get_i() == c.expectedX, "setUnitVector x", c.x, c.y,
+				vector.x.get_i(), c.expectedX);
+			check (vector.y.get_i() == c.expectedY, "setUnitVector y", c.x, c.y,
+				vector.y.get_i(), c.expectedY);
+		}
+
+		for (size_t i = 0; i < sizeof (projectionCases) / sizeof (ProjectionCase); i ++) {
+			const ProjectionCase &c = projectionCases [i];
+			NewF26Dot6 projection = Arithmetic::projectOnto (
+				NewF26Dot6 (c.x, util::fixed_fraction()), NewF26Dot6 (c.y, util::fixed_fraction()),
+				unitVector (c.vectorX, c.vectorY));
+			check (projection.get_i() == c.expected, "projectOnto", c.x, c.y,
+				projection.get_i(), c.expected);
+		}
+	}
+
+	void testWeightedAverage() {
+		Arithmetic::Vector vector;
+		vector.x = F2Dot14 (5460, util::fixed_fraction());
+		vector.y = F2Dot14 (15447, util::fixed_fraction());
+		// The vector is slightly shorter than 1, which weightedAverage
+		// shows. This used to be 293072, since the 128-bit emulation in
+		// double_precision.h dropped carries.
+		F18Dot14 average = Arithmetic::weightedAverage (24, 24, vector);
+		check (average.get_i() == 393206, "weightedAverage", 24, 24,
+			average.get_i(), 393206);
+		// With square pixels, the ppem does not depend on the vector
+		F18Dot14 ppem = Arithmetic::ppemAlong (24, 24, vector);
+		check (ppem == F18Dot14 (24), "ppemAlong", 24, 24, ppem.get_i(), 24 << 14);
+		ppem = Arithmetic::ppemAlong (24, 12, vector);
+		average = Arithmetic::weightedAverage (24, 12, vector);
+		check (ppem == average, "ppemAlong", 24, 12, ppem.get_i(), average.get_i());
+
+		// Along the axes, the result is exact
+		vector = unitVector (1, 0);
+		average = Arithmetic::weightedAverage (24, 12, vector);
+		check (average == F18Dot14 (24), "weightedAverage", 24, 12, average.get_i(), 24 << 14);
+		vector = unitVector (0, -1);
+		average = Arithmetic::weightedAverage (24, 12, vector);
+		check (average == F18Dot14 (12), "weightedAverage", 24, 12, average.get_i(), 12 << 14);
+	}
+
+}	// end anonymous namespace
+
+int main() {
+	testSquareRoot();
+	testUnitVectorRandom();
+	testFreeTypeCases();
+	testWeightedAverage();
+	cout << "Vector arithmetic: " << failures << " wrong" << endl;
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	\file ChecksumTest checks MemoryBlock::getChecksum, which has SSE2 and
+	SSSE3 versions, against the plain sum of ULongs for every length from
+	0 to 300 bytes at every offset from 0 to 15. With -b it also measures
+	how fast it is for blocks from 1 KB to 50 MB.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include "OTMemoryBlock.h"
+#include "OTException.h"
+
+using std::cout;
+using std::endl;
+using std::vector;
+using namespace OpenType;
+
+// The checksum as the OpenType specification defines it
+ULong referenceChecksum (const Byte *memory, ULong size) {
+	ULong checksum = 0;
+	for (ULong i = 0; i < size; i ++)
+		checksum += ULong (memory [i]) << (24 - 8 * (i % 4));
+	return checksum;
+}
+
+bool checkChecksums (const char *fileName) {
+	vector <Byte> data (1024);
+	ULong random = 12345;
+	for (ULong i = 0; i < data.size(); i ++) {
+		random = random * 1103515245 + 12345;
+		data [i] = Byte (random >> 16);
+	}
+	{
+		std::ofstream file (fileName, std::ios::binary);
+		file.write ((const char *) &data [0], data.size());
+	}
+
+	// Views into the file are not copied, so they are at any alignment
+	MemoryMapPtr map = new MemoryMap (fileName);
+	ULong failures = 0, checks = 0;
+	for (ULong offset = 0; offset < 16; offset ++) {
+		for (ULong length = 0; length <= 300; length ++) {
+			ULong expected = referenceChecksum (&data [offset], length);
+			ULong checksum = 0;
+			if (length)
+				checksum = MemoryBlock (map, offset, length).getChecksum();
+			checks ++;
+			if (checksum != expected) {
+				if (failures < 10)
+					cout << "Offset " << offset << ", length " << length << ": checksum " <<
+						std::hex << checksum << " instead of " << expected << std::dec << endl;
+				failures ++;
+			}
+		}
+	}
+	map = NULL;
+	std::remove (fileName);
+
+	cout << checks << " checksums, " << failures << " wrong" << endl;
+	return failures == 0;
+}
+
+void benchmark() {
+	ULong sizes [] = { 1 << 10, 64 << 10, 1 << 20, 16 << 20, 50 << 20 };
+	for (int i = 0; i < 5; i ++) {
+		vector <Byte> data (sizes [i], 0x5A);
+		MemoryBlock block (&data [0], sizes [i]);
+		// Add up about 1 GB
+		ULong repeats = (1 << 30) / sizes [i];
+		ULong checksum = 0;
+		clock_t start = clock();
+		for (ULong r = 0; r < repeats; r ++)
+			checksum += block.getChecksum();
+		double seconds = double (clock() - start) / CLOCKS_PER_SEC;
+		clock_t referenceStart = clock();
+		for (ULong r = 0; r < repeats; r ++)
+			checksum -= referenceChecksum (&data [0], sizes [i]);
+		double referenceSeconds = double (clock() - referenceStart) / CLOCKS_PER_SEC;
+
+		double bytes = double (sizes [i]) * repeats;
+		cout << (sizes [i] >> 10) << " KB: " << bytes / seconds / 1e9 << " GB/s, byte by byte " <<
+			bytes / referenceSeconds / 1e9 << " GB/s" << (checksum ? " (wrong)" : "") << endl;
+	}
+}
+
+int main (int argc, char **argv) {
+	try {
+		bool passed = checkChecksums ("checksumtest.tmp");
+		if (argc > 1 && strcmp (argv [1], "-b") == 0)
+			benchmark();
+		return passed ? 0 : 1;
+	} catch (Exception &e) {
+		cout << "Error: " << e << endl;
+		return 1;
+	}
+}
@@ -25,6 +25,8 @@
 #endif
 
 #include <cassert>
+#include <cstring>
+#include <algorithm>
 #include "OTException.h"
 #include "OpenTypeFile.h"
 
@@ -34,15 +36,28 @@ using util::String;
 
 namespace OpenType {
 
-std::vector <String> exceptionContext;
-std::vector <String> exceptionFont;
+#if defined (_MSC_VER)
+#define OTEXCEPTION_THREAD_LOCAL __declspec (thread)
+#elif defined (__GNUC__)
+#define OTEXCEPTION_THREAD_LOCAL __thread
+#else
+#define OTEXCEPTION_THREAD_LOCAL
+#endif
+
+// The innermost contexts of the current thread. Each of them points to the
+// one outside it.
+OTEXCEPTION_THREAD_LOCAL const Exception::Context *exceptionContext = NULL;
+OTEXCEPTION_THREAD_LOCAL const Exception::FontContext *exceptionFont = NULL;
 
 Exception::Exception (String description)
 {
-	if (!exceptionFont.empty())
-		context.push_back ("Font \"" + exceptionFont.back() + '"');
-	std::copy (exceptionContext.begin(), exceptionContext.end(),
-		std::back_insert_iterator <Strings> (context));
+	if (exceptionFont)
+		context.push_back ("Font \"" + exceptionFont->font.getFileName() + '"');
+	Strings::size_type fontContextNum = context.size();
+	for (const Context *c = exceptionContext; c; c = c->previous)
+		context.push_back (c->getDescription());
+	// The contexts were found innermost first
+	std::reverse (context.begin() + fontContextNum, context.end());
 	descriptions.push_back (description);
 }
 
@@ -89,22 +104,98 @@ ostream & operator << (ostream &o, const Exception & e) {
 
 // Exception::FontContext
 
-Exception::FontContext::FontContext (const OpenTypeFile &font) {
-	exceptionFont.push_back (font.getFileName());
+Exception::FontContext::FontContext (const OpenTypeFile &aFont)
+: font (aFont), previous (exceptionFont)
+{
+	exceptionFont = this;
 }
 
 Exception::FontContext::~FontContext() {
-	exceptionFont.pop_back();
+	exceptionFont = previous;
 }
 
 // Exception::Context
 
-Exception::Context::Context (String contextDescription) {
-	exceptionContext.push_back (contextDescription);
+Exception::Context::Context (String contextDescription)
+: format (NULL), description (contextDescription), previous (exceptionContext)
+{
+	exceptionContext = this;
+}
+
+Exception::Context::Context (const char *aFormat)
+: format (aFormat), previous (exceptionContext)
+{
+	exceptionContext = this;
+}
+
+Exception::Context::Context (const char *aFormat, const ContextArgument &argument1)
+: format (aFormat), previous (exceptionContext)
+{
+	arguments [0] = argument1;
+	exceptionContext = this;
+}
+
+Exception::Context::Context (const char *aFormat, const ContextArgument &argument1,
+							 const ContextArgument &argument2)
+: format (aFormat), previous (exceptionContext)
+{
+	arguments [0] = argument1;
+	arguments [1] = argument2;
+	exceptionContext = this;
+}
+
+Exception::Context::Context (const char *aFormat, const ContextArgument &argument1,
+							 const ContextArgument &argument2, const ContextArgument &argument3)
+: format (aFormat), previous (exceptionContext)
+{
+	arguments [0] = argument1;
+	arguments [1] = argument2;
+	arguments [2] = argument3;
+	exceptionContext = this;
+}
+
+String Exception::Context::getDescription() const {
+	if (!format)
+		return description;
+
+	String result;
+	const char *f = format;
+	const char *p;
+	while ((p = strchr (f, '%')) != NULL) {
+		if (p [1] >= '1' && p [1] <= '3' &&
+			arguments [p [1] - '1'].type != ContextArgument::atNone)
+		{
+			result += String (f, p - f);
+			result += arguments [p [1] - '1'].toString();
+			f = p + 2;
+		} else {
+			result += String (f, p - f + 1);
+			f = p + 1;
+		}
+	}
+	result += f;
+	return result;
+}
+
+// Exception::ContextArgument
+
+String Exception::ContextArgument::toString() const {
+	switch (type) {
+	case atInteger:
+		return String (int (number));
+	case atUnsigned:
+		return String (number);
+	case atCharacters:
+		return characters;
+	case atString:
+		return string;
+	default:
+		return String();
+	}
 }
 
 Exception::Context::~Context() {
-	exceptionContext.pop_back();
+	exceptionContext = previous;
 }
 
 } // end namespace OpenType
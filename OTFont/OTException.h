@@ -50,8 +50,9 @@ namespace OpenType {
 		data about the error that occurred.
 
 		A function may define a Exception::Context or Exception::FontContext
-		variable (which does not take any space on the stack) to define
-		the current context.
+		variable to define the current context.
+		The context is kept per thread, so that several threads can
+		construct Exceptions at the same time.
 	*/
 
 	class Exception {
@@ -96,16 +97,62 @@ namespace OpenType {
 		/// \brief FontContext makes it easy to specify the current
 		/// font just in case there will be an error.
 		class FontContext {
+			friend class Exception;
+			const OpenTypeFile &font;
+			const FontContext *previous;
 		public:
 			FontContext (const OpenTypeFile &font);
 			~FontContext();
 		};
 
+		class Context;
+
+		/// \brief An argument to a Context description, which is kept as it
+		/// is until the description is needed.
+		class ContextArgument {
+			friend class Context;
+			enum Type { atNone, atInteger, atUnsigned, atCharacters, atString };
+			Type type;
+			unsigned int number;
+			const char *characters;
+			util::String string;
+			util::String toString() const;
+		public:
+			ContextArgument() : type (atNone) {}
+			ContextArgument (int i) : type (atInteger), number (i) {}
+			ContextArgument (unsigned int i) : type (atUnsigned), number (i) {}
+			/// s must remain valid while the Context exists.
+			ContextArgument (const char *s) : type (atCharacters), characters (s) {}
+			ContextArgument (const util::String &s) : type (atString), string (s) {}
+		};
+
 		/// \brief Context makes it easy to specify the current context just in
 		/// case there will be an error.
+		///
+		/// The description can be given as a format, a string literal in
+		/// which "%1", "%2" and "%3" are replaced by the arguments, for
+		/// example
+		/// Exception::Context c ("loading glyph %1 '%2'", glyphId, name);
+		/// The description is produced only when an Exception is constructed,
+		/// so that this does not allocate memory, and is cheap enough to use
+		/// on fast paths.
 		class Context {
+			friend class Exception;
+			const char *format;
+			util::String description;
+			ContextArgument arguments [3];
+			const Context *previous;
+
+			util::String getDescription() const;
 		public:
 			Context (util::String contextDescription);
+			/// format must remain valid while the Context exists.
+			Context (const char *format);
+			Context (const char *format, const ContextArgument &argument1);
+			Context (const char *format, const ContextArgument &argument1,
+				const ContextArgument &argument2);
+			Context (const char *format, const ContextArgument &argument1,
+				const ContextArgument &argument2, const ContextArgument &argument3);
 			~Context();
 		};
 	};
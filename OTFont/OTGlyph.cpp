@@ -120,6 +120,16 @@ UShort CompositeComponent::getDepth() const {
 	return font.getGlyph (glyphIndex)->getCompositeDepth() + 1;
 }
 
+UShort CompositeComponent::getScaleByteSize() const {
+	if (scale.xy == 0 && scale.yx == 0) {
+		if (scale.xx == scale.yy)
+			return scale.xx != 1 ? 2 : 0;
+		else
+			return 4;
+	} else
+		return 8;
+}
+
 
 /*** PositionedCompositeComponent ***/
 
@@ -147,6 +157,13 @@ std::pair <CompositeComponent::Translation, Contours>
 	return std::pair <Translation, Contours> (translation, contours);
 }
 
+UShort PositionedCompositeComponent::getByteSize() const {
+	// flags, glyphIndex, arguments, scale
+	bool argsAreWords = translation.x < -0x80 || translation.x >= 0x80 ||
+		translation.y < -0x80 || translation.y >= 0x80;
+	return 4 + (argsAreWords ? 4 : 2) + getScaleByteSize();
+}
+
 void PositionedCompositeComponent::write (MemoryWritePen &pen, UShort extraFlags) const {
 	// Flags need to be written when everything is known, so let's save the current flag position
 	MemoryWritePen flagsPen = pen;
@@ -239,6 +256,12 @@ CompositeComponent::Translation AttachedCompositeComponent::getTranslation() con
 }
 
 
+UShort AttachedCompositeComponent::getByteSize() const {
+	// flags, glyphIndex, arguments, scale
+	bool argsAreWords = p1 >= 0x100 || p2 >= 0x100;
+	return 4 + (argsAreWords ? 4 : 2) + getScaleByteSize();
+}
+
 void AttachedCompositeComponent::write (MemoryWritePen &pen, UShort extraFlags) const {
 	// extraFlags need to be written when everything is known, so let's save the current flag position
 	MemoryWritePen flagsPen = pen;
@@ -306,6 +329,10 @@ void Glyph::write (MemoryWritePen &pen) const {
 	// Writing empty glyph == writing nothing
 }
 
+ULong Glyph::getByteSize() const {
+	return 0;
+}
+
 bool Glyph::isEmpty() const {
 	return true;
 }
@@ -558,35 +585,13 @@ SimpleGlyph::SimpleGlyph (const Glyph & glyph)
 
 SimpleGlyph::~SimpleGlyph() {}
 
-void SimpleGlyph::write (MemoryWritePen &pen) const {
-	pen.writeUShort (getContourNum());
-	pen.writeShort (boundingBox.xMin);
-	pen.writeShort (boundingBox.yMin);
-	pen.writeShort (boundingBox.xMax);
-	pen.writeShort (boundingBox.yMax);
-
+// Gather the flags for all points of contours
+static void getFlags (const Contours &contours, vector <Byte> &flags) {
 	Contours::const_iterator contour;
 	Contour::const_iterator point;
-	// Write last contour points
-	UShort totalSize = UShort (-1);
-	for (contour = contours.begin(); contour != contours.end(); contour ++) {
-		totalSize += contour->size();
-		pen.writeUShort (totalSize);
-	}
-
-	// Write instructions
-	if (instructions) {
-		pen.writeUShort (instructions->getSize ());
-		pen.writeBlock (instructions);
-	} else
-		pen.writeUShort (0);
-
-	// Gather flags
-	typedef vector <Byte> Flags;
-	Flags flags;
+	flags.reserve (contours.getPointNum());
 	Short curX = 0;
 	Short curY = 0;
-	//for (point = points.begin(); point != points.end(); point ++) {
 	for (contour = contours.begin(); contour != contours.end(); contour ++) {
 		point = contour->begin();
 		do {
@@ -624,6 +629,35 @@ void SimpleGlyph::write (MemoryWritePen &pen) const {
 			++ point;
 		} while (point != contour->begin());
 	}
+}
+
+void SimpleGlyph::write (MemoryWritePen &pen) const {
+	pen.writeUShort (getContourNum());
+	pen.writeShort (boundingBox.xMin);
+	pen.writeShort (boundingBox.yMin);
+	pen.writeShort (boundingBox.xMax);
+	pen.writeShort (boundingBox.yMax);
+
+	Contours::const_iterator contour;
+	Contour::const_iterator point;
+	// Write last contour points
+	UShort totalSize = UShort (-1);
+	for (contour = contours.begin(); contour != contours.end(); contour ++) {
+		totalSize += contour->size();
+		pen.writeUShort (totalSize);
+	}
+
+	// Write instructions
+	if (instructions) {
+		pen.writeUShort (instructions->getSize ());
+		pen.writeBlock (instructions);
+	} else
+		pen.writeUShort (0);
+
+	// Gather flags
+	typedef vector <Byte> Flags;
+	Flags flags;
+	getFlags (contours, flags);
 
 	// Write flags
 	Flags::iterator flag;
@@ -645,7 +679,7 @@ void SimpleGlyph::write (MemoryWritePen &pen) const {
 	}
 
 	// Write Xs
-	curX = 0;
+	Short curX = 0;
 	flag = flags.begin();
 	for (contour = contours.begin(); contour != contours.end(); contour ++) {
 		point = contour->begin();
@@ -666,7 +700,7 @@ void SimpleGlyph::write (MemoryWritePen &pen) const {
 	}
 
 	// Write Ys
-	curY = 0;
+	Short curY = 0;
 	flag = flags.begin();
 	for (contour = contours.begin(); contour != contours.end(); contour ++) {
 		point = contour->begin();
@@ -688,6 +722,40 @@ void SimpleGlyph::write (MemoryWritePen &pen) const {
 	// That's all.
 }
 
+ULong SimpleGlyph::getByteSize() const {
+	// contourNum, bounding box, endPtsOfContours, instructionLength
+	ULong size = 10 + 2 * contours.size() + 2;
+	if (instructions)
+		size += instructions->getSize();
+
+	typedef vector <Byte> Flags;
+	Flags flags;
+	getFlags (contours, flags);
+
+	// Flags; runs of up to 256 equal flags take two bytes
+	Flags::const_iterator flag = flags.begin();
+	while (flag != flags.end()) {
+		Flags::const_iterator runEnd = flag + 1;
+		while (runEnd != flags.end() && *runEnd == *flag && runEnd - flag < 0x100)
+			runEnd ++;
+		size += (runEnd - flag == 1) ? 1 : 2;
+		flag = runEnd;
+	}
+
+	// Coordinates
+	for (flag = flags.begin(); flag != flags.end(); flag ++) {
+		if (*flag & pfXShort)
+			size += 1;
+		else if (!(*flag & pfXSame))
+			size += 2;
+		if (*flag & pfYShort)
+			size += 1;
+		else if (!(*flag & pfYSame))
+			size += 2;
+	}
+	return size;
+}
+
 bool SimpleGlyph::isEmpty() const {
 	return false;
 }
@@ -823,6 +891,17 @@ void CompositeGlyph::write (MemoryWritePen &pen) const {
 	}
 }
 
+ULong CompositeGlyph::getByteSize() const {
+	// contourNum, bounding box
+	ULong size = 10;
+	Components::const_iterator c;
+	for (c = components.begin(); c != components.end(); c ++)
+		size += (*c)->getByteSize();
+	if (instructions)
+		size += 2 + instructions->getSize();
+	return size;
+}
+
 bool CompositeGlyph::isEmpty() const {
 	return false;
 }
@@ -111,6 +111,9 @@ namespace OpenType {
 
 		Contours getScaledContours() const;
 		virtual void write (MemoryWritePen &pen, UShort extraFlags) const = 0;
+		/// Return the number of bytes write() will write.
+		virtual UShort getByteSize() const = 0;
+		UShort getScaleByteSize() const;
 		friend class CompositeGlyph;
 	public:
 		CompositeComponent (OpenTypeFont &aFont, UShort aGlyphIndex, Flags aFlags,
@@ -138,6 +141,7 @@ namespace OpenType {
 		Translation translation;
 	protected:
 		virtual void write (MemoryWritePen &pen, UShort extraFlags) const;
+		virtual UShort getByteSize() const;
 	public:
 		PositionedCompositeComponent (OpenTypeFont &aFont, UShort glyphIndex, Flags aFlags,
 			Scale aScale, Translation aTranslation);
@@ -155,6 +159,7 @@ namespace OpenType {
 		UShort p1, p2;
 	protected:
 		virtual void write (MemoryWritePen &pen, UShort extraFlags) const;
+		virtual UShort getByteSize() const;
 	public:
 		AttachedCompositeComponent (OpenTypeFont &aFont, UShort glyphIndex, Flags aFlags,
 			Scale aScale, UShort aP1, UShort aP2);
@@ -207,6 +212,8 @@ namespace OpenType {
 		}
 
 		virtual void write (MemoryWritePen &pen) const;
+		/// Return the number of bytes write() will write, without padding.
+		virtual ULong getByteSize() const;
 
 		friend class maxpTable;
 		virtual void getMaximumProfile (maxpTable *maxp) const;
@@ -260,6 +267,7 @@ namespace OpenType {
 		virtual ~SimpleGlyph();
 
 		virtual void write (MemoryWritePen &pen) const;
+		virtual ULong getByteSize() const;
 		virtual bool isEmpty() const;
 		virtual UShort getPointNum() const;
 		virtual UShort getContourNum() const;
@@ -287,6 +295,7 @@ namespace OpenType {
 		virtual ~CompositeGlyph();
 
 		virtual void write (MemoryWritePen &pen) const;
+		virtual ULong getByteSize() const;
 		virtual bool isEmpty() const;
 		virtual bool isComposite() const;
 		virtual UShort getPointNum() const;
@@ -455,16 +455,17 @@ CoverageSingleTable::CoverageSingleTable (MemoryPen pen, OpenTypeFont &font) {
 	// format id = 1
 	pen.readUShort();
 	UShort glyphCount = pen.readUShort();
-	glyphIds.reserve (glyphCount);
+	glyphIds.resize (glyphCount);
+	if (glyphCount)
+		pen.readUShortArray (&glyphIds.front(), glyphCount);
 	UShort lastOne;
 	for (UShort i = 0; i < glyphCount; i ++) {
-		UShort newOne = pen.readUShort();
+		UShort newOne = glyphIds [i];
 		if (i != 0 && newOne <= lastOne) {
 			// Palatino seems to fail this test?????
 			throw Exception ("Coverage table glyphs are not in increasing order: " +
 				String (lastOne) + " comes before " + String (newOne));
 		}
-		glyphIds.push_back (newOne);
 		lastOne = newOne;
 	}
 
@@ -509,15 +510,19 @@ CoverageRangeTable::CoverageRangeTable (MemoryPen pen, OpenTypeFont &font) {
 	// format id = 2
 	pen.readUShort();
 	UShort rangeNum = pen.readUShort();
+	// start, end, startCoverageIndex
+	std::vector <UShort> values (3 * rangeNum);
+	if (rangeNum)
+		pen.readUShortArray (&values.front(), values.size());
 	ranges.reserve (rangeNum);
 	UShort lastOne;
 	for (UShort i = 0; i < rangeNum; i ++) {
 		Range r;
-		r.start = pen.readUShort();
+		r.start = values [3*i];
 		if (i > 0 && r.start <= lastOne)
 			throw Exception ("Coverage table ranges should be in increasing order");
-		r.end = pen.readUShort();
-		r.startIndex = pen.readUShort();
+		r.end = values [3*i + 1];
+		r.startIndex = values [3*i + 2];
 		ranges.push_back (r);
 		lastOne = r.end;
 	}
@@ -585,9 +590,9 @@ ClassDefTable1::ClassDefTable1 (MemoryPen pen) {
 	pen.readUShort();
 	start = pen.readGlyphId();
 	UShort glyphNum = pen.readUShort();
-	classes.reserve (glyphNum);
-	for (UShort i = 0; i < glyphNum; i ++)
-		classes.push_back (pen.readUShort());
+	classes.resize (glyphNum);
+	if (glyphNum)
+		pen.readUShortArray (&classes.front(), glyphNum);
 }
 
 ClassDefTable1::~ClassDefTable1() {}
@@ -612,17 +617,21 @@ ClassDefTable2::ClassDefTable2 (MemoryPen pen) {
 	// format = 2
 	pen.readUShort();
 	UShort rangeNum = pen.readUShort();
+	// start, end, class
+	std::vector <UShort> values (3 * rangeNum);
+	if (rangeNum)
+		pen.readUShortArray (&values.front(), values.size());
 	ranges.reserve (rangeNum);
 	GlyphId lastEnd;
 	for (UShort i = 0; i < rangeNum; i ++) {
 		ClassRange r;
-		r.start = pen.readGlyphId();
+		r.start = values [3*i];
 		if (i != 0 && lastEnd >= r.start)
 			throw Exception ("Class definition ranges overlap");
-		r.end = pen.readGlyphId();
+		r.end = values [3*i + 1];
 		if (r.start > r.end)
 			throw Exception ("Class definition range structure error");
-		r.glyphClass = pen.readUShort();
+		r.glyphClass = values [3*i + 2];
 		lastEnd = r.end;
 		ranges.push_back (r);
 	}
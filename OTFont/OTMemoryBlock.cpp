@@ -23,6 +23,20 @@
 #include "OTException.h"
 #include <vector>
 
+#if defined (__SSSE3__)
+#include <tmmintrin.h>
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 using std::ifstream;
 using std::ofstream;
 
@@ -30,6 +44,165 @@ using util::String;
 
 namespace OpenType {
 
+/*** Byte swapping of arrays ***/
+
+// Copy num 16-bit values from source to destination, swapping the bytes
+// of each. source and destination need not be aligned.
+static void swapUShorts (Byte *destination, const Byte *source, size_t num) {
+	size_t i = 0;
+#if defined (__SSSE3__)
+	const __m128i order = _mm_set_epi8 (14,15, 12,13, 10,11, 8,9, 6,7, 4,5, 2,3, 0,1);
+	for (; i + 8 <= num; i += 8) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *) (source + 2*i));
+		_mm_storeu_si128 ((__m128i *) (destination + 2*i), _mm_shuffle_epi8 (v, order));
+	}
+#elif defined (__SSE2__)
+	for (; i + 8 <= num; i += 8) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *) (source + 2*i));
+		v = _mm_or_si128 (_mm_slli_epi16 (v, 8), _mm_srli_epi16 (v, 8));
+		_mm_storeu_si128 ((__m128i *) (destination + 2*i), v);
+	}
+#endif
+	for (; i < num; i ++) {
+		Byte first = source [2*i];
+		destination [2*i] = source [2*i + 1];
+		destination [2*i + 1] = first;
+	}
+}
+
+#if defined (__SSE2__)
+// Swap the bytes of each of the four 32-bit values in v.
+static inline __m128i swapULongs (__m128i v) {
+#if defined (__SSSE3__)
+	const __m128i order = _mm_set_epi8 (12,13,14,15, 8,9,10,11, 4,5,6,7, 0,1,2,3);
+	return _mm_shuffle_epi8 (v, order);
+#else
+	// Swap the bytes within the 16-bit halves, then the halves
+	v = _mm_or_si128 (_mm_slli_epi16 (v, 8), _mm_srli_epi16 (v, 8));
+	return _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (v, 0xB1), 0xB1);
+#endif
+}
+#endif
+
+// Copy num 32-bit values from source to destination, swapping the bytes
+// of each. source and destination need not be aligned.
+static void swapULongs (Byte *destination, const Byte *source, size_t num) {
+	size_t i = 0;
+#if defined (__SSE2__)
+	for (; i + 4 <= num; i += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *) (source + 4*i));
+		_mm_storeu_si128 ((__m128i *) (destination + 4*i), swapULongs (v));
+	}
+#endif
+	for (; i < num; i ++) {
+		Byte b0 = source [4*i], b1 = source [4*i + 1];
+		destination [4*i] = source [4*i + 3];
+		destination [4*i + 1] = source [4*i + 2];
+		destination [4*i + 2] = b1;
+		destination [4*i + 3] = b0;
+	}
+}
+
+/*** MemoryMap ***/
+
+MemoryMap::MemoryMap (String fileName) : memory (NULL), size (0), mapped (false) {
+#ifndef _WIN32
+	int fd = open (fileName.getCString(), O_RDONLY);
+	if (fd == -1)
+		throw Exception ("Could not open file");
+	struct stat status;
+	if (fstat (fd, &status) == -1) {
+		close (fd);
+		throw Exception ("Could not open file");
+	}
+	device = status.st_dev;
+	inode = status.st_ino;
+	size = status.st_size;
+
+	if (size) {
+		void *address = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (address != MAP_FAILED) {
+			memory = (Byte *) address;
+			mapped = true;
+		} else {
+			// Fall back to reading the file
+			memory = new Byte [size];
+			ULong done = 0;
+			while (done < size) {
+				ssize_t read_now = read (fd, memory + done, size - done);
+				if (read_now <= 0) {
+					delete [] memory;
+					close (fd);
+					throw Exception ("Could not read file");
+				}
+				done += read_now;
+			}
+		}
+	}
+	close (fd);
+#else
+	std::ifstream file (fileName.getCString(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		throw Exception ("Could not open file");
+	file.seekg (0, std::ios::end);
+	size = file.tellg();
+	file.seekg (0, std::ios::beg);
+	if (size) {
+		memory = new Byte [size];
+		if ((unsigned)file.rdbuf()->sgetn ((char *) memory, size) != size) {
+			delete [] memory;
+			throw Exception ("Could not read file");
+		}
+	}
+#endif
+}
+
+MemoryMap::~MemoryMap() {
+#ifndef _WIN32
+	if (mapped) {
+		munmap (memory, size);
+		return;
+	}
+#endif
+	if (memory)
+		delete [] memory;
+}
+
+bool MemoryMap::isFile (String fileName) const {
+#ifndef _WIN32
+	struct stat status;
+	if (stat (fileName.getCString(), &status) == -1)
+		return false;
+	return (unsigned long) status.st_dev == device &&
+		(unsigned long) status.st_ino == inode;
+#else
+	// The file has been read into memory, so it does not matter.
+	return false;
+#endif
+}
+
+void MemoryMap::detach() {
+#ifndef _WIN32
+	if (mapped) {
+		// Replace the mapping by anonymous memory with the same contents at
+		// the same address, so that views into it remain valid.
+		Byte *copy = new Byte [size];
+		memcpy (copy, memory, size);
+		void *address = mmap (memory, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+		if (address == MAP_FAILED) {
+			delete [] copy;
+			throw Exception ("Could not detach file from memory");
+		}
+		memcpy (memory, copy, size);
+		delete [] copy;
+		// munmap still applies to the anonymous memory
+	}
+#endif
+}
+
+/*** MemoryBlock ***/
+
 MemoryBlock::MemoryBlock(ULong aSize) : size(aSize) {
 	setCapacity (size);
 }
@@ -53,15 +226,35 @@ MemoryBlock::MemoryBlock (ifstream &file, ULong aSize) : size (aSize) {
 	}
 }
 
+MemoryBlock::MemoryBlock (MemoryMapPtr aMap, ULong offset, ULong aSize)
+: capacity (0), size (aSize), map (aMap)
+{
+	if (offset > map->getSize() || size > map->getSize() - offset) {
+		size = 0;
+		memory = NULL;
+		map = NULL;
+		throw Exception ("Could not read file");
+	}
+	if (size)
+		memory = const_cast <Byte *> (map->getMemory()) + offset;
+	else {
+		memory = NULL;
+		map = NULL;
+	}
+}
+
 MemoryBlock::~MemoryBlock() {
-	if (memory)
+	if (memory && !map)
 		delete [] memory;
 }
 
-void MemoryBlock::write (ofstream &file, ULong padding) {
-	ULong padSize = padWithZeros (padding);
+void MemoryBlock::write (ofstream &file, ULong padding) const {
+	static const char zeros [16] = { 0 };
+	ULong padSize = getSize (padding);
+	assert (padSize - size <= sizeof (zeros));
 
-	if ((unsigned) file.rdbuf()->sputn ((char *) memory, padSize) != padSize)
+	if ((unsigned) file.rdbuf()->sputn ((char *) memory, size) != size ||
+		(unsigned) file.rdbuf()->sputn (zeros, padSize - size) != padSize - size)
 		throw Exception ("Could not write file");
 }
 
@@ -84,42 +277,60 @@ void MemoryBlock::resizeCapacity (ULong newSize) {
 		}
 		Byte * newMemory = new Byte [capacity];
 		memcpy (newMemory, memory, size);
-		delete [] memory;
+		if (map)
+			map = NULL;
+		else
+			delete [] memory;
 		memory = newMemory;
 	}
 }
 
+void MemoryBlock::makeWritable() {
+	if (map) {
+		const Byte *view = memory;
+		setCapacity (size);
+		memcpy (memory, view, size);
+		map = NULL;
+	}
+}
+
 void MemoryBlock::resize (ULong newSize) {
 	resizeCapacity (newSize);
 	size = newSize;
 }
 
-ULong MemoryBlock::padWithZeros (ULong padding) {
-	// Calculate padding size
-	ULong padSize = getSize(padding);
-	if (padSize) {
-		resizeCapacity (padSize);
-
-		// pad with zeroes
-		ULong i = padSize-1;
-		while (i >= size) {
-			memory [i] = '\0';
-			i --;
-		}
-	}
-
-	return padSize;
-}
-
-ULong MemoryBlock::getChecksum() {
+ULong MemoryBlock::getChecksum() const {
+	// The checksum is the sum of all ULongs modulo 2^32; since the sum
+	// wraps around, the ULongs can be added up in any order.
 	ULong checksum = 0;
-	ULong *cur = (ULong *) (memory + padWithZeros (4));
-	while ((Byte *)cur != memory) {
-		cur --;
-		ULong value = *cur;
-		checksum += ((value & 0xFF) << 24) | ((value & 0xFF00) << 8) |
-			((value & 0xFF0000) >> 8) | ((value & 0xFF000000) >> 24);
+	ULong wholeSize = size & ~ULong (3);
+	const Byte *cur = memory;
+	const Byte *end = memory + wholeSize;
+#if defined (__SSE2__)
+	if (wholeSize >= 32) {
+		__m128i sum1 = _mm_setzero_si128();
+		__m128i sum2 = _mm_setzero_si128();
+		const Byte *vectorEnd = memory + (size & ~ULong (31));
+		for (; cur != vectorEnd; cur += 32) {
+			sum1 = _mm_add_epi32 (sum1,
+				swapULongs (_mm_loadu_si128 ((const __m128i *) cur)));
+			sum2 = _mm_add_epi32 (sum2,
+				swapULongs (_mm_loadu_si128 ((const __m128i *) (cur + 16))));
+		}
+		sum1 = _mm_add_epi32 (sum1, sum2);
+		sum1 = _mm_add_epi32 (sum1, _mm_shuffle_epi32 (sum1, 0x4E));
+		sum1 = _mm_add_epi32 (sum1, _mm_shuffle_epi32 (sum1, 0xB1));
+		checksum = _mm_cvtsi128_si32 (sum1);
 	}
+#endif
+	for (; cur != end; cur += 4)
+		checksum += (ULong (cur [0]) << 24) | (ULong (cur [1]) << 16) |
+			(ULong (cur [2]) << 8) | ULong (cur [3]);
+
+	// The last ULong is padded with zeros
+	ULong shift = 24;
+	for (; cur != memory + size; cur ++, shift -= 8)
+		checksum += ULong (*cur) << shift;
 	return checksum;
 }
 
@@ -207,6 +418,22 @@ LongLong MemoryPen::readLongLong() {
 	}
 }
 
+void MemoryPen::readUShortArray (UShort *values, size_t num) {
+	if (position <= block->size && num <= (block->size - position) / 2) {
+		swapUShorts ((Byte *) values, block->memory + position, num);
+		position += 2 * num;
+	} else
+		throwReadException (2 * num);
+}
+
+void MemoryPen::readULongArray (ULong *values, size_t num) {
+	if (position <= block->size && num <= (block->size - position) / 4) {
+		swapULongs ((Byte *) values, block->memory + position, num);
+		position += 4 * num;
+	} else
+		throwReadException (4 * num);
+}
+
 String MemoryPen::readString (int length) {
 	if (position + length <= block->size) {
 		String value ((char *) block->memory + position, length);
@@ -220,7 +447,13 @@ String MemoryPen::readString (int length) {
 
 MemoryBlockPtr MemoryPen::readBlock (int length) {
 	if (position + length <= block->size) {
-		MemoryBlockPtr value = new MemoryBlock (block->memory + position, length);
+		MemoryBlockPtr value;
+		if (block->map)
+			// Refer to the file data rather than copying it
+			value = new MemoryBlock (block->map,
+				block->memory - block->map->getMemory() + position, length);
+		else
+			value = new MemoryBlock (block->memory + position, length);
 		position += length;
 		return value;
 	} else {
@@ -267,8 +500,7 @@ Long MemoryWritePen::operator - (const MemoryPen &pen) const {
 }
 
 void MemoryWritePen::writeLongLong (LongLong value) {
-	if (position + 8 > block->size)
-		block->resize (position + 8);
+	block->prepareWrite (position + 8);
 	*((LongLong *) (block->memory + position)) =
 		((value & 0xFF) << 56) | ((value & 0xFF00) << 40) |
 			((value & 0xFF0000) << 24) | ((value & 0xFF000000) << 8) |
@@ -282,11 +514,18 @@ void MemoryWritePen::writeLongLong (LongLong value) {
 	position += 8;
 }
 
+void MemoryWritePen::writeUShortArray (const UShort *values, size_t num) {
+	if (num) {
+		block->prepareWrite (position + 2 * num);
+		swapUShorts (block->memory + position, (const Byte *) values, num);
+		position += 2 * num;
+	}
+}
+
 void MemoryWritePen::writeString (const String & s) {
 	int length = s.length();
 	if (length) {
-		if (position + length > block->size)
-			block->resize (position + length);
+		block->prepareWrite (position + length);
 		memcpy (block->memory + position, s.getChars(), length);
 		position += length;
 	}
@@ -294,8 +533,7 @@ void MemoryWritePen::writeString (const String & s) {
 
 void MemoryWritePen::writeBlock (MemoryBlockPtr b) {
 	if (b->size) {
-		if (position + b->size > block->size)
-			block->resize (position + b->size);
+		block->prepareWrite (position + b->size);
 		memcpy (block->memory + position, b->memory, b->size);
 		position += b->size;
 	}
@@ -304,8 +542,7 @@ void MemoryWritePen::writeBlock (MemoryBlockPtr b) {
 void MemoryWritePen::padWithZeros (ULong padding) {
 	ULong paddingLength = OT_PAD_TO (position, padding) - position;
 	if (paddingLength) {
-		if (position + paddingLength > block->size)
-			block->resize (position + paddingLength);
+		block->prepareWrite (position + paddingLength);
 		memset (block->memory + position, 0, paddingLength);
 		position += paddingLength;
 	}
@@ -40,19 +40,66 @@
 
 namespace OpenType {
 
+	/*** MemoryMap ***/
+
+	/**
+		\brief A read-only image of a complete file.
+
+		Where the platform supports it, the file is mapped into memory rather
+		than read, so that tables can refer to their data in the file without
+		copying it. MemoryBlocks constructed on a MemoryMap are views into it
+		and are only copied when they are written to.
+	*/
+
+	class MemoryMap {
+		Byte *memory;
+		ULong size;
+		bool mapped;
+#ifndef _WIN32
+		unsigned long device;
+		unsigned long inode;
+#endif
+
+	public:
+		MemoryMap (util::String fileName);
+		~MemoryMap();
+
+		const Byte *getMemory() const { return memory; }
+		ULong getSize() const { return size; }
+
+		/// Return true if fileName refers to the file this maps.
+		bool isFile (util::String fileName) const;
+		/// \brief Stop depending on the file.
+		///
+		/// The data stays at the same address, but is not affected anymore
+		/// by the file being overwritten or truncated.
+		void detach();
+	};
+
+	typedef util::smart_ptr <MemoryMap> MemoryMapPtr;
+
 	/*** MemoryBlock ***/
 
 	class MemoryBlock {
 		void setCapacity (ULong newSize);
 		void resizeCapacity (ULong newSize);
-		ULong padWithZeros (ULong padding);
+		void makeWritable();
 
 	protected:
 		Byte *memory;
 		ULong capacity;
 		ULong size;
+		/// If this is a view into a file, the file; memory is not owned then.
+		MemoryMapPtr map;
 
 		void resize (ULong newSize);
+		/// Make sure bytes up to end can be written to.
+		void prepareWrite (ULong end) {
+			if (end > size)
+				resize (end);
+			else if (map)
+				makeWritable();
+		}
 		friend class MemoryPen;
 		friend class MemoryWritePen;
 
@@ -60,6 +107,10 @@ namespace OpenType {
 		MemoryBlock (ULong aSize = 0);
 		MemoryBlock (const Byte *aMemory, ULong aSize);
 		MemoryBlock (std::ifstream &file, ULong aSize);
+		/// \brief Construct a view of aSize bytes at offset into a file.
+		///
+		/// The data is not copied until the block is written to.
+		MemoryBlock (MemoryMapPtr aMap, ULong offset, ULong aSize);
 		virtual ~MemoryBlock();
 
 		bool empty() const {
@@ -75,8 +126,8 @@ namespace OpenType {
 			return (size + padding - 1) & ~(padding-1);
 		}
 
-		ULong getChecksum();
-		void write (std::ofstream &file, ULong padding);
+		ULong getChecksum() const;
+		void write (std::ofstream &file, ULong padding) const;
 	};
 
 	typedef util::smart_ptr <MemoryBlock> MemoryBlockPtr;
@@ -162,6 +213,11 @@ namespace OpenType {
 			}
 		}
 		
+		/// Read num UShort values at once using short-endian conversion
+		void readUShortArray (UShort *values, size_t num);
+		/// Read num ULong values at once using short-endian conversion
+		void readULongArray (ULong *values, size_t num);
+
 		util::String readString (int length);
 		MemoryBlockPtr readBlock (int length);
 
@@ -200,8 +256,7 @@ namespace OpenType {
 
 		/// Write one ULong value using short-endian conversion
 		void writeULong (ULong value) {
-			if (position + 4 > block->size)
-				block->resize (position + 4);
+			block->prepareWrite (position + 4);
 			*((ULong *) (block->memory + position)) =
 				((value & 0xFF) << 24) | ((value & 0xFF00) << 8) |
 				((value & 0xFF0000) >> 8) | ((value & 0xFF000000) >> 24);
@@ -210,8 +265,7 @@ namespace OpenType {
 
 		/// Write one UShort value using short-endian conversion
 		void writeUShort (UShort value) {
-			if (position + 2 > block->size)
-				block->resize (position + 2);
+			block->prepareWrite (position + 2);
 			*((UShort *) (block->memory + position)) =
 				((value & 0xFF) << 8) | ((value & 0xFF00) >> 8);
 			position += 2;
@@ -219,20 +273,21 @@ namespace OpenType {
 
 		/// Write one Byte value using short-endian conversion
 		void writeByte (Byte value) {
-			if (position + 1 > block->size)
-				block->resize (position + 1);
+			block->prepareWrite (position + 1);
 			*(block->memory + position) = value;
 			position += 1;
 		}
 
 		/// Write one Tag value, _not_ using short-endian conversion
 		void writeTag (Tag value) {
-			if (position + 4 > block->size)
-				block->resize (position + 4);
+			block->prepareWrite (position + 4);
 			*((Tag *) (block->memory + position)) = value;
 			position += 4;
 		}
 
+		/// Write num UShort values at once using short-endian conversion
+		void writeUShortArray (const UShort *values, size_t num);
+
 		void writeString (const util::String & s);
 		void writeBlock (MemoryBlockPtr b);
 
@@ -263,19 +263,25 @@ SegmentMappingToDeltaTable::SegmentMappingToDeltaTable (OpenTypeFile & aFont, US
 	UShort segmentNum = pen.readUShort() / 2;
 
 	// Skip search ranges and such
-	MemoryPen endCodes = pen + 6;
-	MemoryPen startCodes = endCodes + 2 + 2 * segmentNum;
-	MemoryPen deltas = startCodes + 2 * segmentNum;
-	MemoryPen rangeOffsets = deltas + 2 * segmentNum;
-	
+	pen += 6;
+	// endCode, reservedPad, startCode, idDelta, idRangeOffset
+	std::vector <UShort> segments (4 * segmentNum + 1);
+	pen.readUShortArray (&segments.front(), segments.size());
+	const UShort * endCodes = &segments.front();
+	const UShort * startCodes = endCodes + segmentNum + 1;
+	const UShort * deltas = startCodes + segmentNum;
+	const UShort * rangeOffsets = deltas + segmentNum;
+	MemoryPen rangeOffsetsPen = pen - 2 * segmentNum;
+
+	std::vector <UShort> glyphIds;
 	UShort i;
 	for (i = 0; i < segmentNum; i ++) {
 		ULong endCode, startCode, rangeOffset;
 		Short delta;
-		endCode = endCodes.readUShort();
-		startCode = startCodes.readUShort();
-		delta = deltas.readShort();
-		rangeOffset = rangeOffsets.readUShort();
+		endCode = endCodes [i];
+		startCode = startCodes [i];
+		delta = (Short) deltas [i];
+		rangeOffset = rangeOffsets [i];
 		if (!rangeOffset) {
 			// valid delta value
 			ULong code;
@@ -285,11 +291,15 @@ SegmentMappingToDeltaTable::SegmentMappingToDeltaTable (OpenTypeFile & aFont, US
 			}
 		} else {
 			// This is called an "obscure indexing trick" in the specs
-			MemoryPen glyphIds = rangeOffsets + rangeOffset - 2;
-			ULong code;
-			for (code = startCode; code <= endCode; code ++) {
-				Mapping m = {code, glyphIds.readUShort()};
-				mappings.push_back (m);
+			if (startCode <= endCode) {
+				MemoryPen glyphIdsPen = rangeOffsetsPen + 2 * i + rangeOffset;
+				glyphIds.resize (endCode - startCode + 1);
+				glyphIdsPen.readUShortArray (&glyphIds.front(), glyphIds.size());
+				ULong code;
+				for (code = startCode; code <= endCode; code ++) {
+					Mapping m = {code, glyphIds [code - startCode]};
+					mappings.push_back (m);
+				}
 			}
 			if (endCode == 0xFFFF)
 				font.addWarning(new Exception ("Incorrect number of segments"));
@@ -579,11 +589,23 @@ SegmentMappingTable::SegmentMappingTable (OpenTypeFile & aFont, UShort aPlatform
 
 	ULong startCode, endCode, startGlyphId, lastEndCode;
 
+	// startCharCode, endCharCode and startGlyphID of a number of groups
+	const ULong groupBufferSize = 256;
+	ULong groups [3 * groupBufferSize];
+	const ULong * group = groups;
+
 	ULong i;
-	for (i = 0; i < groupNum; i ++) {
-		startCode = pen.readULong();
-		endCode = pen.readULong();
-		startGlyphId = pen.readULong();
+	for (i = 0; i < groupNum; i ++, group += 3) {
+		if (i % groupBufferSize == 0) {
+			ULong readNum = groupNum - i;
+			if (readNum > groupBufferSize)
+				readNum = groupBufferSize;
+			pen.readULongArray (groups, 3 * readNum);
+			group = groups;
+		}
+		startCode = group [0];
+		endCode = group [1];
+		startGlyphId = group [2];
 
 		if (i) {
 			if (startCode <= lastEndCode)
@@ -30,6 +30,9 @@
 #include "OTTags.h"
 #include "OTlocaTable.h"
 
+#include "../Util/parallel.h"
+
+using std::vector;
 using util::String;
 
 namespace OpenType {
@@ -119,17 +122,59 @@ UShort headTable::getUnitsPerEm() {
 	return unitsPerEm;
 }
 
-void headTable::reset (const Glyphs &glyphs, const locaTable & loca) {
-	Glyphs::const_iterator g;
+namespace {
+	// Glyphs are combined in blocks of this size, each into its own copy of
+	// the table, so that the blocks can be done by different threads.
+	const size_t glyphBlockSize = 256;
+}
+
+class headTable::BoundingBoxTask : public util::parallel_task {
+	const Glyphs &glyphs;
+	vector <headTable> &blocks;
+	vector <char> &blocksEmpty;
+public:
+	BoundingBoxTask (const Glyphs &aGlyphs, vector <headTable> &aBlocks,
+		vector <char> &aBlocksEmpty)
+		: glyphs (aGlyphs), blocks (aBlocks), blocksEmpty (aBlocksEmpty) {}
+
+	void run (size_t begin, size_t end) {
+		for (size_t block = begin; block != end; block ++) {
+			size_t glyphEnd = std::min (glyphs.size(), (block + 1) * glyphBlockSize);
+			for (size_t g = block * glyphBlockSize; g != glyphEnd; g ++) {
+				if (!glyphs [g]->isEmpty()) {
+					blocksEmpty [block] = false;
+					glyphs [g]->getBoundingBox (&blocks [block]);
+				}
+			}
+		}
+	}
+};
 
+void headTable::reset (const Glyphs &glyphs, const locaTable & loca) {
 	xMin = yMin = 0x7FFF;
 	xMax = yMax = -0x8000;
 
+	size_t blockNum = (glyphs.size() + glyphBlockSize - 1) / glyphBlockSize;
+	vector <headTable> blocks (blockNum, *this);
+	vector <char> blocksEmpty (blockNum, true);
+	BoundingBoxTask task (glyphs, blocks, blocksEmpty);
+	if (!util::parallel_for (task, blockNum))
+		// Do the work again in this thread to get the exception
+		task.run (0, blockNum);
+
 	bool allEmpty = true;
-	for (g = glyphs.begin(); g != glyphs.end(); g ++) {
-		if (!(*g)->isEmpty()) {
+	for (size_t block = 0; block != blockNum; block ++) {
+		if (!blocksEmpty [block]) {
 			allEmpty = false;
-			(*g)->getBoundingBox (this);
+			const headTable &b = blocks [block];
+			if (b.xMin < xMin)
+				xMin = b.xMin;
+			if (b.yMin < yMin)
+				yMin = b.yMin;
+			if (b.xMax > xMax)
+				xMax = b.xMax;
+			if (b.yMax > yMax)
+				yMax = b.yMax;
 		}
 	}
 	if (allEmpty)
@@ -75,6 +75,7 @@ namespace OpenType {
 		friend class OpenTypeFont;
 		UShort getUnitsPerEm();
 		void reset (const std::vector <util::smart_ptr <Glyph> > &glyphs, const locaTable & loca);
+		class BoundingBoxTask;
 
 		friend class Glyph;
 		void setBoundingBox (const Glyph::BoundingBox & boundingBox);
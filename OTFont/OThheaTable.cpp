@@ -29,6 +29,9 @@
 #include "OTGlyph.h"
 #include "OTTags.h"
 
+#include "../Util/parallel.h"
+
+using std::vector;
 using util::String;
 
 namespace OpenType {
@@ -107,18 +110,54 @@ void hheaTable::setHMetricsNum (UShort aHMetricsNum) {
 	hMetricsNum = aHMetricsNum;
 }
 
+namespace {
+	// Glyphs are combined in blocks of this size, each into its own copy of
+	// the table, so that the blocks can be done by different threads.
+	const size_t glyphBlockSize = 256;
+}
+
+class hheaTable::HorizontalMaximaTask : public util::parallel_task {
+	const Glyphs &glyphs;
+	vector <hheaTable> &blocks;
+	vector <char> &blocksEmpty;
+public:
+	HorizontalMaximaTask (const Glyphs &aGlyphs, vector <hheaTable> &aBlocks,
+		vector <char> &aBlocksEmpty)
+		: glyphs (aGlyphs), blocks (aBlocks), blocksEmpty (aBlocksEmpty) {}
+
+	void run (size_t begin, size_t end) {
+		for (size_t block = begin; block != end; block ++) {
+			size_t glyphEnd = std::min (glyphs.size(), (block + 1) * glyphBlockSize);
+			for (size_t g = block * glyphBlockSize; g != glyphEnd; g ++) {
+				if (!glyphs [g]->isEmpty())
+					blocksEmpty [block] = false;
+				glyphs [g]->getHorizontalMaxima (&blocks [block]);
+			}
+		}
+	}
+};
+
 void hheaTable::reset (const Glyphs &glyphs) {
 	advanceWidthMax = 0;
 	minLeftSideBearing = 0x7FFF;
 	minRightSideBearing = 0x7FFF;
 	xMaxExtent = -0x8000;
 
+	size_t blockNum = (glyphs.size() + glyphBlockSize - 1) / glyphBlockSize;
+	vector <hheaTable> blocks (blockNum, *this);
+	vector <char> blocksEmpty (blockNum, true);
+	HorizontalMaximaTask task (glyphs, blocks, blocksEmpty);
+	if (!util::parallel_for (task, blockNum))
+		// Do the work again in this thread to get the exception
+		task.run (0, blockNum);
+
 	bool allEmpty = true;
-	Glyphs::const_iterator g;
-	for (g = glyphs.begin(); g != glyphs.end(); g ++) {
-		if (!(*g)->isEmpty())
+	for (size_t block = 0; block != blockNum; block ++) {
+		if (!blocksEmpty [block])
 			allEmpty = false;
-		(*g)->getHorizontalMaxima (this);
+		const hheaTable &b = blocks [block];
+		setHorizontalMaxima (b.advanceWidthMax, b.minLeftSideBearing,
+			b.minRightSideBearing, b.xMaxExtent);
 	}
 	if (allEmpty)
 		minLeftSideBearing =
@@ -65,6 +65,7 @@ namespace OpenType {
 
 		friend class OpenTypeFont;
 		void reset (const std::vector <util::smart_ptr <Glyph> > &glyphs);
+		class HorizontalMaximaTask;
 
 		friend class Glyph;
 		void setHorizontalMaxima (UFWord aAdvanceWidthMax, FWord aMinLeftSideBearing,
@@ -58,21 +58,23 @@ hmtxTable::hmtxTable (OpenTypeFile &aFont, smart_ptr <maxpTable> maxpTable,
 	if (fullMetricsNum > glyphNum)
 		throw Exception ("More horizontal metrics than glyphs");
 
-	horMetrics.reserve (glyphNum);
-	UShort lastAdvance;
+	// Full metrics are pairs of advance width and lsb; the rest are lsbs
+	std::vector <UShort> values (fullMetricsNum + glyphNum);
+	pen.readUShortArray (&values.front(), 2 * fullMetricsNum);
+	pen.readUShortArray (&values.front() + 2 * fullMetricsNum,
+		glyphNum - fullMetricsNum);
+
+	horMetrics.resize (glyphNum);
 	UShort i;
 	for (i = 0; i < fullMetricsNum; i ++) {
-		HorMetric hm;
-		lastAdvance = hm.advanceWidth = pen.readUShort();
-		hm.lsb = pen.readShort();
-		horMetrics.push_back (hm);
+		horMetrics [i].advanceWidth = values [2*i];
+		horMetrics [i].lsb = (Short) values [2*i + 1];
 	}
 
+	UShort lastAdvance = values [2*(fullMetricsNum - 1)];
 	for (; i < glyphNum; i ++) {
-		HorMetric hm;
-		hm.advanceWidth = lastAdvance;
-		hm.lsb = pen.readShort();
-		horMetrics.push_back (hm);
+		horMetrics [i].advanceWidth = lastAdvance;
+		horMetrics [i].lsb = (Short) values [fullMetricsNum + i];
 	}
 
 	if (!pen.endOfBlock())
@@ -100,13 +102,17 @@ MemoryBlockPtr hmtxTable::getMemory() const {
 	HorMetrics::const_iterator i;
 	HorMetrics::const_iterator lastFullMetric = getLastFullMetric();
 
+	std::vector <UShort> values;
+	values.reserve (horMetrics.size() + (lastFullMetric - horMetrics.begin()) + 1);
 	for (i = horMetrics.begin(); i <= lastFullMetric; i ++) {
-		pen.writeUShort (i->advanceWidth);
-		pen.writeShort (i->lsb);
+		values.push_back (i->advanceWidth);
+		values.push_back ((UShort) i->lsb);
 	}
 
 	for (; i != horMetrics.end(); i++)
-		pen.writeShort (i->lsb);
+		values.push_back ((UShort) i->lsb);
+
+	pen.writeUShortArray (&values.front(), values.size());
 
 	return memory;
 }
@@ -38,16 +38,16 @@ locaTable::locaTable (OpenTypeFile &aFont, smart_ptr <maxpTable> maxpTable,
 	UShort glyphNum = maxpTable->getGlyphNum();
 	format = headTable->getIndexToLocFormat();
 
-	locations.reserve (glyphNum);
+	ULong locationNum = ULong (glyphNum) + 1;
+	locations.resize (locationNum);
 
-	UShort i;
 	if (format == 0) {
-		for (i = 0; i <= glyphNum; i++)
-			locations.push_back (pen.readUShort() * 2);
-	} else {
-		for (i = 0; i <= glyphNum; i++)
-			locations.push_back (pen.readULong());
-	}
+		std::vector <UShort> halfLocations (locationNum);
+		pen.readUShortArray (&halfLocations.front(), locationNum);
+		for (ULong i = 0; i < locationNum; i++)
+			locations [i] = halfLocations [i] * 2;
+	} else
+		pen.readULongArray (&locations.front(), locationNum);
 }
 
 locaTable::~locaTable() {}
@@ -64,8 +64,11 @@ MemoryBlockPtr locaTable::getMemory() const {
 	Locations::const_iterator i;
 
 	if (format == 0) {
+		std::vector <UShort> halfLocations;
+		halfLocations.reserve (locations.size());
 		for (i = locations.begin(); i != locations.end(); i++)
-			pen.writeUShort (*i /2);
+			halfLocations.push_back (*i /2);
+		pen.writeUShortArray (&halfLocations.front(), halfLocations.size());
 	} else {
 		for (i = locations.begin(); i != locations.end(); i++)
 			pen.writeULong (*i);
@@ -83,7 +86,8 @@ void locaTable::addLocation (ULong location) {
 	assert (location % 2 == 0);
 
 	locations.push_back (location);
-	if (location > 0xFFFF)
+	// The short format contains location / 2
+	if (location > 0x1FFFE)
 		format = 1;
 }
 
@@ -29,6 +29,9 @@
 #include "OTGlyph.h"
 #include "OTTags.h"
 
+#include "../Util/parallel.h"
+
+using std::vector;
 using util::String;
 
 namespace OpenType {
@@ -135,6 +138,28 @@ void maxpTable::setMaxTwilightPoints (UShort aMaxTwilightPoints) {
 	maxTwilightPoints = aMaxTwilightPoints;
 }
 
+namespace {
+	// Glyphs are combined in blocks of this size, each into its own copy of
+	// the table, so that the blocks can be done by different threads.
+	const size_t glyphBlockSize = 256;
+}
+
+class maxpTable::MaximumProfileTask : public util::parallel_task {
+	const Glyphs &glyphs;
+	vector <maxpTable> &blocks;
+public:
+	MaximumProfileTask (const Glyphs &aGlyphs, vector <maxpTable> &aBlocks)
+		: glyphs (aGlyphs), blocks (aBlocks) {}
+
+	void run (size_t begin, size_t end) {
+		for (size_t block = begin; block != end; block ++) {
+			size_t glyphEnd = std::min (glyphs.size(), (block + 1) * glyphBlockSize);
+			for (size_t g = block * glyphBlockSize; g != glyphEnd; g ++)
+				glyphs [g]->getMaximumProfile (&blocks [block]);
+		}
+	}
+};
+
 void maxpTable::reset (const Glyphs &glyphs) {
 	glyphNum = glyphs.size();
 
@@ -146,9 +171,18 @@ void maxpTable::reset (const Glyphs &glyphs) {
 	maxComponentElements = 0;
 	maxComponentDepth = 0;
 
-	Glyphs::const_iterator g;
-	for (g = glyphs.begin(); g != glyphs.end(); g ++)
-		(*g)->getMaximumProfile (this);
+	vector <maxpTable> blocks ((glyphs.size() + glyphBlockSize - 1) / glyphBlockSize, *this);
+	MaximumProfileTask task (glyphs, blocks);
+	if (!util::parallel_for (task, blocks.size()))
+		// Do the work again in this thread to get the exception
+		task.run (0, blocks.size());
+
+	vector <maxpTable>::const_iterator b;
+	for (b = blocks.begin(); b != blocks.end(); b ++)
+		setMaximumProfile (b->maxPoints, b->maxContours,
+			b->maxCompositePoints, b->maxCompositeContours,
+			b->maxSizeOfInstructions, b->maxComponentElements,
+			b->maxComponentDepth);
 }
 
 void maxpTable::setMaximumProfile (UShort aMaxPoints, UShort aMaxContours,
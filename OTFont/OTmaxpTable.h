@@ -91,6 +91,7 @@ namespace OpenType {
 		void setMaxTwilightPoints (UShort aMaxTwilightPoints);
 
 		void reset (const std::vector <util::smart_ptr <Glyph> > &glyphs);
+		class MaximumProfileTask;
 
 		friend class Glyph;
 		friend class SimpleGlyph;
@@ -68,6 +68,7 @@ namespace OpenType {
 	class Exception;
 	class Glyph;
 
+	class MemoryMap;
 	class MemoryBlock;
 	class MemoryPen;
 	class MemoryWritePen;
@@ -87,6 +88,7 @@ namespace OpenType {
 	class MappingTable;
 
 	typedef util::smart_ptr <Exception> ExceptionPtr;
+	typedef util::smart_ptr <MemoryMap> MemoryMapPtr;
 	typedef util::smart_ptr <MemoryBlock> MemoryBlockPtr;
 	typedef util::smart_ptr <Glyph> GlyphPtr;
 	typedef util::smart_ptr <MappingTable> MappingTablePtr;
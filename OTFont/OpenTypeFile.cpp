@@ -29,7 +29,6 @@
 #include <algorithm>
 
 using std::ios;
-using std::ifstream;
 using std::ofstream;
 
 using std::vector;
@@ -38,6 +37,7 @@ using std::upper_bound;
 
 #include "OTException.h"
 #include "OpenTypeFile.h"
+#include "OTMemoryBlock.h"
 #include "OTTable.h"
 #include "OTTags.h"
 
@@ -55,16 +55,84 @@ bool compareDirectoryEntriesByOffsets (const DirectoryEntry &e1, const Directory
 	return e1.offset < e2.offset;
 }
 
-bool compareTags (Tag tag1, Tag tag2) {
-	const char * t1 = (const char *) &tag1;
-	const char * t2 = (const char *) &tag2;
-	return strncmp ((const char *) & tag1, (const char *) & tag2, 4) < 0;
+/*** TableDirectory ***/
+
+TableDirectory::TableDirectory() : entries (32), tableNum (0) {}
+
+TableDirectory::Entries::size_type TableDirectory::getEntryIndex (Tag tag) const {
+	Entries::size_type mask = entries.size() - 1;
+	Entries::size_type index = getIdealIndex (tag);
+	while (entries [index].table && entries [index].tag != tag)
+		index = (index + 1) & mask;
+	return index;
 }
 
-bool compareTablesByTags (const TablePtr t1, const TablePtr t2) {
-	return compareTags (t1->getTag(), t2->getTag());
+void TableDirectory::grow() {
+	Entries oldEntries (entries.size() * 2);
+	oldEntries.swap (entries);
+	Entries::const_iterator e;
+	for (e = oldEntries.begin(); e != oldEntries.end(); e ++) {
+		if (e->table)
+			entries [getEntryIndex (e->tag)] = *e;
+	}
+}
+
+TablePtr TableDirectory::get (Tag tag) const {
+	return entries [getEntryIndex (tag)].table;
+}
+
+bool TableDirectory::set (TablePtr table) {
+	Tag tag = table->getTag();
+	Entry &entry = entries [getEntryIndex (tag)];
+	if (entry.table) {
+		entry.table = table;
+		return true;
+	}
+	entry.tag = tag;
+	entry.table = table;
+	tableNum ++;
+	if (tableNum * 2 > entries.size())
+		grow();
+	return false;
+}
+
+bool TableDirectory::remove (Tag tag) {
+	Entries::size_type mask = entries.size() - 1;
+	Entries::size_type index = getEntryIndex (tag);
+	if (!entries [index].table)
+		return false;
+	entries [index].table = NULL;
+	tableNum --;
+
+	// Move entries after it back if they belong at or before the hole, so
+	// that they can still be found.
+	Entries::size_type hole = index;
+	index = (index + 1) & mask;
+	while (entries [index].table) {
+		Entries::size_type ideal = getIdealIndex (entries [index].tag);
+		if (((index - ideal) & mask) >= ((index - hole) & mask)) {
+			entries [hole] = entries [index];
+			entries [index].table = NULL;
+			hole = index;
+		}
+		index = (index + 1) & mask;
+	}
+	return true;
+}
+
+Tables TableDirectory::getTables() const {
+	Tables result;
+	result.reserve (tableNum);
+	Entries::const_iterator e;
+	for (e = entries.begin(); e != entries.end(); e ++) {
+		if (e->table)
+			result.push_back (e->table);
+	}
+	return result;
 }
 
+/*** OpenTypeFile ***/
+
 OpenTypeFile::OpenTypeFile () {}
 
 OpenTypeFile::~OpenTypeFile() {}
@@ -74,12 +142,9 @@ void OpenTypeFile::readFromFile (String aFileName) {
 	Exception::FontContext c1 (*this);
 	Exception::Context c2 ("reading from file");
 
-	ifstream file (fileName.getCString(), ios::in | ios::binary);
-	if (!file.is_open())
-		throw Exception ("Could not open file");
+	fileMap = new MemoryMap (fileName);
 
-	MemoryBlockPtr offsetTable (new MemoryBlock (file, 12));
-	MemoryBlockPtr test (offsetTable);
+	MemoryBlockPtr offsetTable (new MemoryBlock (fileMap, 0, 12));
 
 	// Read offset table
 	MemoryPen pen (offsetTable);
@@ -95,7 +160,7 @@ void OpenTypeFile::readFromFile (String aFileName) {
 	DirectoryEntryVector entries;
 	entries.reserve (tableNum);
 
-	MemoryBlockPtr tableDirectory (new MemoryBlock (file, 16*tableNum));
+	MemoryBlockPtr tableDirectory (new MemoryBlock (fileMap, 12, 16*tableNum));
 	pen.set (tableDirectory);
 
 
@@ -128,113 +193,77 @@ void OpenTypeFile::readFromFile (String aFileName) {
 				tagToString (previousTag) + "' and '" + tagToString (e->tag) + "'"));
 
 		curOffset = e->offset;
-		file.seekg(e->offset);
-		MemoryBlockPtr memory (new MemoryBlock (file, e->length));
+		MemoryBlockPtr memory (new MemoryBlock (fileMap, e->offset, e->length));
 
 		addTable (new UnknownTable (*this, e->tag, memory));
 
 		curOffset += e->length;
 		previousTag = e->tag;
 	}
-
-	file.close();
 }
 
 String OpenTypeFile::getFileName() const {
 	return fileName;
 }
 
-Tables::iterator OpenTypeFile::getTableIterator (ULong tag) {
-	Tables::iterator lowest, highest, guess;
-	lowest = tables.begin();
-	highest = tables.end();
-	while (lowest != highest) {
-		guess = lowest  + (highest - lowest) / 2;
-		ULong foundTag = (*guess)->getTag();
-		if (tag == foundTag)
-			return guess;
-		if (compareTags (tag, foundTag))
-			highest = guess;
-		else
-			lowest = guess + 1;
-	}
-	
-	return tables.end();
-}
-
 /*	TablePtr getTable (ULong tag, bool fail);
 	bool addTable (TablePtr newTable, bool fail);
 	bool deleteTable (ULong tag, bool fail);
 	bool replaceTable (TablePtr newTable, bool fail);*/
 
 TablePtr OpenTypeFile::getTable (ULong tag, bool fail) {
-	Exception::FontContext c (*this);
-
-	Tables::iterator pos = getTableIterator (tag);
-	if (pos == tables.end() || (*pos)->getTag() != tag) {
-		if (fail)
-			throw Exception ("No '" + tagToString (tag) +
-				"' table was found");
-		else
-			return NULL;
-	} else
-		return *pos;
+	TablePtr table = tables.get (tag);
+	if (!table && fail) {
+		Exception::FontContext c (*this);
+		throw Exception ("No '" + tagToString (tag) +
+			"' table was found");
+	}
+	return table;
 }
 
 bool OpenTypeFile::addTable (TablePtr newTable, bool fail) {
-	Exception::FontContext c (*this);
-
-	Tables::iterator pos = lower_bound (tables.begin(), tables.end(),
-		newTable, compareTablesByTags);
-
-	if (pos != tables.end() && (*pos)->getTag() == newTable->getTag()) {
+	if (tables.get (newTable->getTag())) {
 		// Table already exists
-		if (fail)
+		if (fail) {
+			Exception::FontContext c (*this);
 			throw Exception ("There is already a '" + tagToString(newTable->getTag()) +
 				"' table");
-		else
+		} else
 			return false;
 	} else {
-		tables.insert (pos, newTable);
+		tables.set (newTable);
 		return true;
 	}
 }
 
 
 bool OpenTypeFile::deleteTable (ULong tag, bool fail) {
-	Exception::FontContext c (*this);
-	Tables::iterator pos = getTableIterator (tag);
-
-	if (pos == tables.end() || (*pos)->getTag() != tag) {
+	if (!tables.remove (tag)) {
 		// Table does not exist
-		if (fail)
+		if (fail) {
+			Exception::FontContext c (*this);
 			throw Exception ("No '" + tagToString (tag) +
 				"' table was found");
-		else
+		} else
 			return false;
-	} else {
-		tables.erase (pos);
+	} else
 		return true;
-	}
 }
 
 bool OpenTypeFile::replaceTable (TablePtr newTable, bool fail) {
-	Exception::FontContext c (*this);
-	Tables::iterator pos = getTableIterator (newTable->getTag());
-
-	if (pos == tables.end() || (*pos)->getTag() != newTable->getTag()) {
+	if (!tables.get (newTable->getTag())) {
 		// Table does not exist yet
-		if (fail)
+		if (fail) {
+			Exception::FontContext c (*this);
 			throw Exception ("No '" + tagToString (newTable->getTag()) +
 				"' table was found");
-		else {
+		} else {
 			// Add table anyway
-			tables.insert (lower_bound (tables.begin(), tables.end(), newTable, compareTablesByTags),
-				newTable);
+			tables.set (newTable);
 			return false;
 		}
 	} else {
-		*pos = newTable;
+		tables.set (newTable);
 		return true;
 	}
 }
@@ -256,24 +285,18 @@ bool OpenTypeFile::replaceTable (TablePtr newTable, bool fail) {
 	CFF fonts are not (yet) supported. We keep to the Windows Ideal Order.
 ***/
 
-class TableBlock {
-public:
+/// The directory entry of a table that has been written.
+struct WrittenTable {
 	Tag tag;
-	MemoryBlockPtr memory;
-	MemoryWritePen dirEntryPen;
 	ULong checksum;
-
-	TableBlock(Tag aTag, MemoryBlockPtr aMemory, MemoryWritePen aPen)
-		: tag (aTag), memory (aMemory), checksum(aMemory->getChecksum()), dirEntryPen (aPen) {}
-	TableBlock & operator= (const TableBlock &s) {
-		tag = s.tag;
-		memory = s.memory;
-		checksum = s.checksum;
-		dirEntryPen = s.dirEntryPen;
-		return *this;
-	}
+	ULong offset;
+	ULong length;
 };
 
+bool compareWrittenTablesByTags (const WrittenTable &t1, const WrittenTable &t2) {
+	return compareTags (t1.tag, t2.tag);
+}
+
 int getOrderedTagNumber (Tag tag) {
 	switch (tag) {
 	case headTag: return 0;
@@ -300,27 +323,78 @@ int getOrderedTagNumber (Tag tag) {
 	}
 }
 	
-bool compareTableBlocksByIdealPosition (const TableBlock &b1, const TableBlock &b2) {
-	int b1t = getOrderedTagNumber (b1.tag);
-	int b2t = getOrderedTagNumber (b2.tag);
-	if (b1t < b2t)
+bool compareTablesByIdealPosition (const TablePtr t1, const TablePtr t2) {
+	int t1n = getOrderedTagNumber (t1->getTag());
+	int t2n = getOrderedTagNumber (t2->getTag());
+	if (t1n < t2n)
 		return true;
-	if (b1t > b2t)
+	if (t1n > t2n)
 		return false;
-	return compareTags (b1.tag, b2.tag);
+	return compareTags (t1->getTag(), t2->getTag());
 }
 
+/**
+	The tables are streamed to the file one by one, so that only one table's
+	data needs to be in memory at any time. Space for the offset table and
+	the table directory is reserved first; these are written when all tables
+	have been written and their offsets and checksums are known. Finally,
+	checkSumAdjustment is patched into the 'head' table.
+*/
+
 void OpenTypeFile::writeToFile (String outFileName) {
 	Exception::FontContext c1 (*this);
-	Exception::Context c2 ("writing tables to file \"" + outFileName + '"');
+	Exception::Context c2 ("writing tables to file \"%1\"", outFileName);
+
+	// Tables may still refer to the file that is about to be overwritten
+	if (fileMap && fileMap->isFile (outFileName))
+		fileMap->detach();
+
 	ofstream file (outFileName.getCString(), ios::out | ios::binary);
 
 	if (!file.is_open())
 		throw Exception ("Could not open file");
 
-	MemoryBlockPtr offsetTable (new MemoryBlock (12));
-	MemoryWritePen pen (offsetTable);
+	ULong directorySize = 12 + 16 * tables.size();
+	MemoryBlockPtr offsetTable (new MemoryBlock (directorySize));
+	// Reserve space for the offset table and the directory
+	offsetTable->write (file, 4);
+
+	// Write the tables in the ideal order
+	Tables orderedTables = tables.getTables();
+	std::stable_sort (orderedTables.begin(), orderedTables.end(),
+		compareTablesByIdealPosition);
+
+	typedef vector <WrittenTable> WrittenTables;
+	WrittenTables writtenTables;
+	writtenTables.reserve (tables.size());
+
+	ULong totalChecksum = 0;
+	ULong headOffset = 0;
+	ULong curOffset = directorySize;
+	Tables::iterator i;
+	for (i = orderedTables.begin(); i != orderedTables.end(); i ++) {
+		MemoryBlockPtr memory = (*i)->getMemory();
+		WrittenTable entry;
+		entry.tag = (*i)->getTag();
+		entry.checksum = memory->getChecksum();
+		entry.offset = curOffset;
+		entry.length = memory->getSize();
+		if (entry.tag == headTag) {
+			// The checksum of 'head' is taken with checkSumAdjustment
+			// set to 0.
+			entry.checksum -= (MemoryPen (memory) + 8).readULong();
+			headOffset = curOffset;
+		}
+
+		memory->write (file, 4);
+
+		totalChecksum += entry.checksum;
+		curOffset += memory->getSize (4);
+		writtenTables.push_back (entry);
+	}
 
+	// Offset table
+	MemoryWritePen pen (offsetTable);
 	// version
 	pen.writeFixed (0x00010000);
 	pen.writeUShort (tables.size());
@@ -338,56 +412,32 @@ void OpenTypeFile::writeToFile (String outFileName) {
 	pen.writeUShort (entrySelector);
 	pen.writeUShort ((tables.size() - maxPower2) * 16);
 
-	// Get table blocks and order them
-	ULong totalChecksum = 0;
-	MemoryBlockPtr headMemory;
-
-	typedef vector <TableBlock> TableBlockVector;
-	TableBlockVector tableBlocks;
-	Tables::iterator i;
-	for (i = tables.begin(); i != tables.end(); i ++) {
-		TableBlock block (
-			(*i)->getTag(),
-			(*i)->getMemory(),
-			pen);
-
-		totalChecksum += block.checksum;
-		pen += 16;
-		tableBlocks.insert (upper_bound (tableBlocks.begin(), tableBlocks.end(),
-			block, compareTableBlocksByIdealPosition), block);
+	// Directory entries, in alphabetical order
+	std::sort (writtenTables.begin(), writtenTables.end(),
+		compareWrittenTablesByTags);
+	WrittenTables::iterator t;
+	for (t = writtenTables.begin(); t != writtenTables.end(); t ++) {
+		pen.writeTag (t->tag);
+		pen.writeULong (t->checksum);
+		pen.writeULong (t->offset);
+		pen.writeULong (t->length);
 	}
 
-	ULong curOffset = 12 + 16 * tables.size();
-	// Write directory entries
-	TableBlockVector::iterator b;
-	for (b = tableBlocks.begin(); b != tableBlocks.end(); b++ ) {
-
-		(*b).dirEntryPen.writeTag ((*b).tag);
-		if ((*b).tag == headTag)
-			headMemory = (*b).memory;
-		(*b).dirEntryPen.writeULong ((*b).checksum);
-		(*b).dirEntryPen.writeULong (curOffset);
-
-		(*b).dirEntryPen.writeULong ((*b).memory->getSize(1));
-
-		curOffset += (*b).memory->getSize(4);
-	}
+	file.seekp (0);
+	offsetTable->write (file, 4);
 
-	if (headMemory) {
+	if (headOffset) {
 		// Add font checksum to 'head' table
 		totalChecksum += offsetTable->getChecksum();
-		pen = MemoryWritePen (headMemory) + 8;
-		pen.writeULong (0xB1B0AFBA - totalChecksum);
+		MemoryBlockPtr adjustment (new MemoryBlock (4));
+		MemoryWritePen (adjustment).writeULong (0xB1B0AFBA - totalChecksum);
+		file.seekp (headOffset + 8);
+		adjustment->write (file, 4);
 	}
 
-	offsetTable->write (file, 4);
-
-	// Write the blocks to file
-
-	for (b = tableBlocks.begin(); b != tableBlocks.end(); b++)
-		(*b).memory->write (file, 4);
-
 	file.close();
+	if (file.fail())
+		throw Exception ("Could not write file");
 }
 
 /*bool OpenTypeFile::areWarnings() const {
@@ -47,6 +47,52 @@ namespace OpenType {
 
 	typedef std::vector <TablePtr> Tables;
 
+	/**
+		\brief Index of the tables in a file by their tags.
+
+		This is a hash table with open addressing and linear probing, with
+		the tags used as integers, so that looking up a table is quick and
+		does not allocate memory.
+	*/
+	class TableDirectory {
+		struct Entry {
+			Tag tag;
+			// NULL for an empty slot
+			TablePtr table;
+		};
+		typedef std::vector <Entry> Entries;
+		// The number of entries is a power of two and at least twice the
+		// number of tables.
+		Entries entries;
+		Tables::size_type tableNum;
+
+		/// Return the index of the entry with tag, or of the empty entry
+		/// where it would be put.
+		Entries::size_type getEntryIndex (Tag tag) const;
+		/// Return the index where tag would be if there were no collisions.
+		Entries::size_type getIdealIndex (Tag tag) const {
+			// Fibonacci hashing; the middle bits are the best mixed
+			return ((tag * 0x9E3779B1UL) >> 16) & (entries.size() - 1);
+		}
+		void grow();
+
+	public:
+		TableDirectory();
+
+		/// Return the table with tag, or NULL if there is none.
+		TablePtr get (Tag tag) const;
+		/// Set the table for its tag. Return false if there was none yet.
+		bool set (TablePtr table);
+		/// Remove the table with tag. Return false if there was none.
+		bool remove (Tag tag);
+
+		Tables::size_type size() const {
+			return tableNum;
+		}
+		/// Return all tables, in no particular order.
+		Tables getTables() const;
+	};
+
 	/**
 		\brief Contains logic to work with OpenType (sfnt) files.
 
@@ -56,16 +102,17 @@ namespace OpenType {
 	*/
 
 	class OpenTypeFile {
-		Tables tables;
+		TableDirectory tables;
+		/// The file the tables were read from, if any; they may refer to it.
+		MemoryMapPtr fileMap;
 
 		std::deque <ExceptionPtr> warnings;
-		Tables::iterator getTableIterator (ULong tag);
 
 	protected:
 		friend class Exception;
 		util::String fileName;
 
-		/// Return a pointer to the table, tables.end() if not found.
+		/// Return a pointer to the table, NULL if not found.
 		TablePtr getTable (ULong tag, bool fail = true);
 		/// Add a table to the file; returns false or throws if one exists already.
 		bool addTable (TablePtr newTable, bool fail = true);
@@ -83,7 +130,8 @@ namespace OpenType {
 		///
 		/// Reads the tables; does not try to read the information from them,
 		/// however. Derivatives may do this as needed.
-		/// The tables are kept in memory.
+		/// The file is mapped into memory and the tables refer to their data
+		/// in it; a table's data is copied only when it is changed.
 		void readFromFile (util::String aFileName);
 
 		/// Return the current file name.
@@ -106,8 +154,17 @@ namespace OpenType {
 
 	util::String tagToString (Tag tag);
 
+	/// Return tag as a big-endian integer, so that tags can be compared
+	/// as integers.
+	inline ULong getTagOrder (Tag tag) {
+		return ((tag & 0xFF) << 24) | ((tag & 0xFF00) << 8) |
+			((tag & 0xFF0000) >> 8) | ((tag & 0xFF000000) >> 24);
+	}
+
 	/// \brief Compare two tags alphabetically and return true if t1<t2.
-	bool compareTags (Tag t1, Tag t2);
+	inline bool compareTags (Tag t1, Tag t2) {
+		return getTagOrder (t1) < getTagOrder (t2);
+	}
 }
 
 #endif	// OPENTYPEFILE_H
@@ -49,12 +49,15 @@ using util::shared_vector;
 #include "OTLayoutTable.h"
 #include "OTTags.h"
 
+#include "../Util/parallel.h"
+
 using util::String;
 using util::smart_ptr;
 
 namespace OpenType {
 
-OpenTypeFont::OpenTypeFont() : glyphsExtracted (false), namesExtracted (false) {}
+OpenTypeFont::OpenTypeFont()
+: glyphsExtracted (false), namesExtracted (false), frozen (false) {}
 
 OpenTypeFont::~OpenTypeFont() {}
 
@@ -208,49 +211,68 @@ smart_ptr <GDEFTable> OpenTypeFont::getGDEFTable (bool fail) {
 	return GDEF;
 }
 
-void OpenTypeFont::extractGlyphs() {
+void OpenTypeFont::prepareGlyphs() {
 	Exception::FontContext c1 (*this);
 	Exception::Context c2 ("extracting glyph data");
 
-	assert (!glyphsExtracted);
+	assert (!glyphsExtracted && !glyfMemory);
 	getlocaTable();
 	getpostTable();
 	gethmtxTable();
 
-	MemoryBlockPtr glyfMem = getTable (glyfTag, true)->getMemory();
-	MemoryPen glyfStart (glyfMem);
-
-	Locations & locations = loca->getLocations();
-	Locations::iterator i;
-	UShort glyphIndex = 0;
-	glyphs.reserve (locations.size());
-	for (i = locations.begin(); i != locations.end()-1; i ++, glyphIndex ++) {
-		String name = post->getPostName (glyphIndex);
-		HorMetric hm = hmtx->getHorMetric (glyphIndex);
-		if (*i == *(i+1)) {
-			// Empty glyph
-			glyphs.push_back (new Glyph (*this, name, hm));
-		} else {
-			MemoryPen pen = glyfStart + *i;
-			Short contourNum = pen.readUShort();
-			if (contourNum <= 0) {
-				if (contourNum != -1)
-					throw Exception ("Invalid number of contours in glyph " +
-						String (glyphIndex) + ": " + String(contourNum));
-				glyphs.push_back (new CompositeGlyph (*this, name, hm, pen));
-			} else
-				glyphs.push_back (new SimpleGlyph (*this, name, hm, contourNum, pen));
-
-			// Data validity & sanity check
-			if (pen.getPosition() > *(i+1))
-				throw Exception ("Overlapping glyph data in glyph " +
-					String (glyphIndex));
-			if (OT_PAD_TO (pen.getPosition(), 4) < *(i+1))
-				addWarning (new Exception("Gap between glyph data positions in glyph " + 
-					String (glyphIndex)));
-		}
+	glyfMemory = getTable (glyfTag, true)->getMemory();
+	glyphs.resize (loca->getLocations().size() - 1);
+}
+
+GlyphPtr OpenTypeFont::extractGlyph (UShort glyphIndex) {
+	Exception::FontContext c1 (*this);
+	Exception::Context c2 ("extracting glyph data");
+
+	assert (glyfMemory);
+	Locations::const_iterator i = loca->getLocations().begin() + glyphIndex;
+	String name = post->getPostName (glyphIndex);
+	HorMetric hm = hmtx->getHorMetric (glyphIndex);
+	if (*i == *(i+1)) {
+		// Empty glyph
+		return new Glyph (*this, name, hm);
+	} else {
+		GlyphPtr glyph;
+		MemoryPen pen = MemoryPen (glyfMemory) + *i;
+		Short contourNum = pen.readUShort();
+		if (contourNum <= 0) {
+			if (contourNum != -1)
+				throw Exception ("Invalid number of contours in glyph " +
+					String (glyphIndex) + ": " + String(contourNum));
+			glyph = new CompositeGlyph (*this, name, hm, pen);
+		} else
+			glyph = new SimpleGlyph (*this, name, hm, contourNum, pen);
+
+		// Data validity & sanity check
+		if (pen.getPosition() > *(i+1))
+			throw Exception ("Overlapping glyph data in glyph " +
+				String (glyphIndex));
+		if (OT_PAD_TO (pen.getPosition(), 4) < *(i+1))
+			addWarning (new Exception("Gap between glyph data positions in glyph " + 
+				String (glyphIndex)));
+		return glyph;
+	}
+}
+
+void OpenTypeFont::extractGlyphs() {
+	Exception::FontContext c1 (*this);
+	Exception::Context c2 ("extracting glyph data");
+
+	assert (!glyphsExtracted);
+	if (!glyfMemory)
+		prepareGlyphs();
+
+	Glyphs::iterator g;
+	for (g = glyphs.begin(); g != glyphs.end(); g ++) {
+		if (!*g)
+			*g = extractGlyph (g - glyphs.begin());
 	}
 	glyphsExtracted = true;
+	glyfMemory = NULL;
 
 	// Delete 'loca' table
 	deleteTable (locaTag);
@@ -269,22 +291,78 @@ void OpenTypeFont::extractNames() {
 	Exception::Context c2 ("extracting glyph names");
 
 	if (!namesExtracted) {
-		if (!glyphsExtracted)
-			extractGlyphs();
+		// The names of glyphs that have not been extracted yet are in 'post'
+		if (!glyphsExtracted && !glyfMemory)
+			prepareGlyphs();
 
 		Glyphs::const_iterator g;
-		for (g = glyphs.begin(); g != glyphs.end(); g ++)
-			nameIndices.insert (pair <String, UShort> ((*g)->getName(), g - glyphs.begin()));
+		for (g = glyphs.begin(); g != glyphs.end(); g ++) {
+			UShort index = g - glyphs.begin();
+			nameIndices.insert (pair <String, UShort> (
+				*g ? (*g)->getName() : post->getPostName (index), index));
+		}
 
 		namesExtracted = true;
 	}
 }
 
+namespace {
+	// Glyphs are handed to threads in chunks of this size
+	const size_t glyphChunkSize = 64;
+}
+
+/// Recalculate the bounding box and the padded size of glyphs.
+class OpenTypeFont::GlyphSizeTask : public util::parallel_task {
+	const Glyphs &glyphs;
+	vector <ULong> &sizes;
+public:
+	GlyphSizeTask (const Glyphs &aGlyphs, vector <ULong> &aSizes)
+		: glyphs (aGlyphs), sizes (aSizes) {}
+
+	void run (size_t begin, size_t end) {
+		for (size_t i = begin; i != end; i ++) {
+			glyphs [i]->recalculateBoundingBox();
+			sizes [i] = OT_PAD_TO (glyphs [i]->getByteSize(), 4);
+		}
+	}
+};
+
+/// Write glyphs to the 'glyf' table at the positions in the 'loca' table.
+/// Different glyphs go into separate parts of the table, so they may be
+/// written by different threads.
+class OpenTypeFont::GlyphWriteTask : public util::parallel_task {
+	const Glyphs &glyphs;
+	const Locations &locations;
+	const MemoryWritePen &glyfStart;
+public:
+	GlyphWriteTask (const Glyphs &aGlyphs, const Locations &aLocations,
+		const MemoryWritePen &aGlyfStart)
+		: glyphs (aGlyphs), locations (aLocations), glyfStart (aGlyfStart) {}
+
+	void run (size_t begin, size_t end) {
+		MemoryWritePen pen = glyfStart;
+		pen += locations [begin];
+		for (size_t i = begin; i != end; i ++) {
+			assert (ULong (pen - glyfStart) == locations [i]);
+			glyphs [i]->write (pen);
+			pen.padWithZeros (4);
+		}
+		assert (ULong (pen - glyfStart) == locations [end]);
+	}
+};
+
 void OpenTypeFont::writeToFile (String outFileName) {
+	checkNotFrozen();
+
+	// Glyphs that have been handed out may have been changed. If none have,
+	// the glyph data is written back unchanged.
+	if (!glyphsExtracted && glyfMemory)
+		extractGlyphs();
+
 	// Reproduce changed glyph data
 	if (glyphsExtracted) {
 		Exception::FontContext c1 (*this);
-		Exception::Context c2 ("preparing file data for \"" + outFileName + '"');
+		Exception::Context c2 ("preparing file data for \"%1\"", outFileName);
 		// Regenerate these tables, which had been discarded as read
 		assert (!loca);
 		assert (!hmtx);
@@ -293,28 +371,38 @@ void OpenTypeFont::writeToFile (String outFileName) {
 
 		loca = new locaTable (*this);
 
-		MemoryBlockPtr glyfMemory = new MemoryBlock;
-		TablePtr glyf =
-			new UnknownTable(*this, glyfTag, glyfMemory);
-		// Regenerate glyf table
-		MemoryWritePen glyfStart (glyfMemory);
-		MemoryWritePen pen = glyfStart;
-
-		Glyphs::iterator glyph;
-		for (glyph = glyphs.begin(); glyph != glyphs.end(); glyph ++) {
-			// Recalculate bounding box
-			(*glyph)->recalculateBoundingBox();
+		// Work out the glyph data sizes first, so that the 'glyf' table
+		// can be allocated at once, and every glyph's position is known
+		// before it is written. This allows the glyphs to be encoded in
+		// parallel.
+		// Padding: it says 4 in the  specs, but that seems strange, as
+		// there are no ULong values in there.
+		vector <ULong> glyphSizes (glyphs.size());
+		GlyphSizeTask sizeTask (glyphs, glyphSizes);
+		if (!util::parallel_for (sizeTask, glyphs.size(), glyphChunkSize))
+			// An exception was thrown in another thread. Do the work again
+			// in this thread so that it is thrown here, with its context.
+			sizeTask.run (0, glyphs.size());
+
+		ULong glyfSize = 0;
+		vector <ULong>::const_iterator glyphSize;
+		for (glyphSize = glyphSizes.begin(); glyphSize != glyphSizes.end(); glyphSize ++) {
 			// Set loca table entry
-			loca->addLocation (pen - glyfStart);
-			// Write glyph to glyf table
-			(*glyph)->write (pen);
-			// Padding: it says 4 in the  specs, but that seems strange, as
-			// there are no ULong values in there.
-			pen.padWithZeros (4);
+			loca->addLocation (glyfSize);
+			glyfSize += *glyphSize;
 		}
-
 		// Add sentinel entry
-		loca->addLocation (pen - glyfStart);
+		loca->addLocation (glyfSize);
+
+		// Regenerate glyf table
+		MemoryBlockPtr newGlyfMemory = new MemoryBlock (glyfSize);
+		TablePtr glyf =
+			new UnknownTable(*this, glyfTag, newGlyfMemory);
+		MemoryWritePen glyfStart (newGlyfMemory);
+
+		GlyphWriteTask writeTask (glyphs, loca->getLocations(), glyfStart);
+		if (!util::parallel_for (writeTask, glyphs.size(), glyphChunkSize))
+			writeTask.run (0, glyphs.size());
 
 		addTable (glyf);
 		addTable (loca);
@@ -336,6 +424,46 @@ void OpenTypeFont::writeToFile (String outFileName) {
 	OpenTypeFile::writeToFile (outFileName);
 }
 
+void OpenTypeFont::freeze() {
+	if (frozen)
+		return;
+	Exception::FontContext c1 (*this);
+	Exception::Context c2 ("freezing font");
+
+	getheadTable();
+	gethheaTable();
+	getmaxpTable();
+	getOS2Table (false);
+	getGSUBTable (false);
+	getGPOSTable (false);
+	getGDEFTable (false);
+
+	if (!glyphsExtracted)
+		extractGlyphs();
+	extractNames();
+	// Bounding boxes are otherwise recalculated when they are first needed
+	Glyphs::const_iterator g;
+	for (g = glyphs.begin(); g != glyphs.end(); g ++)
+		(*g)->recalculateBoundingBoxIfNecessary();
+
+	if (getcmapTable (false)) {
+		try {
+			extractUnicodeMapping();
+		} catch (Exception &) {
+			// getGlyphIndexByUnicode will throw this again when it is used.
+		}
+	}
+
+	frozen = true;
+}
+
+void OpenTypeFont::checkNotFrozen() {
+	if (frozen) {
+		Exception::FontContext c (*this);
+		throw Exception ("The font has been frozen and cannot be changed");
+	}
+}
+
 UShort OpenTypeFont::getGlyphNum() {
 	Exception::FontContext c (*this);
 	if (glyphsExtracted)
@@ -347,12 +475,15 @@ UShort OpenTypeFont::getGlyphNum() {
 GlyphPtr OpenTypeFont::getGlyph (UShort glyphIndex) {
 	Exception::FontContext c (*this);
 
-	if (!glyphsExtracted)
-		extractGlyphs();
+	if (!glyphsExtracted && !glyfMemory)
+		prepareGlyphs();
 	if (glyphIndex >= glyphs.size())
 		throw Exception ("Glyph index " + String (glyphIndex) +
 			" out of bounds ( max " + String (glyphs.size()) + ")");
-	return glyphs [glyphIndex];
+	GlyphPtr & glyph = glyphs [glyphIndex];
+	if (!glyph)
+		glyph = extractGlyph (glyphIndex);
+	return glyph;
 }
 
 UShort OpenTypeFont::getGlyphIndex (String name, bool fail) {
@@ -377,6 +508,7 @@ GlyphPtr OpenTypeFont::getGlyph (String name, bool fail) {
 void OpenTypeFont::replaceGlyph (UShort index, GlyphPtr newGlyph) {
 	Exception::FontContext c1 (*this);
 	Exception::Context c2 ("replacing glyph");
+	checkNotFrozen();
 	if (!glyphsExtracted)
 		extractGlyphs();
 	if (index >= glyphs.size())
@@ -400,6 +532,7 @@ void OpenTypeFont::replaceGlyph (UShort index, GlyphPtr newGlyph) {
 UShort OpenTypeFont::addGlyph (GlyphPtr newGlyph) {
 	Exception::FontContext c1 (*this);
 	Exception::Context c2 ("adding glyph");
+	checkNotFrozen();
 	if (!glyphsExtracted)
 		extractGlyphs();
 	UShort newIndex = glyphs.size();
@@ -448,8 +581,11 @@ void OpenTypeFont::extractUnicodeMapping() {
 
 UShort OpenTypeFont::getGlyphIndexByUnicode (ULong unicode) {
 	Exception::FontContext c (*this);
-	if (!unicodeMapping)
+	if (!unicodeMapping) {
+		if (frozen)
+			throw Exception ("No Microsoft Unicode mapping table found");
 		extractUnicodeMapping();
+	}
 	return unicodeMapping->getGlyphId (unicode);
 }
 
@@ -459,13 +595,12 @@ GlyphPtr OpenTypeFont::getGlyphByUnicode (ULong unicode) {
 
 void OpenTypeFont::addUnicodeMapping (ULong unicode, UShort glyphId){
 	Exception::FontContext c (*this);
+	checkNotFrozen();
 
-	if (!glyphsExtracted)
-		extractGlyphs();
 	if (!unicodeMapping)
 		extractUnicodeMapping();
 
-	if (glyphId >= glyphs.size())
+	if (glyphId >= getGlyphNum())
 		throw Exception ("Cannot add mapping to non-existing glyph " +
 			String (glyphId));
 
@@ -483,6 +618,7 @@ void OpenTypeFont::addUnicodeMapping (ULong unicode, UShort glyphId){
 void OpenTypeFont::setGridFittingBehaviour (const GridFittingBehaviour::Ranges &newRanges) {
 	Exception::FontContext c1 (*this);
 	Exception::Context c2 ("creating 'gasp' table");
+	checkNotFrozen();
 
 	replaceTable (new gaspTable (*this, newRanges), false);
 }
@@ -516,16 +652,19 @@ MemoryBlockPtr OpenTypeFont::getcvt(bool fail) {
 
 void OpenTypeFont::setprep (MemoryBlockPtr newprep) {
 	Exception::FontContext c (*this);
+	checkNotFrozen();
 	replaceTable (new UnknownTable (*this, prepTag, newprep), false);
 }
 
 void OpenTypeFont::setfpgm (MemoryBlockPtr newprep) {
 	Exception::FontContext c (*this);
+	checkNotFrozen();
 	replaceTable (new UnknownTable (*this, fpgmTag, newprep), false);
 }
 
 void OpenTypeFont::setcvt (MemoryBlockPtr newprep) {
 	Exception::FontContext c (*this);
+	checkNotFrozen();
 	replaceTable (new UnknownTable (*this, cvtTag, newprep), false);
 }
 
@@ -558,30 +697,37 @@ UShort OpenTypeFont::getMaxFunctionDefs() {
 }
 
 void OpenTypeFont::setMaxStorage (UShort maxStorage) {
+	checkNotFrozen();
 	getmaxpTable()->setMaxStorage (maxStorage);
 }
 
 void OpenTypeFont::setMaxFunctionDefs (UShort maxFunctionDefs) {
+	checkNotFrozen();
 	getmaxpTable()->setMaxFunctionDefs (maxFunctionDefs);
 }
 
 void OpenTypeFont::setMaxInstructionDefs (UShort maxInstructionDefs) {
+	checkNotFrozen();
 	getmaxpTable()->setMaxInstructionDefs (maxInstructionDefs);
 }
 
 void OpenTypeFont::setMaxSizeOfInstructions (UShort maxSizeOfInstructions) {
+	checkNotFrozen();
 	getmaxpTable()->setMaxSizeOfInstructions (maxSizeOfInstructions);
 }
 
 void OpenTypeFont::setMaxStackElements (UShort maxStackElements) {
+	checkNotFrozen();
 	getmaxpTable()->setMaxStackElements (maxStackElements);
 }
 
 void OpenTypeFont::setMaxZones (UShort maxZones) {
+	checkNotFrozen();
 	getmaxpTable()->setMaxZones (maxZones);
 }
 
 void OpenTypeFont::setMaxTwilightPoints (UShort maxTwilightPoints) {
+	checkNotFrozen();
 	getmaxpTable()->setMaxTwilightPoints (maxTwilightPoints);
 }
 
@@ -708,18 +854,21 @@ UShort OpenTypeFont::getMarkAttachmentClass (GlyphId glyphId) {
 
 void OpenTypeFont::setGSUB (TablePtr table) {
 	Exception::Context c ("Adding glyph substitution table");
+	checkNotFrozen();
 	GSUB = NULL;
 	replaceTable (table, false);
 }
 
 void OpenTypeFont::setGPOS (TablePtr table) {
 	Exception::Context c ("Adding glyph positioning table");
+	checkNotFrozen();
 	GPOS = NULL;
 	replaceTable (table, false);
 }
 
 void OpenTypeFont::setGDEF (TablePtr table) {
 	Exception::Context c ("Adding glyph definition table");
+	checkNotFrozen();
 	GDEF = NULL;
 	replaceTable (table, false);
 }
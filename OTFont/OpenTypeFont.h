@@ -57,10 +57,18 @@ namespace OpenType {
 	*/
 
 	class OpenTypeFont : public OpenTypeFile {
+		/// True if all glyphs have been extracted and the 'glyf', 'loca' and
+		/// 'hmtx' tables have been discarded.
+		/// Before that, glyphs contains only the glyphs that have been asked
+		/// for and glyfMemory contains the raw glyph data to extract the
+		/// others from.
 		bool glyphsExtracted;
 		Glyphs glyphs;
+		MemoryBlockPtr glyfMemory;
 		bool namesExtracted;
 		NameIndices nameIndices;
+		/// True if freeze() has been called.
+		bool frozen;
 
 		/// unicode4Mapping contains the cmap format 4 subtable; unicode12Mapping
 		/// contains the cmap format 12 subtable, which must be a superset of
@@ -95,9 +103,16 @@ namespace OpenType {
 		util::smart_ptr <OS2Table> getOS2Table (bool fail = true);
 		util::smart_ptr <GDEFTable> getGDEFTable (bool fail = true);
 
+		void prepareGlyphs();
+		GlyphPtr extractGlyph (UShort glyphIndex);
 		void extractGlyphs();
 		void extractNames();
 		void extractUnicodeMapping();
+		/// Throw an Exception if the font has been frozen.
+		void checkNotFrozen();
+
+		class GlyphSizeTask;
+		class GlyphWriteTask;
 
 	protected:
 		friend class OpenTypeText;
@@ -114,9 +129,24 @@ namespace OpenType {
 		/// and general information tables accordingly.
 		virtual void writeToFile (util::String outFileName);
 
+		/// \brief Make the font read-only, so that it can be shared between
+		/// threads.
+		///
+		/// All tables and glyphs are read and parsed at once, so that methods
+		/// that read from the font do not change it any more, and may be
+		/// called by several threads at the same time, for example by one
+		/// InstructionProcessor per thread.
+		/// After this, methods that change the font throw an Exception.
+		void freeze();
+		/// Return true if freeze() has been called.
+		bool isFrozen() const {
+			return frozen;
+		}
+
 		/// Return the number of glyphs.
 		UShort getGlyphNum();
 		/// Return the glyph at a given index.
+		/// Only this glyph is read from the glyph data, if it had not been yet.
 		GlyphPtr getGlyph (UShort index);
 		/// Return the index of the first glyph with the given name.
 		/// If fail==true, an exception is thrown if there is no glyph with that name.
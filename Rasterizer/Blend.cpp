@@ -0,0 +1,307 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	\file Blend.cpp paints glyph coverage onto rows of pixels.
+*/
+
+#include <cstring>
+
+#include "Blend.h"
+
+#if defined (__AVX2__)
+#include <immintrin.h>
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace OpenType {
+
+#if defined (__SSE2__)
+
+namespace {
+	// product / 255 rounded down for every 16-bit value, which is exact for
+	// products of two bytes
+	inline __m128i divide255 (__m128i product) {
+		product = _mm_add_epi16 (product, _mm_srli_epi16 (product, 8));
+		return _mm_srli_epi16 (_mm_add_epi16 (product, _mm_set1_epi16 (1)), 8);
+	}
+
+	// bytes * factors / 255 for all 16 bytes
+	inline __m128i scale (__m128i bytes, __m128i factors) {
+		__m128i zero = _mm_setzero_si128();
+		__m128i low = _mm_mullo_epi16 (_mm_unpacklo_epi8 (bytes, zero),
+			_mm_unpacklo_epi8 (factors, zero));
+		__m128i high = _mm_mullo_epi16 (_mm_unpackhi_epi8 (bytes, zero),
+			_mm_unpackhi_epi8 (factors, zero));
+		return _mm_packus_epi16 (divide255 (low), divide255 (high));
+	}
+
+#if defined (__AVX2__)
+	inline __m256i divide255 (__m256i product) {
+		product = _mm256_add_epi16 (product, _mm256_srli_epi16 (product, 8));
+		return _mm256_srli_epi16 (_mm256_add_epi16 (product, _mm256_set1_epi16 (1)), 8);
+	}
+
+	// Unpacking and packing work within the 128-bit halves, so the bytes
+	// stay in order.
+	inline __m256i scale (__m256i bytes, __m256i factors) {
+		__m256i zero = _mm256_setzero_si256();
+		__m256i low = _mm256_mullo_epi16 (_mm256_unpacklo_epi8 (bytes, zero),
+			_mm256_unpacklo_epi8 (factors, zero));
+		__m256i high = _mm256_mullo_epi16 (_mm256_unpackhi_epi8 (bytes, zero),
+			_mm256_unpackhi_epi8 (factors, zero));
+		return _mm256_packus_epi16 (divide255 (low), divide255 (high));
+	}
+#endif
+
+	// The factors that the Factors classes return for bytes [i, i + 16)
+	// and [i, i + 32) are 255 minus the coverage for those bytes.
+
+	// The same coverage for every byte
+	class UniformFactors {
+		Byte factor;
+	public:
+		UniformFactors (Byte coverage) : factor (255 - coverage) {}
+		__m128i get16 (size_t) const {
+			return _mm_set1_epi8 ((char) factor);
+		}
+#if defined (__AVX2__)
+		__m256i get32 (size_t) const {
+			return _mm256_set1_epi8 ((char) factor);
+		}
+#endif
+	};
+
+	// coverage [i] for byte i
+	class ByteFactors {
+		const Byte *coverage;
+	public:
+		ByteFactors (const Byte *aCoverage) : coverage (aCoverage) {}
+		__m128i get16 (size_t i) const {
+			return _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *) (coverage + i)),
+				_mm_set1_epi8 (-1));
+		}
+#if defined (__AVX2__)
+		__m256i get32 (size_t i) const {
+			return _mm256_xor_si256 (_mm256_loadu_si256 ((const __m256i *) (coverage + i)),
+				_mm256_set1_epi8 (-1));
+		}
+#endif
+	};
+
+	// coverage [i / 4] for the four bytes of 32-bit pixel i / 4
+	class PixelFactors {
+		const Byte *coverage;
+	public:
+		PixelFactors (const Byte *aCoverage) : coverage (aCoverage) {}
+		__m128i get16 (size_t i) const {
+			int four;
+			memcpy (&four, coverage + i / 4, 4);
+			__m128i v = _mm_cvtsi32_si128 (four);
+			v = _mm_unpacklo_epi8 (v, v);
+			return _mm_xor_si128 (_mm_unpacklo_epi16 (v, v), _mm_set1_epi8 (-1));
+		}
+#if defined (__AVX2__)
+		__m256i get32 (size_t i) const {
+			__m256i v = _mm256_cvtepu8_epi32 (
+				_mm_loadl_epi64 ((const __m128i *) (coverage + i / 4)));
+			v = _mm256_mullo_epi32 (v, _mm256_set1_epi32 (0x01010101));
+			return _mm256_xor_si256 (v, _mm256_set1_epi8 (-1));
+		}
+#endif
+	};
+
+	// For 32-bit pixel i / 4, the coverage of its red, green and blue
+	// subpixels, coverage [3 * (i / 4)] and the two after it, for the
+	// bytes with red, green and blue, which are bytes 2, 1 and 0
+	class SubPixelFactors {
+		const Byte *coverage;
+		ULong getPixel (size_t pixel) const {
+			const Byte *c = coverage + 3 * pixel;
+			return (ULong (c [0]) << 16) | (ULong (c [1]) << 8) | ULong (c [2]);
+		}
+	public:
+		SubPixelFactors (const Byte *aCoverage) : coverage (aCoverage) {}
+		__m128i get16 (size_t i) const {
+			size_t pixel = i / 4;
+			__m128i v = _mm_set_epi32 (getPixel (pixel + 3), getPixel (pixel + 2),
+				getPixel (pixel + 1), getPixel (pixel));
+			return _mm_xor_si128 (v, _mm_set1_epi8 (-1));
+		}
+#if defined (__AVX2__)
+		__m256i get32 (size_t i) const {
+			size_t pixel = i / 4;
+			__m256i v = _mm256_set_epi32 (getPixel (pixel + 7), getPixel (pixel + 6),
+				getPixel (pixel + 5), getPixel (pixel + 4), getPixel (pixel + 3),
+				getPixel (pixel + 2), getPixel (pixel + 1), getPixel (pixel));
+			return _mm256_xor_si256 (v, _mm256_set1_epi8 (-1));
+		}
+#endif
+	};
+
+	// Set every byte at the start of bytes to
+	// ((byte ^ invert) * factor / 255 ^ invert) | set,
+	// where set is repeated every four bytes, for as many bytes as can be
+	// done a vector at a time. Return the number of bytes done.
+	template <class Factors>
+		size_t scaleBytes (Byte *bytes, size_t num, const Factors &factors,
+			Byte invert, ULong set)
+	{
+		size_t i = 0;
+#if defined (__AVX2__)
+		__m256i invert32 = _mm256_set1_epi8 ((char) invert);
+		__m256i set32 = _mm256_set1_epi32 (set);
+		for (; i + 32 <= num; i += 32) {
+			__m256i *cur = (__m256i *) (bytes + i);
+			__m256i v = _mm256_xor_si256 (_mm256_loadu_si256 (cur), invert32);
+			v = _mm256_xor_si256 (scale (v, factors.get32 (i)), invert32);
+			_mm256_storeu_si256 (cur, _mm256_or_si256 (v, set32));
+		}
+#endif
+		__m128i invert16 = _mm_set1_epi8 ((char) invert);
+		__m128i set16 = _mm_set1_epi32 (set);
+		for (; i + 16 <= num; i += 16) {
+			__m128i *cur = (__m128i *) (bytes + i);
+			__m128i v = _mm_xor_si128 (_mm_loadu_si128 (cur), invert16);
+			v = _mm_xor_si128 (scale (v, factors.get16 (i)), invert16);
+			_mm_storeu_si128 (cur, _mm_or_si128 (v, set16));
+		}
+		return i;
+	}
+}	// end anonymous namespace
+
+#endif // __SSE2__
+
+// pixel * factor / 255 for red, green and blue, with alpha 255
+static inline ULong darken (ULong pixel, int redFactor, int greenFactor, int blueFactor) {
+	return 0xFF000000 |
+		(((pixel >> 16 & 0xFF) * redFactor / 255) << 16) |
+		(((pixel >> 8 & 0xFF) * greenFactor / 255) << 8) |
+		((pixel & 0xFF) * blueFactor / 255);
+}
+
+// Darken subpixel subPixel only
+static inline void darkenSubPixel (ULong *pixels, int subPixel, int factor) {
+	ULong &pixel = pixels [subPixel / 3];
+	int shift = 16 - 8 * (subPixel % 3);
+	ULong value = (pixel >> shift & 0xFF) * factor / 255;
+	pixel = (pixel & ~(ULong (0xFF) << shift)) | (value << shift) | 0xFF000000;
+}
+
+void coverPixels (Byte *pixels, int length, Byte coverage) {
+	int i = 0;
+#if defined (__SSE2__)
+	i = scaleBytes (pixels, length, UniformFactors (coverage), 0xFF, 0);
+#endif
+	int factor = 255 - coverage;
+	for (; i < length; i ++)
+		pixels [i] = 255 - ((255 - pixels [i]) * factor) / 255;
+}
+
+void coverPixels (Byte *pixels, int length, const Byte *coverage) {
+	int i = 0;
+#if defined (__SSE2__)
+	i = scaleBytes (pixels, length, ByteFactors (coverage), 0xFF, 0);
+#endif
+	for (; i < length; i ++)
+		pixels [i] = 255 - ((255 - pixels [i]) * (255 - coverage [i])) / 255;
+}
+
+void darkenPixels (Byte *pixels, int length, Byte coverage) {
+	int i = 0;
+#if defined (__SSE2__)
+	i = scaleBytes (pixels, length, UniformFactors (coverage), 0, 0);
+#endif
+	int factor = 255 - coverage;
+	for (; i < length; i ++)
+		pixels [i] = (pixels [i] * factor) / 255;
+}
+
+void darkenPixels (Byte *pixels, int length, const Byte *coverage) {
+	int i = 0;
+#if defined (__SSE2__)
+	i = scaleBytes (pixels, length, ByteFactors (coverage), 0, 0);
+#endif
+	for (; i < length; i ++)
+		pixels [i] = (pixels [i] * (255 - coverage [i])) / 255;
+}
+
+void darkenPixels (ULong *pixels, int length, Byte coverage) {
+	int i = 0;
+#if defined (__SSE2__)
+	i = scaleBytes ((Byte *) pixels, 4 * length, UniformFactors (coverage),
+		0, 0xFF000000) / 4;
+#endif
+	int factor = 255 - coverage;
+	for (; i < length; i ++)
+		pixels [i] = darken (pixels [i], factor, factor, factor);
+}
+
+void darkenPixels (ULong *pixels, int length, const Byte *coverage) {
+	int i = 0;
+#if defined (__SSE2__)
+	i = scaleBytes ((Byte *) pixels, 4 * length, PixelFactors (coverage),
+		0, 0xFF000000) / 4;
+#endif
+	for (; i < length; i ++) {
+		int factor = 255 - coverage [i];
+		pixels [i] = darken (pixels [i], factor, factor, factor);
+	}
+}
+
+void darkenSubPixels (ULong *pixels, int subPixel, int length, Byte coverage) {
+	int end = subPixel + length;
+	int factor = 255 - coverage;
+	// Up to the first whole pixel
+	for (; subPixel < end && subPixel % 3 != 0; subPixel ++)
+		darkenSubPixel (pixels, subPixel, factor);
+	int whole = (end - subPixel) / 3;
+	darkenPixels (pixels + subPixel / 3, whole, coverage);
+	for (subPixel += 3 * whole; subPixel < end; subPixel ++)
+		darkenSubPixel (pixels, subPixel, factor);
+}
+
+void darkenSubPixels (ULong *pixels, int subPixel, int length, const Byte *coverage) {
+	int end = subPixel + length;
+	// Up to the first whole pixel
+	for (; subPixel < end && subPixel % 3 != 0; subPixel ++, coverage ++)
+		darkenSubPixel (pixels, subPixel, 255 - *coverage);
+
+	ULong *pixel = pixels + subPixel / 3;
+	int whole = (end - subPixel) / 3;
+	int i = 0;
+#if defined (__SSE2__)
+	i = scaleBytes ((Byte *) pixel, 4 * whole, SubPixelFactors (coverage),
+		0, 0xFF000000) / 4;
+#endif
+	for (; i < whole; i ++) {
+		const Byte *c = coverage + 3 * i;
+		pixel [i] = darken (pixel [i], 255 - c [0], 255 - c [1], 255 - c [2]);
+	}
+	subPixel += 3 * whole;
+	coverage += 3 * whole;
+
+	for (; subPixel < end; subPixel ++, coverage ++)
+		darkenSubPixel (pixels, subPixel, 255 - *coverage);
+}
+
+}	// end namespace OpenType
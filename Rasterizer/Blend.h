@@ -0,0 +1,62 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	Kernels that paint the coverage of a glyph onto rows of pixels, where
+	coverage is 255 for pixels that the glyph covers completely. They
+	divide by 255 rounding down, as the code they replace did, so the
+	versions for SSE2 and AVX2 give exactly the same pixels as the plain
+	ones.
+
+	The coverage is either the same for all pixels, or given for every
+	pixel.
+*/
+
+#ifndef OTBLEND_H
+#define OTBLEND_H
+
+#include "../OTFont/OpenType.h"
+
+namespace OpenType {
+	// Paint the coverage onto 8-bit coverage values:
+	// pixel = 255 - (255 - pixel) * (255 - coverage) / 255
+	void coverPixels (Byte *pixels, int length, Byte coverage);
+	void coverPixels (Byte *pixels, int length, const Byte *coverage);
+
+	// Darken 8-bit grey values as black drawn over them:
+	// pixel = pixel * (255 - coverage) / 255
+	void darkenPixels (Byte *pixels, int length, Byte coverage);
+	void darkenPixels (Byte *pixels, int length, const Byte *coverage);
+
+	// The same for the red, green and blue of 32-bit 0xAARRGGBB pixels,
+	// setting alpha to 255
+	void darkenPixels (ULong *pixels, int length, Byte coverage);
+	void darkenPixels (ULong *pixels, int length, const Byte *coverage);
+
+	// Darken the subpixels from subPixel to subPixel + length of 32-bit
+	// pixels, where subpixel i is the red, green or blue part of pixel
+	// i / 3, with i % 3 being 0, 1 or 2. Alpha is set to 255 for every
+	// pixel that is changed.
+	void darkenSubPixels (ULong *pixels, int subPixel, int length, Byte coverage);
+	void darkenSubPixels (ULong *pixels, int subPixel, int length, const Byte *coverage);
+}
+
+#endif // OTBLEND_H
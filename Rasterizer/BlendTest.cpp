@@ -0,0 +1,171 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	\file BlendTest checks every kernel in Blend.h, which have SSE2 and AVX2
+	versions, against the formulas in Blend.h for every length from 0 to 99
+	pixels at every offset from 0 to 4, and for subpixels at every phase
+	from 0 to 6.
+*/
+
+#include <iostream>
+#include <vector>
+
+#include "Blend.h"
+
+using std::cout;
+using std::endl;
+using std::vector;
+using namespace OpenType;
+
+namespace {
+	ULong random = 12345;
+
+	Byte randomByte() {
+		random = random * 1103515245 + 12345;
+		return Byte (random >> 16);
+	}
+
+	ULong randomPixel() {
+		return (ULong (randomByte()) << 24) | (ULong (randomByte()) << 16) |
+			(ULong (randomByte()) << 8) | randomByte();
+	}
+
+	// The formulas the kernels implement, one pixel at a time
+	Byte cover (Byte pixel, Byte coverage) {
+		return 255 - (255 - pixel) * (255 - coverage) / 255;
+	}
+
+	Byte darken (Byte pixel, Byte coverage) {
+		return pixel * (255 - coverage) / 255;
+	}
+
+	ULong darken (ULong pixel, Byte coverage) {
+		return 0xFF000000 | (darken (Byte (pixel >> 16), coverage) << 16) |
+			(darken (Byte (pixel >> 8), coverage) << 8) | darken (Byte (pixel), coverage);
+	}
+
+	ULong darkenSubPixel (ULong pixel, int subPixel, Byte coverage) {
+		int shift = 16 - 8 * (subPixel % 3);
+		ULong value = darken (Byte (pixel >> shift), coverage);
+		return 0xFF000000 | (pixel & ~(0xFF << shift)) | (value << shift);
+	}
+
+	ULong checks = 0, failures = 0;
+
+	template <class Pixel>
+	void check (const vector <Pixel> &result, const vector <Pixel> &expected,
+		const char *kernel, int offset, int length)
+	{
+		checks ++;
+		if (result != expected) {
+			if (failures < 10)
+				cout << kernel << ": wrong at offset " << offset << ", length " << length << endl;
+			failures ++;
+		}
+	}
+}	// end anonymous namespace
+
+bool checkKernels() {
+	vector <Byte> bytes (128), coverage (128);
+	vector <ULong> pixels (64);
+	for (int trial = 0; trial < 12; trial ++) {
+		for (ULong i = 0; i < bytes.size(); i ++)
+			bytes [i] = randomByte();
+		for (ULong i = 0; i < pixels.size(); i ++)
+			pixels [i] = randomPixel();
+		// Glyphs are mostly covered completely or not at all
+		for (ULong i = 0; i < coverage.size(); i ++)
+			coverage [i] = (trial % 2) ? randomByte() : (randomByte() & 1) * 255;
+		Byte uniform = trial % 3 == 0 ? 0 : trial % 3 == 1 ? 255 : randomByte();
+
+		for (int offset = 0; offset < 5; offset ++) {
+			// The coverage is at a different alignment from the pixels
+			const Byte *pixelCoverage = &coverage [offset + trial % 4];
+			for (int length = 0; length < 100; length ++) {
+				vector <Byte> result, expected;
+				vector <ULong> resultPixels, expectedPixels;
+
+				result = expected = bytes;
+				coverPixels (&result [offset], length, uniform);
+				for (int i = 0; i < length; i ++)
+					expected [offset + i] = cover (expected [offset + i], uniform);
+				check (result, expected, "coverPixels", offset, length);
+
+				result = expected = bytes;
+				coverPixels (&result [offset], length, pixelCoverage);
+				for (int i = 0; i < length; i ++)
+					expected [offset + i] = cover (expected [offset + i], pixelCoverage [i]);
+				check (result, expected, "coverPixels with coverage per pixel", offset, length);
+
+				result = expected = bytes;
+				darkenPixels (&result [offset], length, uniform);
+				for (int i = 0; i < length; i ++)
+					expected [offset + i] = darken (expected [offset + i], uniform);
+				check (result, expected, "darkenPixels on bytes", offset, length);
+
+				result = expected = bytes;
+				darkenPixels (&result [offset], length, pixelCoverage);
+				for (int i = 0; i < length; i ++)
+					expected [offset + i] = darken (expected [offset + i], pixelCoverage [i]);
+				check (result, expected, "darkenPixels on bytes with coverage per pixel", offset, length);
+
+				// 64 pixels leave room for every subpixel below
+				if (offset + length <= 64) {
+					resultPixels = expectedPixels = pixels;
+					darkenPixels (&resultPixels [offset], length, uniform);
+					for (int i = 0; i < length; i ++)
+						expectedPixels [offset + i] = darken (expectedPixels [offset + i], uniform);
+					check (resultPixels, expectedPixels, "darkenPixels", offset, length);
+
+					resultPixels = expectedPixels = pixels;
+					darkenPixels (&resultPixels [offset], length, pixelCoverage);
+					for (int i = 0; i < length; i ++)
+						expectedPixels [offset + i] = darken (expectedPixels [offset + i], pixelCoverage [i]);
+					check (resultPixels, expectedPixels, "darkenPixels with coverage per pixel", offset, length);
+				}
+
+				for (int phase = 0; phase < 7; phase ++) {
+					resultPixels = expectedPixels = pixels;
+					darkenSubPixels (&resultPixels [offset], phase, length, uniform);
+					for (int i = phase; i < phase + length; i ++)
+						expectedPixels [offset + i / 3] =
+							darkenSubPixel (expectedPixels [offset + i / 3], i, uniform);
+					check (resultPixels, expectedPixels, "darkenSubPixels", offset, length);
+
+					resultPixels = expectedPixels = pixels;
+					darkenSubPixels (&resultPixels [offset], phase, length, pixelCoverage);
+					for (int i = phase; i < phase + length; i ++)
+						expectedPixels [offset + i / 3] = darkenSubPixel (
+							expectedPixels [offset + i / 3], i, pixelCoverage [i - phase]);
+					check (resultPixels, expectedPixels, "darkenSubPixels with coverage per subpixel", offset, length);
+				}
+			}
+		}
+	}
+
+	cout << checks << " rows, " << failures << " wrong" << endl;
+	return failures == 0;
+}
+
+int main() {
+	return checkKernels() ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	\file GlyphAtlas packs rendered glyphs into pages of coverage values.
+*/
+
+#include <cassert>
+
+#include "GlyphAtlas.h"
+
+namespace OpenType {
+
+GlyphAtlas::GlyphAtlas (ULong aBudget, int aPageWidth, int aPageHeight)
+: pageWidth (aPageWidth), pageHeight (aPageHeight), budget (aBudget), size (0),
+lastPage (0), clock (0) {}
+
+GlyphAtlas::~GlyphAtlas() {}
+
+void GlyphAtlas::clear() {
+	pages.clear();
+	size = 0;
+}
+
+bool GlyphAtlas::fits (const RasterCache &raster) const {
+	if (raster.empty())
+		return true;
+	const RasterCache::Bounds &bounds = raster.getBounds();
+	ULong width = bounds.right - bounds.left;
+	ULong height = bounds.top - bounds.bottom;
+	if (width <= ULong (pageWidth) && height <= ULong (pageHeight))
+		return ULong (pageWidth) * pageHeight <= budget;
+	return height <= budget / width;
+}
+
+GlyphAtlas::Slot GlyphAtlas::add (const RasterCache &raster) {
+	const RasterCache::Bounds &bounds = raster.getBounds();
+	Slot slot;
+	slot.page = 0;
+	slot.x = slot.y = 0;
+	slot.left = bounds.left;
+	slot.top = bounds.top;
+	if (raster.empty()) {
+		slot.width = slot.height = 0;
+		return slot;
+	}
+	slot.width = bounds.right - bounds.left;
+	slot.height = bounds.top - bounds.bottom;
+
+	assert (fits (raster));
+
+	Page *page = allocate (slot);
+	if (!page) {
+		if (slot.width > pageWidth || slot.height > pageHeight)
+			// A page of its own, which nothing else is put on
+			page = &newPage (slot.width, slot.height, slot);
+		else
+			page = &newPage (pageWidth, pageHeight, slot);
+		addShelf (*page, slot);
+	}
+	page->lastUse = ++ clock;
+
+	raster.paint (&page->pixels [0], page->width, page->height, page->width,
+		slot.x - slot.left, slot.y + slot.top - 1);
+	return slot;
+}
+
+GlyphAtlas::Page * GlyphAtlas::allocate (Slot &slot) {
+	// The lowest shelf with room that is at most a quarter higher than
+	// the glyph
+	Page *bestPage = NULL;
+	Shelf *bestShelf = NULL;
+	Pages::iterator page;
+	for (page = pages.begin(); page != pages.end(); page ++) {
+		std::vector <Shelf>::iterator shelf;
+		for (shelf = page->second.shelves.begin(); shelf != page->second.shelves.end(); shelf ++) {
+			if (shelf->height >= slot.height && (shelf->height - slot.height) * 4 <= shelf->height &&
+				shelf->used + slot.width <= page->second.width &&
+				(!bestShelf || shelf->height < bestShelf->height))
+			{
+				bestPage = &page->second;
+				bestShelf = &*shelf;
+				slot.page = page->first;
+			}
+		}
+	}
+	if (bestShelf) {
+		slot.x = bestShelf->used;
+		slot.y = bestShelf->y;
+		bestShelf->used += slot.width;
+		return bestPage;
+	}
+
+	for (page = pages.begin(); page != pages.end(); page ++) {
+		if (addShelf (page->second, slot)) {
+			slot.page = page->first;
+			return &page->second;
+		}
+	}
+	return NULL;
+}
+
+bool GlyphAtlas::addShelf (Page &page, Slot &slot) {
+	int y = 0;
+	if (!page.shelves.empty())
+		y = page.shelves.back().y + page.shelves.back().height;
+	if (slot.width > page.width || y + slot.height > page.height)
+		return false;
+
+	Shelf shelf;
+	shelf.y = y;
+	shelf.height = slot.height;
+	shelf.used = slot.width;
+	page.shelves.push_back (shelf);
+	slot.x = 0;
+	slot.y = y;
+	return true;
+}
+
+GlyphAtlas::Page & GlyphAtlas::newPage (int width, int height, Slot &slot) {
+	ULong bytes = ULong (width) * height;
+	evict (bytes);
+
+	slot.page = ++ lastPage;
+	Page &page = pages [slot.page];
+	page.width = width;
+	page.height = height;
+	page.pixels.resize (bytes, 0);
+	size += bytes;
+	return page;
+}
+
+void GlyphAtlas::evict (ULong bytes) {
+	while (!pages.empty() && size + bytes > budget) {
+		Pages::iterator oldest = pages.begin();
+		for (Pages::iterator page = pages.begin(); page != pages.end(); page ++) {
+			if (page->second.lastUse < oldest->second.lastUse)
+				oldest = page;
+		}
+		size -= oldest->second.pixels.size();
+		pages.erase (oldest);
+	}
+}
+
+}	// end namespace OpenType
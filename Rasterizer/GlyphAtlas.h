@@ -0,0 +1,141 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	GlyphAtlas keeps the coverage of rendered glyphs packed into pages of
+	8-bit coverage values, so that a glyph that is drawn again can be
+	copied out of its rectangle instead of being rendered again.
+
+	Glyphs are packed into a page on shelves: rows as high as the first
+	glyph put on them, which are filled from left to right with glyphs
+	that are not much lower. A glyph that does not fit on a page gets a
+	page of its own, exactly as large as the glyph.
+
+	The pages together are kept within a budget in bytes. When a new page
+	would exceed it, the page that was least recently painted from is
+	dropped, and the glyphs on it have to be added again. A glyph that
+	would need a page larger than the whole budget is not added at all;
+	fits() tells whether a glyph can be.
+*/
+
+#ifndef OTGLYPHATLAS_H
+#define OTGLYPHATLAS_H
+
+#include <vector>
+#include <map>
+
+#include "RasterCache.h"
+
+namespace OpenType {
+	class GlyphAtlas {
+	public:
+		// Where a glyph is kept: the rectangle at (x, y) in page, which
+		// covers the pixels of the glyph from left and from top - 1 down.
+		// Glyphs without any pixels have page 0 and need no page.
+		struct Slot {
+			ULong page;
+			int x, y, width, height;
+			int left, top;
+		};
+
+		enum { defaultPageSize = 256 };
+		enum { defaultBudget = 4 << 20 };
+
+	private:
+		struct Shelf {
+			int y, height;
+			// The glyphs on the shelf take up [0, used)
+			int used;
+		};
+
+		struct Page {
+			int width, height;
+			std::vector <Byte> pixels;
+			std::vector <Shelf> shelves;
+			ULong lastUse;
+		};
+
+		typedef std::map <ULong, Page> Pages;
+
+		Pages pages;
+		int pageWidth, pageHeight;
+		ULong budget;
+		// The number of bytes the pages take
+		ULong size;
+		ULong lastPage;
+		ULong clock;
+
+		// Find room for slot.width * slot.height pixels on a shelf of a
+		// page, set slot.page, slot.x and slot.y, and return the page, or
+		// NULL if no page has any.
+		Page * allocate (Slot &slot);
+		// Start a shelf for slot at the bottom of page, if there is room.
+		static bool addShelf (Page &page, Slot &slot);
+		Page & newPage (int width, int height, Slot &slot);
+		// Drop least recently used pages until bytes more fit the budget.
+		void evict (ULong bytes);
+
+	public:
+		GlyphAtlas (ULong aBudget = defaultBudget,
+			int aPageWidth = defaultPageSize, int aPageHeight = defaultPageSize);
+		~GlyphAtlas();
+
+		void clear();
+		// The budget is kept from the next page that is made
+		void setBudget (ULong aBudget) { budget = aBudget; }
+		ULong getBudget() const { return budget; }
+		ULong getSize() const { return size; }
+
+		// Whether raster can be put into the atlas, i.e., whether the page
+		// it would need is within the budget. If not, it must be painted
+		// from the raster itself.
+		bool fits (const RasterCache &raster) const;
+
+		// Put raster, which fits, into the atlas, and return where it is.
+		Slot add (const RasterCache &raster);
+
+		// If the glyph in slot is still in the atlas, call painter.row (y)
+		// for every row of it from the top down and if that returns true,
+		// painter.pixels (x, length, coverage) with the coverage of the
+		// whole row, just like RasterCache::paintRows, and return true.
+		// If it is not, return false.
+		template <class Painter> bool paintRows (const Slot &slot, Painter &painter);
+	};
+
+	template <class Painter> inline bool GlyphAtlas::paintRows (const Slot &slot, Painter &painter) {
+		if (!slot.page)
+			return true;
+		Pages::iterator page = pages.find (slot.page);
+		if (page == pages.end())
+			return false;
+		page->second.lastUse = ++ clock;
+
+		int stride = page->second.width;
+		const Byte *coverage = &page->second.pixels [slot.y * stride + slot.x];
+		for (int y = slot.top - 1; y >= slot.top - slot.height; y --, coverage += stride) {
+			if (painter.row (y))
+				painter.pixels (slot.left, slot.width, coverage);
+		}
+		return true;
+	}
+}
+
+#endif // OTGLYPHATLAS_H
@@ -0,0 +1,278 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	\file RasterCache renders glyph outlines into spans of coverage values.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <new>
+#include <stdexcept>
+
+#include "RasterCache.h"
+#include "Blend.h"
+
+using std::vector;
+
+namespace OpenType {
+
+// At least the size of a cell in the render pool of ftgrays.c
+#define cellSize (4 * sizeof (long))
+// The smallest pool that ftgrays accepts
+#define minPoolSize 4096
+// Outlines that a bad program has spread over millions of pixels would need
+// a huge pool; ftgrays splits the bands in smaller ones when this is full.
+#define maxPoolSize (1024 * 1024)
+
+/*** RasterContext ***/
+
+RasterContext::RasterContext() {
+	if (ft_grays_raster.raster_new (NULL, &raster) != 0)
+		throw std::bad_alloc();
+}
+
+RasterContext::~RasterContext() {
+	ft_grays_raster.raster_done (raster);
+}
+
+RasterContext & RasterContext::getDefault() {
+	static RasterContext context;
+	return context;
+}
+
+ULong RasterContext::convertOutline (const InstructionProcessor::Points &source) {
+	ULong pointNum = source.size();
+	points.resize (pointNum);
+	tags.resize (pointNum);
+	contours.clear();
+
+	// ftgrays records a cell every time the outline crosses into another
+	// pixel. A curve varies no more than its control polygon does, so the
+	// number of cells is at most the length of the polygon in pixels,
+	// measured along x and y, plus one for every segment.
+	FT_Pos length = 0;
+	FT_Pos minY = 0, maxY = 0;
+	ULong contourBegin = 0;
+	for (ULong i = 0; i < pointNum; i ++) {
+		const InstructionProcessor::GridFittedPoint &point = source [i];
+		FT_Vector &v = points [i];
+		v.x = point.currentX.get_i();
+		v.y = point.currentY.get_i();
+		tags [i] = point.onCurve ? 1 : 0;
+
+		if (i == 0 || v.y < minY)
+			minY = v.y;
+		if (i == 0 || v.y > maxY)
+			maxY = v.y;
+
+		if (i != contourBegin)
+			length += labs (v.x - points [i - 1].x) + labs (v.y - points [i - 1].y);
+		if (point.lastContourPoint) {
+			// The segment that closes the contour
+			length += labs (v.x - points [contourBegin].x) +
+				labs (v.y - points [contourBegin].y);
+			contours.push_back (i);
+			contourBegin = i + 1;
+		}
+	}
+
+	ULong cellNum = length / 64 + pointNum + 1;
+	// ftgrays renders in bands of cellNum / 8 rows
+	ULong rowNum = (maxY - minY) / 64 + 2;
+	if (cellNum < 8 * rowNum)
+		cellNum = 8 * rowNum;
+	if (cellNum > maxPoolSize / cellSize)
+		cellNum = maxPoolSize / cellSize;
+	ULong poolSize = cellNum * cellSize;
+	if (poolSize < minPoolSize)
+		poolSize = minPoolSize;
+	return poolSize;
+}
+
+void RasterContext::render (const InstructionProcessor::Points &source) {
+	spans.clear();
+	rows.clear();
+	if (source.empty())
+		return;
+	// ftgrays counts points and contours in shorts; every contour ends at
+	// a point, so there are no more contours than points
+	if (source.size() > SHRT_MAX)
+		throw std::length_error ("Outline has too many points to be rendered");
+
+	ULong poolSize = convertOutline (source);
+	if (poolSize > pool.size()) {
+		if (poolSize < 2 * pool.size())
+			poolSize = 2 * pool.size();
+		if (poolSize > maxPoolSize)
+			poolSize = maxPoolSize;
+		pool.resize (poolSize);
+	}
+	// This also restores the band size, which ftgrays reduces when it has
+	// to split bands often
+	ft_grays_raster.raster_reset (raster, &pool [0], pool.size());
+
+	FT_Outline outline = {(short) contours.size(), (short) points.size(), &points [0],
+		&tags [0], contours.empty() ? NULL : &contours [0], 0};
+
+	FT_Raster_Params params = {NULL, &outline, ft_raster_flag_aa | ft_raster_flag_direct,
+		&rasterCallback, NULL, NULL, NULL, this, {0,0,0,0}};
+
+	ft_grays_raster.raster_render (raster, &params);
+}
+
+void rasterCallback(int y, int count, FT_Span* spans, void* user) {
+	RasterContext *context = (RasterContext*) user;
+	if (count!=0) {
+		// ftgrays renders rows from the bottom up, but may pass a row with
+		// many spans in more than one call.
+		std::vector <RasterContext::Row> &rows = context->rows;
+		if (rows.empty() || rows.back().y != y) {
+			RasterContext::Row row;
+			row.y = y;
+			row.begin = context->spans.size();
+			rows.push_back (row);
+		}
+		context->spans.insert (context->spans.end(), spans, spans + count);
+		rows.back().end = context->spans.size();
+	}
+}
+
+/*** RasterCache ***/
+
+RasterCache::RasterCache (const InstructionProcessor::Points &points)
+{
+	RasterContext &context = RasterContext::getDefault();
+	context.render (points);
+	compact (context);
+}
+
+RasterCache::RasterCache (const InstructionProcessor::Points &points, RasterContext &context)
+{
+	context.render (points);
+	compact (context);
+}
+
+RasterCache::~RasterCache() {}
+
+void RasterCache::compact (const RasterContext &context) {
+	const vector <FT_Span> &renderedSpans = context.getSpans();
+	const vector <RasterContext::Row> &rows = context.getRows();
+	bounds.left = bounds.bottom = bounds.right = bounds.top = 0;
+	if (rows.empty())
+		return;
+
+	// The spans in a row are sorted
+	bounds.bottom = rows.front().y;
+	bounds.top = rows.back().y + 1;
+	bounds.left = renderedSpans [rows.front().begin].x;
+	bounds.right = bounds.left;
+	vector <RasterContext::Row>::const_iterator row;
+	for (row = rows.begin(); row != rows.end(); row ++) {
+		const FT_Span &first = renderedSpans [row->begin];
+		const FT_Span &last = renderedSpans [row->end - 1];
+		if (first.x < bounds.left)
+			bounds.left = first.x;
+		if (last.x + last.len > bounds.right)
+			bounds.right = last.x + last.len;
+	}
+
+	ULong width = bounds.right - bounds.left;
+	ULong height = bounds.top - bounds.bottom;
+	ULong spanNum = height + renderedSpans.size();
+	if (width * height <= spanNum * sizeof (FT_Span)) {
+		bitmap.resize (width * height, 0);
+		for (row = rows.begin(); row != rows.end(); row ++) {
+			Byte *line = &bitmap [(bounds.top - 1 - row->y) * width] - bounds.left;
+			for (ULong i = row->begin; i != row->end; i ++) {
+				const FT_Span &span = renderedSpans [i];
+				memset (line + span.x, span.coverage, span.len);
+			}
+		}
+	} else {
+		spans.reserve (spanNum);
+		// From the top down, with an empty span for every row without any
+		int y = bounds.top - 1;
+		vector <RasterContext::Row>::const_reverse_iterator row;
+		for (row = rows.rbegin(); row != rows.rend(); row ++, y --) {
+			FT_Span count = {0, 0, 0};
+			for (; y > row->y; y --)
+				spans.push_back (count);
+			count.len = row->end - row->begin;
+			spans.push_back (count);
+			spans.insert (spans.end(), renderedSpans.begin() + row->begin,
+				renderedSpans.begin() + row->end);
+		}
+	}
+}
+
+namespace {
+	class CoveragePainter {
+		Byte *buffer;
+		int width, height, stride, x, y;
+		Byte *scanLine;
+	public:
+		CoveragePainter (Byte *aBuffer, int aWidth, int aHeight, int aStride, int aX, int aY)
+			: buffer (aBuffer), width (aWidth), height (aHeight), stride (aStride),
+			x (aX), y (aY), scanLine (NULL) {}
+
+		// The pixels in the buffer that pixels glyphX to glyphX + length
+		// of the glyph are painted on
+		void clip (int glyphX, int length, int &begin, int &end) const {
+			begin = x + glyphX;
+			end = begin + length;
+			if (begin < 0)
+				begin = 0;
+			if (end > width)
+				end = width;
+		}
+
+		bool row (int glyphY) {
+			int line = y - glyphY;
+			if (line < 0 || line >= height)
+				return false;
+			scanLine = buffer + line * stride;
+			return true;
+		}
+
+		void run (int glyphX, int length, Byte coverage) {
+			int begin, end;
+			clip (glyphX, length, begin, end);
+			if (begin < end)
+				coverPixels (scanLine + begin, end - begin, coverage);
+		}
+
+		void pixels (int glyphX, int length, const Byte *coverage) {
+			int begin, end;
+			clip (glyphX, length, begin, end);
+			if (begin < end)
+				coverPixels (scanLine + begin, end - begin, coverage + begin - x - glyphX);
+		}
+	};
+}	// end anonymous namespace
+
+void RasterCache::paint (Byte *buffer, int width, int height, int stride, int x, int y) const {
+	CoveragePainter painter (buffer, width, height, stride, x, y);
+	paintRows (painter);
+}
+
+}	// end namespace OpenType
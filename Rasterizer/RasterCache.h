@@ -0,0 +1,176 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	RasterCache renders a glyph outline with the FreeType greyscale renderer
+	in ftgrays.c, and keeps the coverage it produces, so that the glyph can
+	be painted into 8-bit coverage buffers. It does not depend on Qt.
+
+	Anything that includes this should be compiled with _STANDALONE_
+	defined, as ftgrays.c is.
+*/
+
+#ifndef OTRASTERCACHE_H
+#define OTRASTERCACHE_H
+
+#include <vector>
+
+#include "../InstructionProcessor/InstructionProcessor.h"
+#include "ftgrays.h"
+
+namespace OpenType {
+	void rasterCallback (int y, int count, FT_Span* spans, void* user);
+
+	/**
+		RasterContext keeps the state that the rasteriser needs between
+		glyphs: the ftgrays raster, its render pool, the buffers that the
+		outline is converted into and the buffers that the spans are
+		collected in. These grow to fit the largest glyph rendered so far
+		and are reused for the next one, so that rendering does not
+		allocate memory in steady state.
+
+		The pool is made large enough for ftgrays to render every glyph in
+		one band; with a pool that is too small, it renders the outline
+		again for every band and for every band it has to split.
+
+		A context must be used by one thread at a time; every thread that
+		renders glyphs should have its own.
+	*/
+	class RasterContext {
+	public:
+		// The spans in row y are [begin, end) in getSpans().
+		struct Row {
+			int y;
+			ULong begin, end;
+		};
+
+	private:
+		FT_Raster raster;
+		std::vector <Byte> pool;
+		std::vector <FT_Vector> points;
+		std::vector <char> tags;
+		std::vector <short> contours;
+		std::vector <FT_Span> spans;
+		std::vector <Row> rows;
+		friend void rasterCallback (int y, int count, FT_Span* spans, void* user);
+
+		// Copy points into the outline buffers, and return the pool size in
+		// bytes that ftgrays needs to render them in one band.
+		ULong convertOutline (const InstructionProcessor::Points &points);
+
+		// Contexts cannot be copied
+		RasterContext (const RasterContext &);
+		RasterContext & operator = (const RasterContext &);
+
+	public:
+		RasterContext();
+		~RasterContext();
+
+		// Render points. The spans are kept until the next call.
+		void render (const InstructionProcessor::Points &points);
+
+		const std::vector <FT_Span> & getSpans() const { return spans; }
+		// The rows that have spans, from the bottom up
+		const std::vector <Row> & getRows() const { return rows; }
+
+		ULong getPoolSize() const { return pool.size(); }
+
+		// The context that RasterCache uses when none is given, which can
+		// only be used by one thread at a time.
+		static RasterContext & getDefault();
+	};
+
+	/**
+		A glyph is kept in one buffer, in whichever of two forms is smaller.
+		For glyphs with long runs of pixels with the same coverage, which
+		are mostly large ones, this is a span array in which every row from
+		the top down starts with a span whose len is the number of spans in
+		that row. Other glyphs are kept as a bitmap of coverage values, one
+		byte for every pixel within the bounds, with the top row first.
+	*/
+	class RasterCache {
+	public:
+		// The pixels that the glyph covers, with y upwards from the
+		// baseline: columns left to right - 1 and rows bottom to top - 1
+		struct Bounds {
+			int left, bottom, right, top;
+		};
+
+	protected:
+		Bounds bounds;
+		// Only one of these is not empty
+		std::vector <FT_Span> spans;
+		std::vector <Byte> bitmap;
+
+		void compact (const RasterContext &context);
+
+	public:
+		RasterCache (const InstructionProcessor::Points &points);
+		RasterCache (const InstructionProcessor::Points &points, RasterContext &context);
+		virtual ~RasterCache();
+
+		bool empty() const { return spans.empty() && bitmap.empty(); }
+		const Bounds & getBounds() const { return bounds; }
+		// The number of bytes that the coverage takes
+		ULong getSize() const {
+			return spans.size() * sizeof (FT_Span) + bitmap.size();
+		}
+
+		// Call painter.row (y) for every row from the top down, and if that
+		// returns true, paint the row from left to right with either
+		// painter.run (x, length, coverage) for runs of pixels with the
+		// same coverage, skipping pixels that the glyph does not cover, or
+		// painter.pixels (x, length, coverage) for the whole row, with a
+		// coverage value for every pixel.
+		template <class Painter> void paintRows (Painter &painter) const;
+
+		// Paint the glyph into a buffer of width * height coverage values,
+		// with rows stride bytes apart and the top row first, putting the
+		// origin of the glyph at the bottom left corner of pixel (x, y).
+		// Coverage already in the buffer is combined with the glyph as if
+		// the glyph were drawn over it.
+		void paint (Byte *buffer, int width, int height, int stride, int x, int y) const;
+	};
+
+	template <class Painter> inline void RasterCache::paintRows (Painter &painter) const {
+		if (!bitmap.empty()) {
+			int width = bounds.right - bounds.left;
+			const Byte *coverage = &bitmap [0];
+			for (int y = bounds.top - 1; y >= bounds.bottom; y --, coverage += width) {
+				if (painter.row (y))
+					painter.pixels (bounds.left, width, coverage);
+			}
+		} else {
+			std::vector <FT_Span>::const_iterator span = spans.begin();
+			for (int y = bounds.top - 1; span != spans.end(); y --) {
+				std::vector <FT_Span>::const_iterator end = span + 1 + span->len;
+				span ++;
+				if (painter.row (y)) {
+					for (; span != end; span ++)
+						painter.run (span->x, span->len, span->coverage);
+				} else
+					span = end;
+			}
+		}
+	}
+}
+
+#endif // OTRASTERCACHE_H
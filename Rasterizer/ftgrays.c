@@ -145,6 +145,7 @@
 #ifdef _STANDALONE_
 
 #include <string.h>             /* for ft_memcpy() */
+#include <stdlib.h>             /* for malloc() and free() */
 #include <setjmp.h>
 #include <limits.h>
 #define FT_UINT_MAX  UINT_MAX
@@ -2075,7 +2076,7 @@
 
 
   /**** RASTER OBJECT CREATION: In standalone mode, we simply use *****/
-  /****                         a static object.                  *****/
+  /****                         malloc() and free().              *****/
 
 #ifdef GRAYS_USE_GAMMA
 
@@ -2112,16 +2113,20 @@
   gray_raster_new( void*       memory,
                    FT_Raster*  araster )
   {
-    static TRaster  the_raster;
+    PRaster  raster;
 
     FT_UNUSED( memory );
 
 
-    *araster = (FT_Raster)&the_raster;
-    FT_MEM_ZERO( &the_raster, sizeof ( the_raster ) );
+    raster = (PRaster)malloc( sizeof ( TRaster ) );
+    *araster = (FT_Raster)raster;
+    if ( !raster )
+      return ErrRaster_MemoryOverflow;
+
+    FT_MEM_ZERO( raster, sizeof ( TRaster ) );
 
 #ifdef GRAYS_USE_GAMMA
-    grays_init_gamma( (PRaster)*araster );
+    grays_init_gamma( raster );
 #endif
 
     return 0;
@@ -2131,8 +2136,7 @@
   static void
   gray_raster_done( FT_Raster  raster )
   {
-    /* nothing */
-    FT_UNUSED( raster );
+    free( raster );
   }
 
 #else /* _STANDALONE_ */
@@ -396,9 +396,12 @@ void MainScope::compileFont (smart_ptr <OpenTypeFont> font) {
 		(*var)->addToInstructionSequence (&*fontProgramSeq);
 
 	// Add functions to fpgm table
+	functionNames.clear();
+	functionNames.resize (functionId);
 	for (fdef = functionDefs.begin(); fdef < functionDefs.end(); fdef++) {
 		InstructionSequencePtr seq = (*fdef)->getInstructionSequence(false);
 		if (seq) {
+			functionNames [(*fdef)->getFunctionId()] = (*fdef)->getName();
 			fontProgramSeq->push((*fdef)->getFunctionId());
 			fontProgramSeq->addInstruction(new FunctionDefInstruction());
 			fontProgramSeq->notifyStackChange(1);
@@ -436,6 +439,10 @@ void MainScope::compileFont (smart_ptr <OpenTypeFont> font) {
 	font->setMaxSizeOfInstructions (maxGlyphInstructionSize);
 }
 
+const vector <String> & MainScope::getFunctionNames() const {
+	return functionNames;
+}
+
 
 /*** BodyScope ***/
 
@@ -83,6 +83,8 @@ public:
 ostream& operator<< (ostream& o, const Scope &scope);
 
 class MainScope : public Scope {
+	// The names of the functions in the font program by identifier
+	vector <String> functionNames;
 public:
 	MainScope(Preprocessor &prep);
 	virtual ~MainScope() {}
@@ -95,6 +97,9 @@ public:
 	virtual void addExecutableDef(StatementPtr statement);
 
 	void compileFont (smart_ptr <OpenTypeFont> font);
+	// The names of the functions that compileFont put in the font
+	// program, by function identifier
+	const vector <String> & getFunctionNames() const;
 };
 
 class BodyScope : public Scope {
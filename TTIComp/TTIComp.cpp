@@ -43,11 +43,15 @@
 #endif
 
 #include <iostream>
+#include <fstream>
+#include <cstdlib>
 #include "../Util/smart_ptr.h"
+#include "../Util/check_overflow.h"
 #include "../Util/Preprocessor.h"
 
 #include "../OTFont/OpenTypeFont.h"
 #include "../OTFont/OTGlyph.h"
+#include "../InstructionProcessor/InstructionProfiler.h"
 
 #include "FunctionScope.h"
 #include "TTICompPreprocessor.h"
@@ -57,13 +61,28 @@ using std::cout;
 
 bool optimise = false;
 bool listing = false;
+bool profile = false;
+ULong minPPEM, maxPPEM;
 
 void printUsage() {
 	cout<< "    TTIComp  compiles a .TTI file into an instructed TrueType file" << endl
-		<< "Usage : TTIComp [-o] [-l] filename.tti" << endl
+		<< "Usage : TTIComp [-o] [-l] [-p minppem maxppem] filename.tti" << endl
 		<< "where" << endl
 		<< "  -o   produce optimised code" << endl
-		<< "  -l   print a listing of the compiled code" << endl;
+		<< "  -l   print a listing of the compiled code" << endl
+		<< "  -p   hint every glyph of the output font at every size from" << endl
+		<< "       minppem to maxppem and write where the time goes to" << endl
+		<< "       <output>.profile.csv, .profile.json and .profile.folded" << endl;
+}
+
+// Read a ppem value for -p, which must be a whole number from 1 to 65535
+bool parsePPEM (const char *argument, ULong &ppem) {
+	char *end;
+	long value = strtol (argument, &end, 10);
+	if (end == argument || *end != '\0' || value < 1 || value > 0xFFFF)
+		return false;
+	ppem = (ULong) value;
+	return true;
 }
 
 class coutOpenTypeFont : public OpenTypeFont {
@@ -74,6 +93,68 @@ public:
 	}
 };
 
+class ProfilingProcessor : public InstructionProcessor {
+protected:
+	// Warnings do not matter for the profile
+	virtual void addWarning (InstructionExceptionPtr aWarning) {}
+};
+
+// Hint all glyphs in the font at all sizes from minPPEM to maxPPEM, naming
+// the functions after the TTI functions they were compiled from, and write
+// the profile next to the font.
+void profileFont (String fileName, const std::vector <String> &functionNames) {
+	cout << "Profiling " << fileName << "..." << endl;
+
+	smart_ptr <OpenTypeFont> font = new coutOpenTypeFont ();
+	font->readFromFile (fileName);
+
+	InstructionProfiler profiler;
+	ULong id;
+	for (id = 0; id < functionNames.size(); id ++)
+		profiler.setFunctionName (id, functionNames [id]);
+
+	ProfilingProcessor processor;
+	processor.setFont (font);
+	processor.setProfiler (&profiler);
+
+	InstructionProcessor::Points points;
+	UShort glyphNum = font->getGlyphNum();
+	ULong errorNum = 0;
+	for (ULong ppem = minPPEM; ppem <= maxPPEM; ppem ++) {
+		try {
+			processor.setPPEM (ppem, ppem, ppem);
+			for (UShort glyphId = 0; glyphId < glyphNum; glyphId ++) {
+				try {
+					processor.getGlyphPoints (glyphId, points);
+				} catch (Exception &) {
+					errorNum ++;
+				} catch (util::overflow_exception &) {
+					errorNum ++;
+				}
+			}
+		} catch (Exception &) {
+			errorNum ++;
+		} catch (util::overflow_exception &) {
+			errorNum ++;
+		}
+	}
+	processor.setProfiler (NULL);
+
+	String csvName = fileName + ".profile.csv";
+	String jsonName = fileName + ".profile.json";
+	String foldedName = fileName + ".profile.folded";
+	std::ofstream csv (csvName.getCString());
+	profiler.writeCSV (csv);
+	std::ofstream json (jsonName.getCString());
+	profiler.writeJSON (json);
+	std::ofstream folded (foldedName.getCString());
+	profiler.writeFoldedStacks (folded);
+	if (!csv || !json || !folded)
+		throw Exception ("Could not write profile of " + fileName);
+
+	cout << "Profiled " << fileName << ": " << errorNum << " errors while hinting." << endl;
+}
+
 
 int main(int argCount, char *argValues[]) {
 //	chdir("F:/Van Dalen/Mijn documenten/Rogier/Fonts/fonts");
@@ -101,9 +182,17 @@ int main(int argCount, char *argValues[]) {
 				if (strcmp(argValues[i], "-l")==0)
 					listing = true;
 				else {
-					cout << "Argument " << i << "could not be parsed" << endl;
-					printUsage();
-					return -1;
+					if (strcmp(argValues[i], "-p")==0 && i+2 < argCount-1)
+						profile = parsePPEM (argValues[i+1], minPPEM) &&
+							parsePPEM (argValues[i+2], maxPPEM) && minPPEM <= maxPPEM;
+					else
+						profile = false;
+					if (!profile) {
+						cout << "Argument " << i << " could not be parsed" << endl;
+						printUsage();
+						return -1;
+					}
+					i += 2;
 				}
 			}
 			i++;
@@ -202,6 +291,9 @@ int main(int argCount, char *argValues[]) {
 
 			// Write font
 			font->writeToFile(outputFileName);
+
+			if (profile)
+				profileFont (outputFileName, scope->getFunctionNames());
 		}
 	} catch (Exception &e) {
 		cout << "Error: " << e << endl;
@@ -0,0 +1,308 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with the OpenType/TrueType Font Tools; if not, write to the Free
+	Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	\file TTRender renders hinted glyphs into greyscale atlases, without Qt.
+*/
+
+#ifdef _MSC_VER
+// Disable "type name to long to fit in debug information file" warning on Visual C++
+#pragma warning(disable:4786)
+#endif
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+#include "../Util/smart_ptr.h"
+#include "../Util/check_overflow.h"
+#include "../OTFont/OpenTypeFont.h"
+#include "../OTFont/OTException.h"
+#include "../InstructionProcessor/InstructionProcessor.h"
+#include "../Rasterizer/RasterCache.h"
+
+using std::cout;
+using std::endl;
+using std::vector;
+using util::smart_ptr;
+using util::String;
+using namespace OpenType;
+
+void printUsage() {
+	cout<< "    TTRender  renders hinted glyphs into greyscale atlases" << endl
+		<< "Usage : TTRender [-g first last] [-r] [-o prefix] [-t] font ppem..." << endl
+		<< "where" << endl
+		<< "  -g   render only the glyphs first to last" << endl
+		<< "  -r   write raw 8-bit atlases instead of PGM files" << endl
+		<< "  -o   start the names of the output files with prefix instead of" << endl
+		<< "       the name of the font" << endl
+		<< "  -t   only time how long rendering the hinted glyphs takes, and" << endl
+		<< "       do not write anything" << endl
+		<< "A ppem may also be a range, as in 8-200." << endl
+		<< "For every ppem the atlas is written to <prefix>-<ppem>.pgm or .raw, and" << endl
+		<< "where every glyph is in it to <prefix>-<ppem>.txt." << endl;
+}
+
+class coutOpenTypeFont : public OpenTypeFont {
+public:
+	virtual void addWarning (ExceptionPtr aWarning) {
+		cout << "Warning: " << aWarning << endl;
+	}
+};
+
+class RenderProcessor : public InstructionProcessor {
+protected:
+	// Warnings do not change the rendering
+	virtual void addWarning (InstructionExceptionPtr aWarning) {}
+};
+
+// A glyph rendered at one size, with its origin at x = 0 and y = 0
+struct RenderedGlyph {
+	UShort glyphId;
+	smart_ptr <RasterCache> raster;
+	int advance;
+};
+
+typedef vector <RenderedGlyph> RenderedGlyphs;
+
+// Hint and render the glyphs first to last at the current size. Glyphs that
+// cannot be hinted are left empty.
+void renderGlyphs (InstructionProcessor &processor, RasterContext &context,
+				   ULong ppem, UShort first, UShort last, RenderedGlyphs &glyphs)
+{
+	InstructionProcessor::Points points;
+	glyphs.clear();
+	for (ULong glyphId = first; glyphId <= last; glyphId ++) {
+		RenderedGlyph glyph;
+		glyph.glyphId = glyphId;
+		glyph.advance = 0;
+		points.clear();
+		try {
+			processor.getGlyphPoints (glyphId, points);
+		} catch (Exception &e) {
+			cout << "Error in glyph " << glyphId << " at " << ppem << " ppem: " << e << endl;
+			points.clear();
+		} catch (util::overflow_exception &) {
+			cout << "Error in glyph " << glyphId << " at " << ppem << " ppem: overflow" << endl;
+			points.clear();
+		}
+
+		if (points.size() >= 4) {
+			// Translate so that lsb point is at x=0
+			InstructionProcessor::Points::iterator lsb = points.end() - 4;
+			NewF26Dot6 translation = lsb->currentX.round();
+			for (InstructionProcessor::Points::iterator i = points.begin(); i != points.end(); i++)
+				i->currentX -= translation;
+			glyph.advance = ((points.end() - 3)->currentX - lsb->currentX).round();
+		}
+		glyph.raster = new RasterCache (points, context);
+		glyphs.push_back (glyph);
+	}
+}
+
+// How long rendering took, and which glyph took longest
+struct RenderTiming {
+	double seconds;
+	ULong glyphNum, bytes;
+	double slowest;
+	UShort slowestGlyph;
+	ULong slowestPPEM;
+};
+
+// Hint the glyphs first to last at the current size, and then render them
+// all, timing only the rendering.
+void timeRendering (InstructionProcessor &processor, RasterContext &context,
+					ULong ppem, UShort first, UShort last, RenderTiming &timing)
+{
+	vector <InstructionProcessor::Points> hinted (last - first + 1);
+	for (ULong glyphId = first; glyphId <= last; glyphId ++) {
+		try {
+			processor.getGlyphPoints (glyphId, hinted [glyphId - first]);
+		} catch (Exception &) {
+			hinted [glyphId - first].clear();
+		} catch (util::overflow_exception &) {
+			hinted [glyphId - first].clear();
+		}
+	}
+
+	for (ULong glyphId = first; glyphId <= last; glyphId ++) {
+		clock_t start = clock();
+		RasterCache raster (hinted [glyphId - first], context);
+		double seconds = double (clock() - start) / CLOCKS_PER_SEC;
+		timing.seconds += seconds;
+		timing.glyphNum ++;
+		timing.bytes += raster.getSize();
+		if (seconds > timing.slowest) {
+			timing.slowest = seconds;
+			timing.slowestGlyph = glyphId;
+			timing.slowestPPEM = ppem;
+		}
+	}
+}
+
+// Put the glyphs in a grid of equal cells, one glyph in the top left corner
+// of every cell, and write the atlas and the positions of the glyphs in it.
+void writeAtlas (const RenderedGlyphs &glyphs, ULong ppem, const String &prefix, bool raw) {
+	int cellWidth = 1, cellHeight = 1;
+	RenderedGlyphs::const_iterator glyph;
+	for (glyph = glyphs.begin(); glyph != glyphs.end(); glyph ++) {
+		const RasterCache::Bounds &bounds = glyph->raster->getBounds();
+		if (bounds.right - bounds.left > cellWidth)
+			cellWidth = bounds.right - bounds.left;
+		if (bounds.top - bounds.bottom > cellHeight)
+			cellHeight = bounds.top - bounds.bottom;
+	}
+	int columns = 1;
+	while (columns * columns < (int) glyphs.size())
+		columns ++;
+	int rows = (glyphs.size() + columns - 1) / columns;
+	int width = columns * cellWidth;
+	int height = rows * cellHeight;
+
+	vector <Byte> atlas (width * height, 0);
+	String baseName = prefix + '-' + String ((unsigned long) ppem);
+	String indexName = baseName + ".txt";
+	std::ofstream index (indexName.getCString());
+	index << "# atlas " << width << ' ' << height << " ppem " << ppem << endl;
+	index << "# glyph x y width height left top advance" << endl;
+
+	int i = 0;
+	for (glyph = glyphs.begin(); glyph != glyphs.end(); glyph ++, i ++) {
+		const RasterCache::Bounds &bounds = glyph->raster->getBounds();
+		int x = (i % columns) * cellWidth;
+		int y = (i / columns) * cellHeight;
+		if (!glyph->raster->empty())
+			glyph->raster->paint (&atlas [0] + y * width + x, cellWidth, cellHeight, width,
+				- bounds.left, bounds.top - 1);
+		index << glyph->glyphId << ' ' << x << ' ' << y << ' ' <<
+			bounds.right - bounds.left << ' ' << bounds.top - bounds.bottom << ' ' <<
+			bounds.left << ' ' << bounds.top << ' ' << glyph->advance << endl;
+	}
+
+	String atlasName = baseName + (raw ? ".raw" : ".pgm");
+	std::ofstream file (atlasName.getCString(), std::ios::out | std::ios::binary);
+	if (!raw)
+		file << "P5\n" << width << ' ' << height << "\n255\n";
+	file.write ((const char *) &atlas [0], atlas.size());
+
+	if (!index || !file)
+		throw Exception ("Could not write " + atlasName);
+	cout << "Wrote " << atlasName << " and " << indexName << endl;
+}
+
+int main (int argCount, char *argValues[]) {
+	try {
+		bool raw = false;
+		bool timing = false;
+		bool glyphRange = false;
+		ULong first = 0, last = 0;
+		String prefix;
+
+		int i = 1;
+		while (i < argCount && argValues[i][0] == '-') {
+			if (strcmp (argValues[i], "-r") == 0)
+				raw = true;
+			else if (strcmp (argValues[i], "-t") == 0)
+				timing = true;
+			else if (strcmp (argValues[i], "-g") == 0 && i + 2 < argCount) {
+				glyphRange = true;
+				first = atoi (argValues[i+1]);
+				last = atoi (argValues[i+2]);
+				i += 2;
+			} else if (strcmp (argValues[i], "-o") == 0 && i + 1 < argCount) {
+				prefix = argValues[i+1];
+				i ++;
+			} else {
+				cout << "Argument " << i << " could not be parsed" << endl;
+				printUsage();
+				return -1;
+			}
+			i ++;
+		}
+		if (i + 2 > argCount) {
+			printUsage();
+			return -1;
+		}
+
+		String fontName = argValues[i];
+		if (prefix.empty())
+			prefix = fontName;
+		vector <ULong> ppems;
+		for (i ++; i < argCount; i ++) {
+			char *end;
+			long ppem = strtol (argValues[i], &end, 10);
+			long lastPPEM = ppem;
+			if (*end == '-')
+				lastPPEM = strtol (end + 1, &end, 10);
+			if (*end != '\0' || ppem <= 0 || lastPPEM < ppem || lastPPEM > 0xFFFF) {
+				cout << "Invalid ppem: " << argValues[i] << endl;
+				return -1;
+			}
+			for (; ppem <= lastPPEM; ppem ++)
+				ppems.push_back (ppem);
+		}
+
+		smart_ptr <OpenTypeFont> font = new coutOpenTypeFont;
+		font->readFromFile (fontName);
+		if (!glyphRange)
+			last = font->getGlyphNum() - 1;
+		if (first > last || last >= font->getGlyphNum()) {
+			cout << "Invalid glyph range: " << first << " to " << last << endl;
+			return -1;
+		}
+
+		RenderProcessor processor;
+		processor.setFont (font);
+
+		RasterContext context;
+		RenderedGlyphs glyphs;
+		RenderTiming result = {0, 0, 0, 0, 0, 0};
+		for (vector <ULong>::iterator ppem = ppems.begin(); ppem != ppems.end(); ppem ++) {
+			processor.setPPEM (*ppem, *ppem, *ppem);
+			if (timing)
+				timeRendering (processor, context, *ppem, first, last, result);
+			else {
+				renderGlyphs (processor, context, *ppem, first, last, glyphs);
+				writeAtlas (glyphs, *ppem, prefix, raw);
+			}
+		}
+		if (timing) {
+			cout << fontName << ": rendered " << result.glyphNum << " glyphs in " <<
+				result.seconds << " s, " << result.seconds * 1e6 / result.glyphNum <<
+				" us per glyph, " << result.bytes / result.glyphNum <<
+				" bytes of coverage per glyph, render pool " << context.getPoolSize() <<
+				" bytes" << endl;
+			cout << "Slowest: glyph " << result.slowestGlyph << " at " << result.slowestPPEM <<
+				" ppem in " << result.slowest * 1e6 << " us" << endl;
+		}
+	} catch (Exception &e) {
+		cout << "Error: " << e << endl;
+		return -1;
+	} catch (std::exception &e) {
+		cout << "Error: " << e.what() << endl;
+		return -1;
+	}
+	return 0;
+}
@@ -170,14 +170,6 @@ SOURCE=.\fontcache.h
 # End Source File
 # Begin Source File
 
-SOURCE=.\ftgrays.h
-# End Source File
-# Begin Source File
-
-SOURCE=.\ftimage.h
-# End Source File
-# Begin Source File
-
 SOURCE=.\glyphprocessor.h
 # End Source File
 # Begin Source File
@@ -495,10 +487,6 @@ SOURCE=.\fontcache.cpp
 # End Source File
 # Begin Source File
 
-SOURCE=.\ftgrays.c
-# End Source File
-# Begin Source File
-
 SOURCE=.\glyphprocessor.cpp
 # End Source File
 # Begin Source File
@@ -38,6 +38,7 @@
 #include <qglobal.h>
 #include <qimage.h>
 #include "fontcache.h"
+#include "../Rasterizer/Blend.h"
 #include "messagedialog.h"
 
 /*** MessageInstructionProcessor ***/
@@ -47,181 +48,109 @@ void MessageInstructionProcessor::addWarning (InstructionExceptionPtr newWarning
 }
 
 
-/*** RasterCache ***/
-
-RasterCache::RasterCache (const InstructionProcessor::Points &points)
-{
-	FT_Raster raster;
-
-	// Raster cache
-	ft_grays_raster.raster_new (NULL, &raster);
-	void *pool = malloc (poolSize);
-	ft_grays_raster.raster_reset (raster, (unsigned char*) pool, poolSize);
-
-	// Render the font using the FreeType greyscale renderer
-
-	vector <FT_Vector> ft_points;
-	vector <char> tags;
-	vector <short> contours;
-
-	for (InstructionProcessor::Points::const_iterator i = points.begin(); i != points.end(); i++) {
-		FT_Vector v;
-		v.x = i->currentX.get_i();
-		v.y = i->currentY.get_i();
-		ft_points.push_back (v);
-		if (i->onCurve)
-			tags.push_back (1);
-		else
-			tags.push_back (0);
-		if (i->lastContourPoint)
-			contours.push_back (i - points.begin());
-	}
-
-	FT_Outline outline = {contours.size(), points.size(), &*ft_points.begin(),
-		&*tags.begin(), &*contours.begin(), 0};
-
-	FT_Raster_Params params = {NULL, &outline, ft_raster_flag_aa | ft_raster_flag_direct, 
-		&rasterCallback, NULL, NULL, NULL, this, {0,0,0,0}};
-
-
-	ft_grays_raster.raster_render(raster, &params);
-
-	free(pool);
-}
-
-void rasterCallback(int y, int count, FT_Span* spans, void* user) {
-	RasterCache *cache = (RasterCache*) user;
-	if (count!=0) {
-		RasterCacheSpan newSpan;
+/*** ImageRasterCache ***/
+
+namespace {
+	// Base for painters that darken the pixels of a QImage by the coverage
+	// of the glyph, with the origin of the glyph at (xOffset, yOffset).
+	// Pixels of the glyph are scale pixels of the image wide.
+	template <class Pixel, int scale> class ImagePainter {
+	protected:
+		QImage &image;
+		int xOffset, yOffset;
+		Pixel *scanLine;
+
+		// The pixels of the glyph from x to x + length, moved by xOffset
+		// and clipped to the image
+		void clip (int x, int length, int &begin, int &end) const {
+			begin = x + xOffset;
+			end = begin + length;
+			if (begin < 0)
+				begin = 0;
+			if (end > scale * image.width())
+				end = scale * image.width();
+		}
 
-		newSpan.y = y;
-		newSpan.spans = vector <FT_Span> (spans, spans + count);
+	public:
+		ImagePainter (QImage &aImage, int aXOffset, int aYOffset)
+			: image (aImage), xOffset (aXOffset), yOffset (aYOffset), scanLine (NULL) {}
 
-		cache->spans.push_back (newSpan);
-	}
-}
+		bool row (int y) {
+			if (yOffset < y || yOffset - y >= image.height())
+				return false;
+			scanLine = (Pixel *) image.scanLine (yOffset - y);
+			return scanLine && scanLine != (Pixel *) -1;
+		}
+	};
+
+	class Painter8bpp : public ImagePainter <uchar, 1> {
+	public:
+		Painter8bpp (QImage &image, int xOffset, int yOffset)
+			: ImagePainter <uchar, 1> (image, xOffset, yOffset) {}
+
+		void run (int x, int length, Byte coverage) {
+			int begin, end;
+			clip (x, length, begin, end);
+			if (begin < end)
+				darkenPixels (scanLine + begin, end - begin, coverage);
+		}
 
-RasterCache::~RasterCache() {}
-
-void RasterCache::paintGlyph8bpp(QImage &image, int xOffset, int yOffset) const {
-	for (RasterCacheSpans::const_iterator span = spans.begin(); span != spans.end(); span ++) {
-		if (yOffset >= span->y && yOffset - span->y < image.height()) {
-			uchar *scanLine = image.scanLine(yOffset - span->y);
-			uchar *endLine = scanLine + image.width();
-			if (scanLine && scanLine!=(uchar*)-1) {
-				RasterCacheSpan::Spans::const_iterator curSpan = span->spans.begin();
-				uchar *curPos = scanLine + curSpan->x + xOffset;
-				while (curSpan != span->spans.end() && curPos + curSpan->len < scanLine)
-				{	// while span is fully hidden
-					curSpan++;
-					curPos = scanLine + curSpan->x + xOffset;
-				}
-				if (curSpan != span->spans.end() && curPos < scanLine)
-				{	// span is partially hidden
-					curPos = scanLine;
-					uchar *endSpan = scanLine + curSpan->x + xOffset + curSpan->len;
-					while (curPos<endSpan && curPos < endLine) {
-						*curPos = ((*curPos) * (255 - curSpan->coverage)) / 255;
-						curPos++;
-					}
-					curSpan++;
-				}
-				while (curSpan != span->spans.end() && curPos < endLine) {
-					curPos = scanLine + curSpan->x + xOffset;
-					for (int i=0; i<curSpan->len && curPos < endLine; i++) {
-						*curPos = ((*curPos) * (255 - curSpan->coverage)) / 255;
-						curPos++;
-					}
-					curSpan ++;
-				}
-			}
+		void pixels (int x, int length, const Byte *coverage) {
+			int begin, end;
+			clip (x, length, begin, end);
+			if (begin < end)
+				darkenPixels (scanLine + begin, end - begin, coverage + begin - x - xOffset);
+		}
+	};
+
+	class Painter32bpp : public ImagePainter <QRgb, 1> {
+	public:
+		Painter32bpp (QImage &image, int xOffset, int yOffset)
+			: ImagePainter <QRgb, 1> (image, xOffset, yOffset) {}
+
+		void run (int x, int length, Byte coverage) {
+			int begin, end;
+			clip (x, length, begin, end);
+			if (begin < end)
+				darkenPixels ((ULong *) scanLine + begin, end - begin, coverage);
 		}
-	}
-}
 
-void RasterCache::paintGlyph32bpp(QImage &image, int xOffset, int yOffset) const {
-	for (RasterCacheSpans::const_iterator span = spans.begin(); span != spans.end(); span ++) {
-		if (yOffset >= span->y && yOffset - span->y < image.height()) {
-			QRgb *scanLine = (QRgb *) image.scanLine (yOffset - span->y);
-			QRgb *endLine = scanLine + image.width();
-			if (scanLine && scanLine != (QRgb *)-1) {
-				RasterCacheSpan::Spans::const_iterator curSpan = span->spans.begin();
-				QRgb *curPos = scanLine + curSpan->x + xOffset;
-				while (curSpan != span->spans.end() && curPos + curSpan->len < scanLine)
-				{	// while span is fully hidden
-					curSpan++;
-					curPos = scanLine + curSpan->x + xOffset;
-				}
-				if (curSpan != span->spans.end() && curPos < scanLine)
-				{	// span is partially hidden
-					curPos = scanLine;
-					QRgb *endSpan = scanLine + curSpan->x + xOffset + curSpan->len;
-					while (curPos<endSpan && curPos < endLine) {
-						int factor = 255 - curSpan->coverage;
-						*curPos = qRgb((qRed(*curPos) * factor) / 255,
-							(qGreen(*curPos) * factor) / 255,
-							(qBlue(*curPos) * factor) / 255);
-						curPos++;
-					}
-					curSpan++;
-				}
-				while (curSpan != span->spans.end() && curPos < endLine) {
-					curPos = scanLine + curSpan->x + xOffset;
-					for (int i=0; i<curSpan->len && curPos < endLine; i++) {
-						int factor = 255 - curSpan->coverage;
-						*curPos = qRgb((qRed(*curPos) * factor) / 255,
-							(qGreen(*curPos) * factor) / 255,
-							(qBlue(*curPos) * factor) / 255);
-						curPos++;
-					}
-					curSpan ++;
-				}
-			}
+		void pixels (int x, int length, const Byte *coverage) {
+			int begin, end;
+			clip (x, length, begin, end);
+			if (begin < end)
+				darkenPixels ((ULong *) scanLine + begin, end - begin,
+					coverage + begin - x - xOffset);
+		}
+	};
+
+	// Every pixel of the glyph is one third of a pixel of the image: the
+	// red, green or blue part of it.
+	class PainterSubPixels : public ImagePainter <QRgb, 3> {
+	public:
+		PainterSubPixels (QImage &image, int xOffset, int yOffset)
+			: ImagePainter <QRgb, 3> (image, xOffset, yOffset) {}
+
+		void run (int x, int length, Byte coverage) {
+			int begin, end;
+			clip (x, length, begin, end);
+			if (begin < end)
+				darkenSubPixels ((ULong *) scanLine, begin, end - begin, coverage);
 		}
-	}
-}
 
-void RasterCache::paintGlyphSubPixels(QImage &image, int xOffset, int yOffset) const {
-	for (RasterCacheSpans::const_iterator span = spans.begin(); span != spans.end(); span ++) {
-		if (yOffset >= span->y) {
-			QRgb *scanLine = (QRgb*) image.scanLine(yOffset - span->y);
-			QRgb *endLine = scanLine + image.width();
-			if (scanLine) {
-				RasterCacheSpan::Spans::const_iterator curSpan = span->spans.begin();
-				QRgb *curPos = scanLine + (curSpan->x + xOffset)/3;
-				while (curSpan != span->spans.end() && curPos < endLine) {
-					curPos = scanLine + (curSpan->x + xOffset)/3;
-					int subPixelPos = (curSpan->x + xOffset)%3;
-					for (int i=0; i<curSpan->len && curPos < endLine; i++) {
-						int factor = 255 - curSpan->coverage;
-
-						switch(subPixelPos) {
-						case 0:
-							*curPos = qRgb((qRed(*curPos) * factor) / 255,
-								qGreen(*curPos),qBlue(*curPos));
-							break;
-						case 1:
-							*curPos = qRgb(qRed(*curPos),
-								(qGreen(*curPos) * factor) / 255,
-								qBlue(*curPos));
-							break;
-						case 2:
-							*curPos = qRgb(qRed(*curPos), qGreen(*curPos),
-								(qBlue(*curPos) * factor) / 255);
-							break;
-						}
-
-						subPixelPos++;
-						if (subPixelPos==3) {
-							subPixelPos = 0;
-							curPos++;
-						}
-					}
-					curSpan ++;
-				}
-			}
+		void pixels (int x, int length, const Byte *coverage) {
+			int begin, end;
+			clip (x, length, begin, end);
+			if (begin < end)
+				darkenSubPixels ((ULong *) scanLine, begin, end - begin,
+					coverage + begin - x - xOffset);
 		}
-	}
+	};
+}	// end anonymous namespace
+
+void ImageRasterCache::paintGlyph32bpp(QImage &image, int xOffset, int yOffset) const {
+	Painter32bpp painter (image, xOffset, yOffset);
+	paintRows (painter);
 }
 
 
@@ -229,7 +158,7 @@ void RasterCache::paintGlyphSubPixels(QImage &image, int xOffset, int yOffset) c
 
 
 GlyphCache::GlyphCache (smart_ptr <InstructionProcessor> aProc, GlyphId aGlyphId,
-						MessageDialog *messageDialog) : glyphId (aGlyphId)
+						MessageDialog *messageDialog) : glyphId (aGlyphId), inAtlas (false)
 {
 	try {
 		points = aProc->getGlyphPoints (aGlyphId);
@@ -239,8 +168,6 @@ GlyphCache::GlyphCache (smart_ptr <InstructionProcessor> aProc, GlyphId aGlyphId
 		NewF26Dot6 translation = lsb->currentX.round();
 		for (Points::iterator i = points.begin(); i != points.end(); i++)
 			i->currentX -= translation;
-
-		raster = new RasterCache (points);
 	} catch (Exception &e) {
 		messageDialog->addMessage (e, true);
 	}
@@ -252,14 +179,36 @@ const GlyphCache::Points & GlyphCache::getPoints() const {
 	return points;
 }
 
-void GlyphCache::paintGlyph (QImage &image, int xOffset, int yOffset) const {
-	if (raster)
-		raster->paintGlyph8bpp(image, xOffset, yOffset);
+template <class Painter> void GlyphCache::paint (GlyphAtlas &atlas, Painter &painter) {
+	if (points.empty())
+		return;
+	if (inAtlas && atlas.paintRows (slot, painter))
+		return;
+	if (raster) {
+		raster->paintRows (painter);
+		return;
+	}
+
+	smart_ptr <RasterCache> newRaster = new RasterCache (points);
+	if (!atlas.fits (*newRaster)) {
+		// Adding it would only drop every other glyph
+		raster = newRaster;
+		raster->paintRows (painter);
+		return;
+	}
+	slot = atlas.add (*newRaster);
+	inAtlas = true;
+	atlas.paintRows (slot, painter);
+}
+
+void GlyphCache::paintGlyph (QImage &image, GlyphAtlas &atlas, int xOffset, int yOffset) {
+	Painter8bpp painter (image, xOffset, yOffset);
+	paint (atlas, painter);
 }
 
-void GlyphCache::paintGlyphSubPixel (QImage &image, int xOffset, int yOffset) const {
-	if (raster)
-		raster->paintGlyphSubPixels(image, xOffset, yOffset);
+void GlyphCache::paintGlyphSubPixel (QImage &image, GlyphAtlas &atlas, int xOffset, int yOffset) {
+	PainterSubPixels painter (image, xOffset, yOffset);
+	paint (atlas, painter);
 }
 
 
@@ -284,6 +233,7 @@ FontCache::~FontCache() {}
 
 void FontCache::newPPEM() {
 	glyphs.clear();
+	atlas.clear();
 	if (proc) {
 		try {
 			proc->setPPEM(ppemx, ppemy, pointSize);
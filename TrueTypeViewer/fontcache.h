@@ -31,7 +31,8 @@
 
 /**
 	FontCache caches instructed glyph points for a certain	ppem value as
-	well as raster representations for those glyphs.
+	well as raster representations for those glyphs, which are kept in a
+	GlyphAtlas, or, for glyphs too large for it, with the glyph.
 */
 
 #ifndef FONTCACHE_H
@@ -40,7 +41,8 @@
 #include "../OTFont/OpenTypeFont.h"
 #include "../InstructionProcessor/InstructionProcessor.h"
 #include "../OTFont/OTGlyph.h"
-#include "ftgrays.h"
+#include "../Rasterizer/RasterCache.h"
+#include "../Rasterizer/GlyphAtlas.h"
 #include <qpainter.h>
 #include <vector>
 
@@ -57,33 +59,19 @@ protected:
 	MessageDialog *messageDialog;
 	virtual void addWarning (InstructionExceptionPtr newWarning);
 public:
-	MessageInstructionProcessor (MessageDialog *aMessageDialog)
-		: messageDialog (aMessageDialog) {}
+	MessageInstructionProcessor (MessageDialog *aMessageDialog,
+		bool aUseInstructionObjects = false)
+		: InstructionProcessor (aUseInstructionObjects), messageDialog (aMessageDialog) {}
 };
 
-/*** RasterCache ***/
-
-typedef struct _RasterCacheSpan {
-	short y;
-	typedef vector <FT_Span> Spans;
-	Spans spans;
-} RasterCacheSpan;
-
-#define poolSize 4096
-
-
-class RasterCache {
-protected:
-	typedef vector <RasterCacheSpan> RasterCacheSpans;
-	RasterCacheSpans spans;
-	friend void rasterCallback(int y, int count, FT_Span*  spans, void* user);
+/*** ImageRasterCache ***/
 
+class ImageRasterCache : public RasterCache {
 public:
-	RasterCache (const InstructionProcessor::Points &points);
-	virtual ~RasterCache();
-	void paintGlyph8bpp (QImage &image, int xOffset, int yOffset) const;
+	ImageRasterCache (const InstructionProcessor::Points &points)
+		: RasterCache (points) {}
+	virtual ~ImageRasterCache() {}
 	void paintGlyph32bpp (QImage &image, int xOffset, int yOffset) const;
-	void paintGlyphSubPixels (QImage &image, int xOffset, int yOffset) const;
 };
 
 
@@ -93,16 +81,23 @@ public:
 private:
 	Points points;
 	GlyphId glyphId;
+	// Where the glyph is in the atlas, if inAtlas. The glyph is rendered
+	// when it is first painted, and again when its page has been dropped.
+	GlyphAtlas::Slot slot;
+	bool inAtlas;
+	// A glyph too large for the atlas keeps its raster here instead
 	smart_ptr <RasterCache> raster;
 
+	template <class Painter> void paint (GlyphAtlas &atlas, Painter &painter);
+
 public:
 	GlyphCache (smart_ptr <InstructionProcessor> aProc, GlyphId aIndex, MessageDialog *messageDialog);
 	virtual ~GlyphCache();
 
 	const Points &getPoints() const;
 
-	void paintGlyph (QImage &image, int xOffset, int yOffset) const;
-	void paintGlyphSubPixel (QImage &image, int xOffset, int yOffset) const;
+	void paintGlyph (QImage &image, GlyphAtlas &atlas, int xOffset, int yOffset);
+	void paintGlyphSubPixel (QImage &image, GlyphAtlas &atlas, int xOffset, int yOffset);
 
 	GlyphId getGlyphId() const { return glyphId; }
 	int getAdvance() const;
@@ -117,6 +112,7 @@ class FontCache {
 	smart_ptr <InstructionProcessor> proc;
 	ULong ppemx, ppemy, pointSize;
 	GlyphCaches glyphs;
+	GlyphAtlas atlas;
 
 	void newPPEM();
 
@@ -128,6 +124,9 @@ public:
 	void setFont (smart_ptr <OpenTypeFont> aFont, smart_ptr <InstructionProcessor> aProc);
 
 	GlyphCachePtr getGlyph (GlyphId index);
+	// The atlas that the glyphs are painted from. It is emptied when the
+	// font or the ppem value changes; its budget can be set.
+	GlyphAtlas & getAtlas() { return atlas; }
 };
 
 #endif // FONTCACHE_H
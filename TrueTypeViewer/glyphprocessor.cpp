@@ -39,8 +39,9 @@
 
 using util::String;
 
+// The instructions are stepped through, so Instruction objects are needed
 GlyphProcessor::GlyphProcessor (MessageDialog *aMessageDialog)
-: MessageInstructionProcessor (aMessageDialog), instructionCount (0) {}
+: MessageInstructionProcessor (aMessageDialog, true), instructionCount (0) {}
 
 GlyphProcessor::~GlyphProcessor() {}
 
@@ -60,8 +61,10 @@ const GlyphProcessor::Instructions & GlyphProcessor::getGlyphProgram() {
 	return glyphProgram.instructions;
 }
 
-const GlyphProcessor::Points & GlyphProcessor::getPoints() {
-	return points;
+GlyphProcessor::Points GlyphProcessor::getPoints() {
+	Points result;
+	points.getPoints (result);
+	return result;
 }
 
 int GlyphProcessor::getCurrentInstructionCount() {
@@ -89,25 +92,19 @@ void GlyphProcessor::restart() {
 
 		GlyphPtr glyph = font->getGlyph (glyphId);
 		Exception::FontContext c1 (*font);
-		Exception::Context c2 ("loading glyph " + String (glyphId) + " \'"
-			+ glyph->getName() + "\'");
+		Exception::Context c2 ("loading glyph %1 '%2'", glyphId, glyph->getName());
 
 		callStack.clear();
 
-		stack.clear();
-		stack.reserve (font->getMaxStackElements());
+		stackSize = 0;
+		if (stack.size() < maxStackElements)
+			stack.resize (maxStackElements);
 
 		twilight.clear();
 
-		InstructionProcessor::loadGlyph (glyph);
+		InstructionProcessor::loadGlyph (glyph, glyphId);
 
-		GridFittedPoint p;// = {0,0, 0,0, true, false, false, true};
-		p.currentX = p.currentY = p.originalX = p.originalY = 0;
-		p.onCurve = true;
-		p.touchedX = false;
-		p.touchedY = false;
-		p.lastContourPoint = true;
-		twilight.insert (twilight.end(), font->getMaxTwilightPoints(), p);
+		resetTwilightZone();
 
 		instructionCount = 0;
 		currentInstruction.stream = &glyphProgram;
@@ -126,14 +123,15 @@ void GlyphProcessor::runToCount (int count) {
 	assert (instructionCount <= count);
 	GlyphPtr glyph = font->getGlyph (glyphId);
 	Exception::FontContext c1 (*font);
-	Exception::Context c2 ("executing instructions for glyph " + String (glyphId) + " \'"
-		+ glyph->getName() + "\'");
+	Exception::Context c2 ("executing instructions for glyph %1 '%2'",
+		glyphId, glyph->getName());
 
 	try {
 		while (instructionCount < count &&
 			currentInstruction.position != currentInstruction.stream->instructions.end())
 		{
 			nextInstruction.position = currentInstruction.position + 1;
+			checkStackEffect (**currentInstruction.position);
 			(*currentInstruction.position)->execute (*this);
 
 			currentInstruction = nextInstruction;
@@ -147,10 +145,10 @@ void GlyphProcessor::runToCount (int count) {
 			if (!callStack.empty())
 				addWarning (new InstructionException ("Non-empty call stack after execution"));
 			callStack.clear();
-			if (!stack.empty())
+			if (stackSize != 0)
 				addWarning (new InstructionException ("Elements left on the stack after execution: "
-					+ String (stack.size())));
-			stack.clear();
+					+ String (stackSize)));
+			stackSize = 0;
 			twilight.clear();
 
 			state = psNotActive;
@@ -168,8 +166,8 @@ void  GlyphProcessor::runToEnd() {
 	runToCount (100000);
 }
 
-const std::vector <Long> &  GlyphProcessor::getStack() {
-	return stack;
+std::vector <Long> GlyphProcessor::getStack() {
+	return std::vector <Long> (stack.begin(), stack.begin() + stackSize);
 }
 
 const GlyphProcessor::Storage & GlyphProcessor::getStorageElements() {
@@ -183,8 +181,8 @@ const GlyphProcessor::CVT GlyphProcessor::getCVTEntries() {
 NewF26Dot6 GlyphProcessor::getPPEMPixels() {
 	if (state == psNotActive)
 		return ppemX;
-	return weightedAverage(NewF26Dot6 (ppemX), NewF26Dot6 (ppemY),
-		currentGraphicsState.projectionVector);
+	return NewF26Dot6 (ppemAlong (ppemX, ppemY,
+		currentGraphicsState.projectionVector));
 }
 
 const GlyphProcessor::GraphicsState & GlyphProcessor::getGraphicsState() {
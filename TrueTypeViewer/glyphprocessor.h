@@ -55,7 +55,7 @@ public:
 	const Instructions & getCVTProgram();
 	const Instructions & getGlyphProgram();
 
-	const Points & getPoints();
+	Points getPoints();
 
 	int getCurrentInstructionCount();
 	QString getCurrentInstructionPosition();
@@ -66,7 +66,7 @@ public:
 	void runToCount(int count);
 	void runToEnd();
 
-	const std::vector <Long> & getStack();
+	std::vector <Long> getStack();
 	const Storage & getStorageElements();
 	const CVT getCVTEntries();
 	NewF26Dot6 getPPEMPixels();
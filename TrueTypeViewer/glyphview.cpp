@@ -722,7 +722,7 @@ void GlyphView::resetGlyphView() {
 		largePoints.push_back (largePoint);
 	}
 
-	rasterCache = new RasterCache (largePoints);
+	rasterCache = new ImageRasterCache (largePoints);
 
 	dirtyImage = true;
 	repaint(false);
@@ -50,7 +50,7 @@ class GlyphView : public QWidget {
 protected:
 	Points points;
 
-	smart_ptr <RasterCache> rasterCache;
+	smart_ptr <ImageRasterCache> rasterCache;
 	smart_ptr <QImage> image;
 	bool dirtyImage;
 	bool numbers;
@@ -105,9 +105,9 @@ void InstructedText::paint (QImage &image, bool subPixel) {
 
 		/*** Draw glyph ***/
 		if (subPixel)
-			glyph->paintGlyphSubPixel(image, thisXOffset, thisYOffset);
+			glyph->paintGlyphSubPixel(image, fontCache->getAtlas(), thisXOffset, thisYOffset);
 		else
-			glyph->paintGlyph(image, thisXOffset, thisYOffset);
+			glyph->paintGlyph(image, fontCache->getAtlas(), thisXOffset, thisYOffset);
 
 		/*** Move pen for next glyph ***/
 		xOffset += (*i)->getAdvance() / 64;
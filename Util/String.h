@@ -43,6 +43,8 @@
 #include <cassert>
 #include <cstring>
 
+#include "atomic.h"
+
 namespace util {
 
 	class StringCharacters;
@@ -266,7 +268,7 @@ namespace util {
 	/*** StringCharacters ***/
 
 	class StringCharacters {
-		unsigned int refCount;
+		volatile unsigned int refCount;
 		int capacity;
 		int length;
 		char *characters;
@@ -455,7 +457,7 @@ namespace util {
 		// If the reference count is 1, i.e., this is owned by exactly one String,
 		// the characters may be added to this. Otherwise a deep copy must be
 		// returned.
-		if (refCount == 1) {
+		if (atomic_read (refCount) == 1) {
 			resizeCapacity (length + newSize);
 			memcpy (& characters [length], s, newSize);
 			length += newSize;
@@ -474,7 +476,7 @@ namespace util {
 
 		assert (first <= length);
 		assert (first + num <= length);
-		if (refCount == 1) {
+		if (atomic_read (refCount) == 1) {
 			if (first + num < length) {
 				memcpy(& characters [first], & characters [first + num], length - (first+num));
 				length -= num;
@@ -492,7 +494,7 @@ namespace util {
 	inline StringCharacters * StringCharacters::set (int index, char c) {
 		assert (index < length);
 
-		if (refCount == 1) {
+		if (atomic_read (refCount) == 1) {
 			characters [index] = c;
 			return this;
 		}else {
@@ -575,12 +577,11 @@ namespace util {
 
 
 	inline void StringCharacters::increaseRefCount() {
-		refCount ++;
+		atomic_increment (refCount);
 	}
 
 	inline void StringCharacters::release() {
-		refCount --;
-		if (refCount == 0)
+		if (atomic_decrement (refCount) == 0)
 			delete this;
 	}
 
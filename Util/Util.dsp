@@ -87,6 +87,10 @@ LIB32=link.exe -lib
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=.\parallel.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Preprocessor.cpp
 # End Source File
 # Begin Source File
@@ -99,6 +103,10 @@ SOURCE=.\String.cpp
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=.\atomic.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\check_overflow.h
 # End Source File
 # Begin Source File
@@ -123,6 +131,10 @@ SOURCE=.\loop.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\parallel.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\precision_trait.h
 # End Source File
 # Begin Source File
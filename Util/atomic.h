@@ -0,0 +1,96 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Foobar; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	\file atomic.h
+	Provides atomic increments and decrements for reference counts, so that
+	objects can be shared between threads.
+	With Visual C++, only 32-bit integers are supported.
+****************************************************************************/
+
+#ifndef UTIL_ATOMIC_H
+#define UTIL_ATOMIC_H
+
+#ifdef _MSC_VER
+// The intrinsics rather than <windows.h>, which would define min and max
+// as macros in every file that uses strings
+#include <intrin.h>
+#pragma intrinsic (_InterlockedIncrement, _InterlockedDecrement, _InterlockedExchangeAdd)
+#endif
+
+namespace util {
+
+	/// Read value, which may be changed by other threads.
+	template <typename Integer>
+		inline Integer atomic_read (const volatile Integer &value)
+	{
+#if defined (__ATOMIC_ACQUIRE)
+		return __atomic_load_n (&value, __ATOMIC_ACQUIRE);
+#else
+		// Aligned reads are atomic on the processors supported
+		return value;
+#endif
+	}
+
+	/// Atomically increase value by one and return the new value.
+	template <typename Integer>
+		inline Integer atomic_increment (volatile Integer &value)
+	{
+#if defined (__GNUC__)
+		return __sync_add_and_fetch (&value, 1);
+#elif defined (_MSC_VER)
+		return (Integer) _InterlockedIncrement ((volatile long *) &value);
+#else
+		// No threads can be supported
+		return ++ value;
+#endif
+	}
+
+	/// Atomically decrease value by one and return the new value.
+	template <typename Integer>
+		inline Integer atomic_decrement (volatile Integer &value)
+	{
+#if defined (__GNUC__)
+		return __sync_sub_and_fetch (&value, 1);
+#elif defined (_MSC_VER)
+		return (Integer) _InterlockedDecrement ((volatile long *) &value);
+#else
+		return -- value;
+#endif
+	}
+
+	/// Atomically add addend to value and return the old value.
+	template <typename Integer>
+		inline Integer atomic_fetch_add (volatile Integer &value, Integer addend)
+	{
+#if defined (__GNUC__)
+		return __sync_fetch_and_add (&value, addend);
+#elif defined (_MSC_VER)
+		return (Integer) _InterlockedExchangeAdd ((volatile long *) &value, (long) addend);
+#else
+		Integer old = value;
+		value += addend;
+		return old;
+#endif
+	}
+}
+
+#endif	// UTIL_ATOMIC_H
@@ -0,0 +1,205 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Foobar; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <vector>
+
+#include "parallel.h"
+#include "atomic.h"
+
+#ifndef _WIN32
+#define UTIL_PARALLEL_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+namespace util {
+
+namespace {
+
+	// The work currently being done by parallel_for
+	struct parallel_job {
+		parallel_task *task;
+		size_t num;
+		size_t chunk;
+		volatile size_t next;
+		volatile int failed;
+	};
+
+	void run_chunks (parallel_job &job) {
+		while (!job.failed) {
+			size_t begin = atomic_fetch_add (job.next, job.chunk);
+			if (begin >= job.num)
+				break;
+			size_t end = begin + job.chunk;
+			if (end > job.num)
+				end = job.num;
+			try {
+				job.task->run (begin, end);
+			} catch (...) {
+				job.failed = 1;
+			}
+		}
+	}
+
+	bool run_serially (parallel_task &task, size_t num) {
+		try {
+			if (num)
+				task.run (0, num);
+			return true;
+		} catch (...) {
+			return false;
+		}
+	}
+
+#ifdef UTIL_PARALLEL_THREADS
+
+	unsigned int get_processor_num() {
+		long processor_num = sysconf (_SC_NPROCESSORS_ONLN);
+		return processor_num > 0 ? (unsigned int) processor_num : 1;
+	}
+
+	unsigned int thread_num = 0;
+
+	pthread_mutex_t caller_mutex = PTHREAD_MUTEX_INITIALIZER;
+	pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	pthread_cond_t work_condition = PTHREAD_COND_INITIALIZER;
+	pthread_cond_t done_condition = PTHREAD_COND_INITIALIZER;
+
+	std::vector <pthread_t> workers;
+	// Protected by mutex
+	parallel_job *current_job = NULL;
+	unsigned int generation = 0;
+	unsigned int busy_workers = 0;
+	unsigned int active_workers = 0;
+
+	__thread bool is_worker = false;
+
+	void *worker_main (void *argument) {
+		unsigned int index = (unsigned int) (size_t) argument;
+		is_worker = true;
+		unsigned int seen_generation = 0;
+		while (true) {
+			pthread_mutex_lock (&mutex);
+			while (generation == seen_generation)
+				pthread_cond_wait (&work_condition, &mutex);
+			seen_generation = generation;
+			parallel_job *job = index < active_workers ? current_job : NULL;
+			pthread_mutex_unlock (&mutex);
+
+			if (job)
+				run_chunks (*job);
+
+			pthread_mutex_lock (&mutex);
+			if (-- busy_workers == 0)
+				pthread_cond_signal (&done_condition);
+			pthread_mutex_unlock (&mutex);
+		}
+		return NULL;
+	}
+
+#endif	// UTIL_PARALLEL_THREADS
+
+}	// end anonymous namespace
+
+#ifdef UTIL_PARALLEL_THREADS
+
+unsigned int get_thread_num() {
+	pthread_mutex_lock (&caller_mutex);
+	if (!thread_num)
+		thread_num = get_processor_num();
+	unsigned int result = thread_num;
+	pthread_mutex_unlock (&caller_mutex);
+	return result;
+}
+
+void set_thread_num (unsigned int new_thread_num) {
+	pthread_mutex_lock (&caller_mutex);
+	thread_num = new_thread_num ? new_thread_num : 1;
+	pthread_mutex_unlock (&caller_mutex);
+}
+
+bool parallel_for (parallel_task &task, size_t num, size_t min_chunk) {
+	if (is_worker || get_thread_num() <= 1 || num <= min_chunk)
+		return run_serially (task, num);
+
+	pthread_mutex_lock (&caller_mutex);
+
+	// Start workers as necessary
+	while (workers.size() + 1 < thread_num) {
+		pthread_t worker;
+		if (pthread_create (&worker, NULL, worker_main,
+			(void *) (size_t) workers.size()) != 0)
+			break;
+		pthread_detach (worker);
+		workers.push_back (worker);
+	}
+	if (workers.empty()) {
+		pthread_mutex_unlock (&caller_mutex);
+		return run_serially (task, num);
+	}
+
+	// A few chunks per thread so that uneven work evens out
+	parallel_job job;
+	job.task = &task;
+	job.num = num;
+	job.chunk = num / (thread_num * 4);
+	if (job.chunk < min_chunk)
+		job.chunk = min_chunk;
+	job.next = 0;
+	job.failed = 0;
+
+	pthread_mutex_lock (&mutex);
+	current_job = &job;
+	active_workers = thread_num - 1;
+	busy_workers = workers.size();
+	generation ++;
+	pthread_cond_broadcast (&work_condition);
+	pthread_mutex_unlock (&mutex);
+
+	run_chunks (job);
+
+	pthread_mutex_lock (&mutex);
+	while (busy_workers)
+		pthread_cond_wait (&done_condition, &mutex);
+	current_job = NULL;
+	pthread_mutex_unlock (&mutex);
+
+	pthread_mutex_unlock (&caller_mutex);
+	return !job.failed;
+}
+
+#else	// UTIL_PARALLEL_THREADS
+
+// No thread support: do everything in the calling thread
+
+unsigned int get_thread_num() {
+	return 1;
+}
+
+void set_thread_num (unsigned int) {}
+
+bool parallel_for (parallel_task &task, size_t num, size_t) {
+	return run_serially (task, num);
+}
+
+#endif	// UTIL_PARALLEL_THREADS
+
+}	// end namespace util
@@ -0,0 +1,68 @@
+/*
+	(c) Copyright 2002, 2003 Rogier van Dalen
+	(R.C.van.Dalen@umail.leidenuniv.nl for any comments, questions or bugs)
+
+	This file is part of my OpenType/TrueType Font Tools.
+
+	The OpenType/TrueType Font Tools is free software; you can redistribute
+	it and/or modify it under the terms of the GNU General Public License as
+	published by the Free Software Foundation; either version 2 of the
+	License, or (at your option) any later version.
+
+	The OpenType/TrueType Font Tools is distributed in the hope that it will
+	be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+	Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Foobar; if not, write to the Free Software
+	Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/**
+	\file parallel.h
+	Provides a simple pool of worker threads to spread independent pieces of
+	work over the available processors.
+****************************************************************************/
+
+#ifndef UTIL_PARALLEL_H
+#define UTIL_PARALLEL_H
+
+#include <cstddef>
+
+namespace util {
+
+	/**
+		\brief A piece of work on a range of indices, parts of which may be
+		done by different threads at the same time.
+	*/
+	class parallel_task {
+	public:
+		virtual ~parallel_task() {}
+		/// Do the work for indices [begin, end).
+		/// This may be called from any thread, concurrently with calls for
+		/// other ranges.
+		virtual void run (size_t begin, size_t end) = 0;
+	};
+
+	/// Return the number of threads parallel_for uses, including the
+	/// calling thread. By default this is the number of processors.
+	unsigned int get_thread_num();
+	/// Set the number of threads parallel_for uses. If this is 1,
+	/// parallel_for does all work in the calling thread.
+	void set_thread_num (unsigned int thread_num);
+
+	/**
+		\brief Do task for all indices in [0, num), spreading the work over
+		the worker threads and the calling thread.
+
+		The range is divided into chunks of at least min_chunk indices.
+		Exceptions cannot be passed between threads, so they are swallowed;
+		false is returned if any chunk threw one. The caller may then redo
+		the work serially to get the exception.
+		Calls from worker threads are done serially.
+	*/
+	bool parallel_for (parallel_task &task, size_t num, size_t min_chunk = 1);
+}
+
+#endif	// UTIL_PARALLEL_H
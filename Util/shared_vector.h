@@ -4,6 +4,8 @@
 
 #include <vector>
 
+#include "atomic.h"
+
 namespace util {
 
 	template <typename T, class Alloc = std::allocator<T> >
@@ -12,7 +14,7 @@ namespace util {
 	public:
 		typedef typename std::vector <T, Alloc>::size_type size_type;
 	private:
-		unsigned int ref_count;
+		volatile unsigned int ref_count;
 	public:
 		shared_vector_object () : ref_count (1) {}
 
@@ -30,23 +32,23 @@ namespace util {
 			shared_vector_object (InputIterator i1, InputIterator i2)
 			: ref_count (1), std::vector <T, Alloc> (i1, i2) {}
 
-		void increase_ref_count() { ref_count ++; }
+		void increase_ref_count() { atomic_increment (ref_count); }
 		void decrease_ref_count() {
-			ref_count --;
-			if (!ref_count)
+			if (!atomic_decrement (ref_count))
 				delete this;
 		}
 
 		bool is_own_object() const {
-			return (ref_count == 1);
+			return (atomic_read (ref_count) == 1);
 		}
 
 		shared_vector_object * get_own_object() {
 			if (is_own_object())
 				return this;
 			else {
-				ref_count --;
-				return new shared_vector_object (*this);
+				shared_vector_object *copy = new shared_vector_object (*this);
+				decrease_ref_count();
+				return copy;
 			}
 		}
 	};
@@ -34,6 +34,8 @@
 #include <cassert>
 #include <ostream>
 
+#include "atomic.h"
+
 namespace util {
 
 /**
@@ -86,7 +88,7 @@ namespace util {
 
 		class smart_ptr_reference {
 			Type *object;
-			int ref_count;
+			volatile int ref_count;
 		public:
 			smart_ptr_reference (Type *_object) : object (_object), ref_count (1) {
 				assert (_object != NULL);
@@ -101,12 +103,13 @@ namespace util {
 			
 			Type * get() const { return object; }
 			
+			// The reference count is changed atomically, so that smart_ptrs
+			// to the same object may be copied by different threads.
 			void increase_ref_count()  {
-				ref_count ++;
+				atomic_increment (ref_count);
 			}
 			void release()  {
-				ref_count --;
-				if (ref_count == 0)
+				if (atomic_decrement (ref_count) == 0)
 					delete this;
 			}
 		};